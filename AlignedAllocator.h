@@ -0,0 +1,67 @@
+#ifndef ALIGNEDALLOCATOR_H
+#define ALIGNEDALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+
+using namespace std;
+
+/**
+ * @class AlignedAllocator
+ * @brief Standard allocator that aligns every allocation to a fixed boundary.
+ *        Used for the point arrays so that they start on a cache line and can be
+ *        read with aligned SIMD loads.
+ *
+ * @tparam T The element type.
+ * @tparam Alignment The alignment in bytes (a power of two).
+ */
+template <typename T, size_t Alignment = 64>
+class AlignedAllocator
+{
+public:
+
+    typedef T value_type;
+
+    /**
+     * @brief Rebinds the allocator to another element type with the same alignment.
+     */
+    template <typename U>
+    struct rebind
+    {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() noexcept {}
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    /**
+     * @brief Allocates uninitialized memory for n elements.
+     *
+     * @param n The number of elements.
+     * @return A pointer aligned to Alignment bytes.
+     */
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(::operator new(n * sizeof(T), align_val_t(Alignment)));
+    }
+
+    /**
+     * @brief Frees memory returned by allocate().
+     *
+     * @param p The pointer to free.
+     */
+    void deallocate(T* p, size_t)
+    {
+        ::operator delete(p, align_val_t(Alignment));
+    }
+};
+
+template <typename T, typename U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) { return true; }
+
+template <typename T, typename U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) { return false; }
+
+#endif
@@ -0,0 +1,407 @@
+/****************************************************************************
+ * @file AssignmentEngine.cpp
+ * @brief Implementation of the AssignmentEngine base class: the block layout
+ *        shared by all engines, the merging of the per-block partial sums, the
+ *        choice between full and incremental sums, and the factory that creates
+ *        the engine for a given algorithm.
+ ****************************************************************************/
+
+#include "AssignmentEngine.h"
+#include "BlockPartition.h"
+#include "ElkanEngine.h"
+#include "GemmEngine.h"
+#include "GridEngine.h"
+#include "HamerlyEngine.h"
+#include "KdTreeEngine.h"
+#include "LloydEngine.h"
+#include "YinyangEngine.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * @brief Creates the engine that implements the algorithm selected in the options.
+ *
+ * @param options The options that select the algorithm and the instruction set.
+ * @param data The samples to assign.
+ * @param pool The thread pool used to process the blocks.
+ * @return unique_ptr<AssignmentEngine> A new engine.
+ * @throws invalid_argument If the algorithm is unknown, or is neither Lloyd nor Automatic with a precision
+ *         other than double.
+ */
+unique_ptr<AssignmentEngine> AssignmentEngine::create(const KMeansOptions& options, Dataset& data, ThreadPool& pool)
+{
+    // Only the brute-force search has reduced-precision versions; the other engines would run in double anyway
+    const bool reduced = options.precision != Precision::Double || data.getPrecision() != Precision::Double;
+    if (reduced && options.algorithm != Algorithm::Lloyd && options.algorithm != Algorithm::Automatic) {
+        throw invalid_argument("Only the Lloyd and Automatic algorithms support a precision other than double.");
+    }
+
+    unique_ptr<AssignmentEngine> engine;
+    switch (options.algorithm) {
+    case Algorithm::Lloyd:
+        engine = make_unique<LloydEngine>(data, pool);
+        break;
+    case Algorithm::Automatic:
+        // Same labels either way; the Gemm engine runs the blocked product only where it was measured faster
+        // (double precision only: the reduced precisions have their own search in the Lloyd engine)
+        if (reduced) {
+            engine = make_unique<LloydEngine>(data, pool);
+        }
+        else {
+            engine = make_unique<GemmEngine>(data, pool, true);
+        }
+        break;
+    case Algorithm::Elkan:
+        engine = make_unique<ElkanEngine>(data, pool);
+        break;
+    case Algorithm::Hamerly:
+        engine = make_unique<HamerlyEngine>(data, pool);
+        break;
+    case Algorithm::Yinyang:
+        engine = make_unique<YinyangEngine>(data, pool);
+        break;
+    case Algorithm::KdTree:
+        engine = make_unique<KdTreeEngine>(data, pool);
+        break;
+    case Algorithm::Grid:
+        // The grid indexes the plane: other dimensions fall back to the brute-force search
+        if (data.getDimension() == 2) {
+            engine = make_unique<GridEngine>(data, pool);
+        }
+        else {
+            engine = make_unique<LloydEngine>(data, pool);
+        }
+        break;
+    case Algorithm::Gemm:
+        engine = make_unique<GemmEngine>(data, pool);
+        break;
+    default:
+        throw invalid_argument("Unknown assignment algorithm.");
+    }
+
+    engine->setInstructionSet(options.instructionSet);
+    engine->setRecomputeInterval(options.recomputeInterval);
+    return engine;
+}
+
+/**
+ * @brief Constructor that binds the engine to the samples and the thread pool.
+ *
+ * @param data The samples to assign.
+ * @param pool The thread pool used to process the blocks.
+ */
+AssignmentEngine::AssignmentEngine(Dataset& data, ThreadPool& pool)
+    : data(data), pool(pool), dimension(data.getDimension()), sumClusterCount(0),
+    recomputeInterval(1), incrementalCount(0), incremental(false), summedSampleCount(0), distanceCount(0)
+{
+}
+
+/**
+ * @brief Destructor for the AssignmentEngine class.
+ */
+AssignmentEngine::~AssignmentEngine()
+{
+}
+
+/**
+ * @brief Selects the instruction set of the distance kernel.
+ *
+ * @param instructionSet The wanted instruction set, lowered to the best supported one when needed.
+ */
+void AssignmentEngine::setInstructionSet(InstructionSet instructionSet)
+{
+    kernel = DistanceKernel(instructionSet);
+}
+
+/**
+ * @brief Sets how often the per-cluster sums are recomputed from every sample.
+ *
+ * @param interval The number of assignments between two full recomputations; 0 and 1 disable the incremental updates.
+ */
+void AssignmentEngine::setRecomputeInterval(size_t interval)
+{
+    recomputeInterval = max<size_t>(interval, 1);
+}
+
+/**
+ * @brief Tells whether the last assignment updated the sums incrementally.
+ *
+ * @return bool True if the sums were updated from the reassigned samples only.
+ */
+bool AssignmentEngine::hasIncrementalSums() const
+{
+    return incremental;
+}
+
+/**
+ * @brief Recomputes the per-cluster sums and counts from every sample and its current label.
+ *        The distance counts of the last assignment are kept.
+ */
+void AssignmentEngine::recomputeSums()
+{
+    incremental = false;
+    incrementalCount = 0;
+    blockSums.assign(getBlockCount() * sumClusterCount * (dimension + 1), 0.0);
+
+    const int* labels = data.getLabels();
+
+    dispatchDimension(dimension, [&](auto dim) {
+        pool.parallelFor(getBlockCount(), [&](size_t block) {
+            const size_t end = getBlockBegin(block + 1);
+            double* sums = getBlockSums(block);
+            auto point = dim.makePoint();
+
+            for (size_t i = getBlockBegin(block); i < end; ++i) {
+                loadPoint(i, point.data(), dim);
+                addToBlockSums(sums, static_cast<size_t>(labels[i] - 1), point.data(), dim);
+            }
+            });
+        });
+
+    mergeBlockSums();
+}
+
+/**
+ * @brief Returns the instruction set the distance kernel actually uses.
+ *
+ * @return InstructionSet The instruction set.
+ */
+InstructionSet AssignmentEngine::getInstructionSet() const
+{
+    return kernel.getInstructionSet();
+}
+
+/**
+ * @brief Returns the coordinate sums of each cluster.
+ *
+ * @return const vector<double>& The sums, row-major (K x D).
+ */
+const vector<double>& AssignmentEngine::getSums() const
+{
+    return sums;
+}
+
+/**
+ * @brief Returns the number of samples of each cluster.
+ *
+ * @return const vector<size_t>& The sample counts.
+ */
+const vector<size_t>& AssignmentEngine::getCounts() const
+{
+    return counts;
+}
+
+/**
+ * @brief Returns how many sample-to-center distances the last assignment computed.
+ *
+ * @return size_t The number of distances computed.
+ */
+size_t AssignmentEngine::getDistanceCount() const
+{
+    return distanceCount;
+}
+
+/**
+ * @brief Returns how many sample-to-center distances the last assignment skipped.
+ *        Distances between centers are not counted on either side.
+ *
+ * @return size_t The brute-force distance count minus the distances computed.
+ */
+size_t AssignmentEngine::getSkippedDistanceCount() const
+{
+    return data.size() * sumClusterCount - distanceCount;
+}
+
+/**
+ * @brief Computes the sum of the squared distances of the samples to the centers of the last assignment.
+ *        The per-block partial sums are added in block order, so the result does not depend on the thread count.
+ *
+ * @return double The inertia.
+ */
+double AssignmentEngine::computeInertia() const
+{
+    vector<double> blockInertia(getBlockCount(), 0.0);
+    const int* labels = data.getLabels();
+
+    dispatchDimension(dimension, [&](auto dim) {
+        pool.parallelFor(getBlockCount(), [&](size_t block) {
+            const size_t end = getBlockBegin(block + 1);
+            auto point = dim.makePoint();
+            double inertia = 0.0;
+
+            for (size_t i = getBlockBegin(block); i < end; ++i) {
+                loadPoint(i, point.data(), dim);
+                inertia += squaredDistance(point.data(), &centers[static_cast<size_t>(labels[i] - 1) * dimension], dim);
+            }
+            blockInertia[block] = inertia;
+            });
+        });
+
+    double inertia = 0.0;
+    for (double partial : blockInertia) {
+        inertia += partial;
+    }
+    return inertia;
+}
+
+/**
+ * @brief Returns the number of blocks the samples are split into.
+ *        The result depends only on the sample count and never on the thread count.
+ *
+ * @return size_t The number of blocks (at least 1).
+ */
+size_t AssignmentEngine::getBlockCount() const
+{
+    return BlockPartition(data.size()).getBlockCount();
+}
+
+/**
+ * @brief Returns the first sample index of a block. Block b covers [getBlockBegin(b), getBlockBegin(b + 1)).
+ *
+ * @param block The block index.
+ * @return size_t The index of the first sample of the block.
+ */
+size_t AssignmentEngine::getBlockBegin(size_t block) const
+{
+    return BlockPartition(data.size()).getBlockBegin(block);
+}
+
+/**
+ * @brief Clears the per-block partial sums before a new assignment.
+ *
+ * @param clusterCount The number of clusters.
+ */
+void AssignmentEngine::resetBlockSums(size_t clusterCount)
+{
+    // Update the previous sums incrementally only if they belong to the same clusters and samples,
+    // and recompute them after recomputeInterval - 1 incremental updates to bound the rounding errors
+    incremental = incrementalCount + 1 < recomputeInterval && clusterCount == sumClusterCount
+        && counts.size() == clusterCount && summedSampleCount == data.size();
+    incrementalCount = incremental ? incrementalCount + 1 : 0;
+
+    sumClusterCount = clusterCount;
+    blockSums.assign(getBlockCount() * clusterCount * (dimension + 1), 0.0);
+    blockDistanceCounts.assign(getBlockCount(), 0);
+}
+
+/**
+ * @brief Returns the private partial sums of one block.
+ *
+ * @param block The block index.
+ * @return double* A pointer to the first partial sum of the block.
+ */
+double* AssignmentEngine::getBlockSums(size_t block)
+{
+    return &blockSums[block * sumClusterCount * (dimension + 1)];
+}
+
+/**
+ * @brief Records how many distances a block computed during the current assignment.
+ *
+ * @param block The block index.
+ * @param count The number of sample-to-center distances the block computed.
+ */
+void AssignmentEngine::setBlockDistanceCount(size_t block, size_t count)
+{
+    blockDistanceCounts[block] = count;
+}
+
+/**
+ * @brief Merges the partial sums of all blocks, in block order, into the per-cluster sums,
+ *        and adds up the distance counts of the blocks. Incremental partial sums hold the
+ *        coordinates and counts gained minus those lost, and are added to the previous sums.
+ */
+void AssignmentEngine::mergeBlockSums()
+{
+    const size_t D = dimension;
+    if (!incremental) {
+        sums.assign(sumClusterCount * D, 0.0);
+        counts.assign(sumClusterCount, 0);
+    }
+    summedSampleCount = data.size();
+
+    const size_t blockCount = getBlockCount();
+    for (size_t block = 0; block < blockCount; ++block) {
+        const double* partialSums = getBlockSums(block);
+        for (size_t c = 0; c < sumClusterCount; ++c) {
+            const double* clusterSums = partialSums + c * (D + 1);
+            for (size_t d = 0; d < D; ++d) {
+                sums[c * D + d] += clusterSums[d];
+            }
+            counts[c] = static_cast<size_t>(static_cast<double>(counts[c]) + clusterSums[D]);  ///< The change may be negative
+        }
+    }
+
+    distanceCount = 0;
+    for (size_t count : blockDistanceCounts) {
+        distanceCount += count;
+    }
+}
+
+/**
+ * @brief Copies the centers of the clusters into the row-major centers array
+ *        and caches the dimension and the column pointers of the dataset.
+ *        Samples stored in a reduced precision have no double columns to cache.
+ *
+ * @param clusters The clusters with their current centers.
+ * @throws invalid_argument If the centers and the samples have different dimensions, or if the
+ *         samples are stored in a reduced precision the engine does not search.
+ */
+void AssignmentEngine::loadCenters(const vector<Cluster>& clusters)
+{
+    dimension = data.getDimension();
+    if (data.getPrecision() == Precision::Double) {
+        columns.resize(dimension);
+        for (size_t d = 0; d < dimension; ++d) {
+            columns[d] = data.getColumn(d);
+        }
+    }
+    else if (supportsReducedPrecision()) {
+        columns.clear();
+    }
+    else {
+        throw invalid_argument("Only the Lloyd algorithm supports a precision other than double.");
+    }
+
+    centers.resize(clusters.size() * dimension);
+    for (size_t j = 0; j < clusters.size(); ++j) {
+        const vector<double>& center = clusters[j].getCenter();
+        if (center.size() != dimension) {
+            throw invalid_argument("The cluster centers and the samples have different dimensions.");
+        }
+        copy(center.begin(), center.end(), centers.begin() + j * dimension);
+    }
+}
+
+/**
+ * @brief Returns whether the engine searches samples stored in a reduced precision: only the brute-force
+ *        search has such versions.
+ *
+ * @return false By default.
+ */
+bool AssignmentEngine::supportsReducedPrecision() const
+{
+    return false;
+}
+
+/**
+ * @brief Remembers the loaded centers to measure their movement at the next call.
+ */
+void AssignmentEngine::storeCenters()
+{
+    previousCenters = centers;
+}
+
+/**
+ * @brief Computes how far each loaded center travelled since the last storeCenters() call.
+ */
+void AssignmentEngine::computeCenterShifts()
+{
+    const size_t K = centers.size() / dimension;
+    centerShifts.resize(K);
+    for (size_t j = 0; j < K; ++j) {
+        centerShifts[j] = distance(&previousCenters[j * dimension], j, DynamicDimension{ dimension });
+    }
+}
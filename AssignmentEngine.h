@@ -0,0 +1,378 @@
+#ifndef ASSIGNMENTENGINE_H
+#define ASSIGNMENTENGINE_H
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "Cluster.h"
+#include "Dataset.h"
+#include "Dimension.h"
+#include "DistanceKernel.h"
+#include "KMeansOptions.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+/**
+ * @class AssignmentEngine
+ * @brief Base class of the strategies that assign every sample to its nearest cluster.
+ *        An engine sets the cluster ID of each sample and collects, per cluster, the
+ *        coordinate sums and sample count needed to compute the new centers.
+ *
+ *        The hot loops are written as generic lambdas run through dispatchDimension(), so the
+ *        common dimensions get their own fully unrolled code and the others a run-time loop.
+ *
+ *        The samples are processed in blocks on a thread pool. The block layout only depends
+ *        on the number of samples and the partial sums are merged in block order, so every
+ *        engine produces bitwise identical sums for identical labels, whatever the thread count.
+ *
+ *        With a recompute interval above 1, the sums are updated incrementally between full
+ *        recomputations: a sample that keeps its cluster is not added again, and one that moves is
+ *        subtracted from the sums of its old cluster and added to those of its new one. Only the
+ *        accumulation of the sums becomes proportional to the number of reassignments; every
+ *        assignment still searches the nearest center of every sample, as the engine would anyway.
+ */
+class AssignmentEngine
+{
+public:
+
+    /**
+     * @brief Creates the engine that implements the algorithm selected in the options,
+     *        with the instruction set selected in the options.
+     *
+     * @param options The options that select the algorithm and the instruction set.
+     * @param data The samples to assign. They must outlive the engine.
+     * @param pool The thread pool used to process the blocks.
+     * @return A new engine.
+     * @throws invalid_argument If the algorithm is unknown, or is not Lloyd with a precision other than double.
+     */
+    static unique_ptr<AssignmentEngine> create(const KMeansOptions& options, Dataset& data, ThreadPool& pool);
+
+    /**
+     * @brief Constructor that binds the engine to the samples and the thread pool.
+     *
+     * @param data The samples to assign.
+     * @param pool The thread pool used to process the blocks.
+     */
+    AssignmentEngine(Dataset& data, ThreadPool& pool);
+
+    /**
+     * @brief Virtual destructor for the derived engines.
+     */
+    virtual ~AssignmentEngine();
+
+    /**
+     * @brief Assigns each sample to the nearest cluster and collects the per-cluster sums.
+     *
+     * @param clusters The clusters with their current centers. Cluster i must have the ID i + 1.
+     */
+    virtual void assign(const vector<Cluster>& clusters) = 0;
+
+    /**
+     * @brief Selects the instruction set of the distance kernel.
+     *
+     * @param instructionSet The wanted instruction set, lowered to the best supported one when needed.
+     */
+    void setInstructionSet(InstructionSet instructionSet);
+
+    /**
+     * @brief Sets how often the per-cluster sums are recomputed from every sample.
+     *
+     * @param interval The number of assignments between two full recomputations. 0 and 1 recompute
+     *        the sums at every assignment; larger values update them incrementally in between.
+     */
+    void setRecomputeInterval(size_t interval);
+
+    /**
+     * @brief Tells whether the last assignment updated the sums incrementally. Such sums may differ
+     *        from an exact recomputation by rounding errors.
+     *
+     * @return true If the sums were updated from the reassigned samples only.
+     */
+    bool hasIncrementalSums() const;
+
+    /**
+     * @brief Recomputes the per-cluster sums and counts from every sample and its current label,
+     *        without assigning the samples again. The next incremental updates start from these sums.
+     */
+    void recomputeSums();
+
+    /**
+     * @brief Returns the instruction set the distance kernel actually uses.
+     *
+     * @return The instruction set.
+     */
+    InstructionSet getInstructionSet() const;
+
+    /**
+     * @brief Returns the coordinate sums of each cluster after the last assignment.
+     *
+     * @return The sums, row-major: the D sums of cluster c start at index c * D, with c = cluster ID - 1.
+     */
+    const vector<double>& getSums() const;
+
+    /**
+     * @brief Returns the number of samples of each cluster after the last assignment.
+     *
+     * @return The sample counts, indexed by cluster ID - 1.
+     */
+    const vector<size_t>& getCounts() const;
+
+    /**
+     * @brief Returns how many sample-to-center distances the last assignment computed.
+     *
+     * @return The number of distances computed.
+     */
+    size_t getDistanceCount() const;
+
+    /**
+     * @brief Returns how many sample-to-center distances the last assignment skipped
+     *        compared with the brute-force loop, which computes samples x clusters distances.
+     *
+     * @return The number of distances skipped.
+     */
+    size_t getSkippedDistanceCount() const;
+
+    /**
+     * @brief Computes the inertia of the last assignment: the sum of the squared distances of the
+     *        samples to the centers they were assigned to. Costs one pass over the samples.
+     *
+     * @return The inertia.
+     */
+    double computeInertia() const;
+
+protected:
+
+    /**
+     * @brief Copies the centers of the clusters into the row-major centers array,
+     *        where the assignment loops can read them without going through the Cluster objects,
+     *        and caches the dimension and the column pointers of the dataset.
+     *
+     * @param clusters The clusters with their current centers.
+     * @throws invalid_argument If the centers and the samples have different dimensions, or if the
+     *         samples are stored in a reduced precision the engine does not search.
+     */
+    void loadCenters(const vector<Cluster>& clusters);
+
+    /**
+     * @brief Returns whether the engine searches samples stored in a reduced precision.
+     *        The other engines read the double columns directly and refuse such samples.
+     *
+     * @return true If the samples may be stored as floats, halves or bfloat16.
+     */
+    virtual bool supportsReducedPrecision() const;
+
+    /**
+     * @brief Copies the coordinates of one sample into a point, widened to doubles
+     *        when the samples are stored in a reduced precision.
+     *
+     * @param row The sample.
+     * @param point Receives the coordinates.
+     * @param dim The dimension object given by dispatchDimension().
+     */
+    template <typename Dim>
+    void loadPoint(size_t row, double* point, Dim dim) const
+    {
+        if (columns.empty()) {
+            data.loadSample(row, point);
+        }
+        else {
+            gatherPoint(columns.data(), row, point, dim);
+        }
+    }
+
+    /**
+     * @brief Returns the Euclidean distance between a point and a center loaded by loadCenters().
+     *        Every engine uses this exact formula so that their comparisons agree bit for bit.
+     *
+     * @param point The coordinates of the point.
+     * @param center The index of the center.
+     * @param dim The dimension object given by dispatchDimension().
+     * @return The distance.
+     */
+    template <typename Dim>
+    double distance(const double* point, size_t center, Dim dim) const
+    {
+        return sqrt(squaredDistance(point, &centers[center * dim.size()], dim));
+    }
+
+    /**
+     * @brief Returns the Euclidean distance between two centers loaded by loadCenters().
+     *
+     * @param a The index of the first center.
+     * @param b The index of the second center.
+     * @return The distance.
+     */
+    double centerDistance(size_t a, size_t b) const
+    {
+        return distance(&centers[a * dimension], b, DynamicDimension{ dimension });
+    }
+
+    /**
+     * @brief Returns the number of blocks the samples are split into.
+     *
+     * @return The number of blocks (at least 1).
+     */
+    size_t getBlockCount() const;
+
+    /**
+     * @brief Returns the first sample index of a block.
+     *
+     * @param block The block index.
+     * @return The index of the first sample of the block.
+     */
+    size_t getBlockBegin(size_t block) const;
+
+    /**
+     * @brief Clears the per-block partial sums before a new assignment.
+     *
+     * @param clusterCount The number of clusters.
+     */
+    void resetBlockSums(size_t clusterCount);
+
+    /**
+     * @brief Returns the private partial sums of one block.
+     *        For every cluster they hold the D coordinate sums followed by the sample count.
+     *
+     * @param block The block index.
+     * @return A pointer to the first partial sum of the block.
+     */
+    double* getBlockSums(size_t block);
+
+    /**
+     * @brief Adds a sample to the partial sums of a block.
+     *
+     * @param blockSums The partial sums of the block.
+     * @param clusterIndex The index of the cluster the sample is assigned to.
+     * @param point The coordinates of the sample.
+     * @param dim The dimension object given by dispatchDimension().
+     */
+    template <typename Dim>
+    static void addToBlockSums(double* blockSums, size_t clusterIndex, const double* point, Dim dim)
+    {
+        double* clusterSums = blockSums + clusterIndex * (dim.size() + 1);
+        accumulatePoint(clusterSums, point, dim);
+        clusterSums[dim.size()] += 1.0;
+    }
+
+    /**
+     * @brief Tells whether assigning a sample to a cluster changes the sums of the current assignment:
+     *        always when they are recomputed, and only for a reassigned sample when they are updated
+     *        incrementally.
+     *
+     * @param label The cluster ID of the sample before the assignment.
+     * @param clusterIndex The index of the cluster the sample is assigned to.
+     * @return true If recordAssignment() will read the coordinates of the sample.
+     */
+    bool changesSums(int label, size_t clusterIndex) const
+    {
+        return !incremental || label != static_cast<int>(clusterIndex) + 1;
+    }
+
+    /**
+     * @brief Sets the cluster ID of a sample and updates the partial sums of its block: the sample is
+     *        added to its cluster, or, when the sums are updated incrementally, moved from its previous
+     *        cluster if its cluster changed.
+     *
+     * @param blockSums The partial sums of the block.
+     * @param label The cluster ID of the sample, set to clusterIndex + 1.
+     * @param clusterIndex The index of the cluster the sample is assigned to.
+     * @param point The coordinates of the sample. Only read when changesSums() is true.
+     * @param dim The dimension object given by dispatchDimension().
+     */
+    template <typename Dim>
+    void recordAssignment(double* blockSums, int& label, size_t clusterIndex, const double* point, Dim dim) const
+    {
+        if (changesSums(label, clusterIndex)) {
+            if (incremental) {
+                double* previousSums = blockSums + static_cast<size_t>(label - 1) * (dim.size() + 1);
+                removePoint(previousSums, point, dim);
+                previousSums[dim.size()] -= 1.0;
+            }
+            addToBlockSums(blockSums, clusterIndex, point, dim);
+        }
+        label = static_cast<int>(clusterIndex) + 1;
+    }
+
+    /**
+     * @brief Records how many distances a block computed during the current assignment.
+     *
+     * @param block The block index.
+     * @param count The number of sample-to-center distances the block computed.
+     */
+    void setBlockDistanceCount(size_t block, size_t count);
+
+    /**
+     * @brief Merges the partial sums and distance counts of all blocks, in block order. Incremental
+     *        partial sums are added to the sums of the previous assignment instead of replacing them.
+     */
+    void mergeBlockSums();
+
+    /**
+     * @brief Remembers the centers loaded by loadCenters(), to measure how far they move before the next call.
+     */
+    void storeCenters();
+
+    /**
+     * @brief Computes into centerShifts how far each loaded center travelled since the last storeCenters() call.
+     */
+    void computeCenterShifts();
+
+    /** The samples to assign. */
+    Dataset& data;
+
+    /** The thread pool used to process the blocks. */
+    ThreadPool& pool;
+
+    /** The vectorized nearest-center search. */
+    DistanceKernel kernel;
+
+    /** The number of coordinates of the samples and centers, set by loadCenters(). */
+    size_t dimension;
+
+    /** The coordinate arrays of the dataset, set by loadCenters(); empty for samples stored in a reduced precision. */
+    vector<const double*> columns;
+
+    /** The centers loaded by loadCenters(), row-major (K x D). */
+    vector<double> centers;
+
+    /** For every center, the distance computed by computeCenterShifts(). */
+    vector<double> centerShifts;
+
+private:
+
+    /** The number of clusters the partial sums were last reset for. */
+    size_t sumClusterCount;
+
+    /** The partial sums of all blocks. */
+    vector<double> blockSums;
+
+    /** The coordinate sums of each cluster, row-major (K x D). */
+    vector<double> sums;
+
+    /** The number of samples of each cluster. */
+    vector<size_t> counts;
+
+    /** The number of distances each block computed. */
+    vector<size_t> blockDistanceCounts;
+
+    /** The number of assignments between two full recomputations of the sums. */
+    size_t recomputeInterval;
+
+    /** The number of incremental updates since the last full recomputation. */
+    size_t incrementalCount;
+
+    /** Whether the current partial sums are changes to the previous sums rather than new sums. */
+    bool incremental;
+
+    /** The number of samples the sums were computed for. */
+    size_t summedSampleCount;
+
+    /** The number of distances computed by the last assignment. */
+    size_t distanceCount;
+
+    /** The centers at the last storeCenters() call, row-major (K x D). */
+    vector<double> previousCenters;
+};
+
+#endif
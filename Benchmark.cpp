@@ -0,0 +1,687 @@
+/****************************************************************************
+ * @file Benchmark.cpp
+ * @brief Implementation of the Benchmark class. The data sets are generated
+ *        with a fixed seed, so every run measures the same work, and every
+ *        timing is the best of a few repetitions, on a single thread unless
+ *        the table says otherwise.
+ ****************************************************************************/
+
+#include "Benchmark.h"
+#include "BinaryDataset.h"
+#include "Dataset.h"
+#include "Dimension.h"
+#include "DistanceKernel.h"
+#include "GemmEngine.h"
+#include "HalfFloat.h"
+#include "KMeansModel.h"
+#include "LloydEngine.h"
+#include "ResultWriter.h"
+#include "Sample.h"
+#include "TextLoader.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+/** The number of times each measurement is repeated; the fastest run is reported. */
+static const int REPETITIONS = 3;
+
+/**
+ * @brief Returns the fastest of REPETITIONS runs of a function, in milliseconds.
+ *
+ * @param function The work to measure.
+ * @return double The shortest run time.
+ */
+static double measure(const function<void()>& function)
+{
+    double best = numeric_limits<double>::max();
+    for (int repetition = 0; repetition < REPETITIONS; ++repetition) {
+        auto start = chrono::steady_clock::now();
+        function();
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+    return best;
+}
+
+/**
+ * @brief Generates samples around randomly placed blob centers.
+ *
+ * @param count The number of samples.
+ * @param dimension The number of coordinates.
+ * @param blobCount The number of blobs.
+ * @param seed The seed of the random generator.
+ * @return Dataset The samples.
+ */
+static Dataset makeBlobs(size_t count, size_t dimension, size_t blobCount, unsigned int seed)
+{
+    mt19937 generator(seed);
+    uniform_real_distribution<double> position(-100.0, 100.0);
+    normal_distribution<double> noise(0.0, 10.0);
+
+    vector<double> blobs(blobCount * dimension);
+    for (double& coordinate : blobs) {
+        coordinate = position(generator);
+    }
+
+    Dataset data(dimension);
+    data.reserve(count);
+    vector<double> point(dimension);
+    for (size_t i = 0; i < count; ++i) {
+        const double* blob = &blobs[(generator() % blobCount) * dimension];
+        for (size_t d = 0; d < dimension; ++d) {
+            point[d] = blob[d] + noise(generator);
+        }
+        data.addSample(static_cast<int>(i), point.data());
+    }
+    return data;
+}
+
+/**
+ * @brief The original loader, kept as the reference of the text loader benchmark:
+ *        getline and istringstream extraction, one sample at a time.
+ *
+ * @param fileName The name of the file.
+ * @param data The dataset that receives the samples.
+ */
+static void loadWithStreams(const string& fileName, Dataset& data)
+{
+    ifstream file(fileName);
+    if (!file) {
+        throw runtime_error("File not found: " + fileName);
+    }
+
+    string line;
+    vector<double> coordinates;
+    size_t lineNumber = 0;
+    data.clear();
+    while (getline(file, line)) {
+        ++lineNumber;
+        istringstream values(line);
+
+        int index;
+        if (!(values >> index)) {
+            if (line.find_first_not_of(" \t\r") == string::npos) continue;
+            throw runtime_error("Invalid sample on line " + to_string(lineNumber) + " of " + fileName);
+        }
+
+        coordinates.clear();
+        double value;
+        while (values >> value) {
+            coordinates.push_back(value);
+        }
+
+        if (data.empty() && !coordinates.empty()) {
+            data.reset(coordinates.size());
+        }
+        if (coordinates.size() != data.getDimension() || !values.eof()) {
+            throw runtime_error("Invalid sample on line " + to_string(lineNumber) + " of " + fileName);
+        }
+        data.addSample(index, coordinates.data());
+    }
+}
+
+/**
+ * @brief The original result writer, kept as the reference of the result writer benchmark:
+ *        every row formatted with setw() and setprecision() through the file stream.
+ *
+ * @param data The labelled samples.
+ * @param fileName The name of the file.
+ */
+static void saveWithStreams(const Dataset& data, const string& fileName)
+{
+    ofstream file(fileName);
+    for (size_t i = 0; i < data.size(); ++i) {
+        const Sample sample = data[i];
+        file << "| " << setw(8) << sample.getIndex() << " | ";
+        for (size_t d = 0; d < data.getDimension(); ++d) {
+            file << setw(6) << fixed << setprecision(2) << sample.getCoordinate(d) << " | ";
+        }
+        file << setw(10) << sample.getClusterID() << " |\n";
+    }
+}
+
+/**
+ * @brief Reads a whole file.
+ *
+ * @param fileName The name of the file.
+ * @return string The contents.
+ */
+static string readFile(const string& fileName)
+{
+    ifstream file(fileName, ios::binary);
+    ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+/**
+ * @brief Tells whether two datasets hold the same indices and bitwise identical coordinates.
+ *
+ * @param a The first dataset.
+ * @param b The second dataset.
+ * @return bool True if they are identical.
+ */
+static bool identical(const Dataset& a, const Dataset& b)
+{
+    if (a.size() != b.size() || a.getDimension() != b.getDimension()) return false;
+    if (!equal(a.getIndices(), a.getIndices() + a.size(), b.getIndices())) return false;
+    for (size_t d = 0; d < a.getDimension(); ++d) {
+        if (memcmp(a.getColumn(d), b.getColumn(d), a.size() * sizeof(double)) != 0) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Constructor that sets the stream the tables are printed to.
+ *
+ * @param output The stream that receives the results.
+ */
+Benchmark::Benchmark(ostream& output)
+    : output(output)
+{
+}
+
+/**
+ * @brief Runs every benchmark.
+ */
+void Benchmark::run()
+{
+    runDistanceKernels();
+    runPrecision();
+    runBlockedDistances();
+    runTextLoader();
+    runPredict();
+    runResultWriter();
+}
+
+/**
+ * @brief Times one full nearest-center pass over synthetic data, for the original loop and for
+ *        every instruction set this processor supports. The first K samples are the centers.
+ */
+void Benchmark::runDistanceKernels()
+{
+    struct Configuration
+    {
+        size_t dimension;
+        size_t sampleCount;
+        size_t centerCount;
+    };
+    const Configuration configurations[] = {
+        { 2, 1000000, 16 }, { 2, 1000000, 64 }, { 3, 500000, 64 }, { 10, 100000, 64 },
+        { 16, 200000, 64 }, { 64, 50000, 64 }, { 128, 25000, 64 }
+    };
+
+    output << "Nearest-center search (single thread, best of " << REPETITIONS << " runs)" << endl;
+    output << "Supported instruction set: "
+        << DistanceKernel::getName(DistanceKernel::getSupportedInstructionSet()) << endl;
+    output << setw(4) << "D" << setw(10) << "Samples" << setw(5) << "K" << "  "
+        << left << setw(24) << "Kernel" << right
+        << setw(12) << "Time (ms)" << setw(12) << "Mpairs/s" << setw(10) << "Speedup" << "  Labels" << endl;
+
+    for (const Configuration& configuration : configurations) {
+        const size_t D = configuration.dimension;
+        const size_t N = configuration.sampleCount;
+        const size_t K = configuration.centerCount;
+        const Dataset data = makeBlobs(N, D, K, 42);
+
+        vector<const double*> columns(D);
+        vector<double> centers(K * D);
+        for (size_t d = 0; d < D; ++d) {
+            columns[d] = data.getColumn(d);
+            for (size_t j = 0; j < K; ++j) {
+                centers[j * D + d] = columns[d][j];
+            }
+        }
+
+        auto printRow = [&](const char* name, double milliseconds, double reference, bool agree) {
+            output << setw(4) << D << setw(10) << N << setw(5) << K << "  "
+                << left << setw(24) << name << right << fixed << setprecision(2)
+                << setw(12) << milliseconds
+                << setw(12) << (static_cast<double>(N) * K / milliseconds / 1000.0)
+                << setw(9) << (reference / milliseconds) << "x"
+                << "  " << (agree ? "same" : "DIFFERENT") << endl;
+            output.unsetf(ios::floatfield);
+        };
+
+        // The original loop: a square root for every sample-center pair
+        vector<size_t> referenceLabels(N);
+        const double referenceTime = measure([&]() {
+            dispatchDimension(D, [&](auto dim) {
+                auto point = dim.makePoint();
+                for (size_t i = 0; i < N; ++i) {
+                    gatherPoint(columns.data(), i, point.data(), dim);
+                    double minDistance = numeric_limits<double>::max();
+                    for (size_t j = 0; j < K; ++j) {
+                        double distance = sqrt(squaredDistance(point.data(), &centers[j * D], dim));
+                        if (distance < minDistance) {
+                            minDistance = distance;
+                            referenceLabels[i] = j;
+                        }
+                    }
+                }
+                });
+            });
+        printRow("Reference (sqrt/pair)", referenceTime, referenceTime, true);
+
+        const InstructionSet instructionSets[] = { InstructionSet::Scalar, InstructionSet::AVX2, InstructionSet::AVX512 };
+        for (InstructionSet instructionSet : instructionSets) {
+            const DistanceKernel kernel(instructionSet);
+            if (kernel.getInstructionSet() != instructionSet) continue;  ///< Not supported here
+
+            vector<size_t> labels(N);
+            vector<double> distances(N);
+            const double time = measure([&]() {
+                for (size_t chunk = 0; chunk < N; chunk += DistanceKernel::CHUNK_SIZE) {
+                    const size_t chunkEnd = min(N, chunk + DistanceKernel::CHUNK_SIZE);
+                    kernel.findNearest(columns.data(), D, chunk, chunkEnd, centers.data(), K,
+                        &labels[chunk], &distances[chunk]);
+                }
+                });
+            printRow(DistanceKernel::getName(instructionSet), time, referenceTime, labels == referenceLabels);
+        }
+    }
+    output << endl;
+}
+
+/**
+ * @brief Times one full nearest-center pass over synthetic data in double and in single precision,
+ *        and over half and bfloat16 samples, with every instruction set this processor supports.
+ *        The first K samples are the centers; the compact samples are converted before the timing,
+ *        as the loaders store them when the precision is chosen. The speedup and the share of labels
+ *        equal to double precision are given for each compact format.
+ */
+void Benchmark::runPrecision()
+{
+    struct Configuration
+    {
+        size_t dimension;
+        size_t sampleCount;
+        size_t centerCount;
+    };
+    const Configuration configurations[] = {
+        { 2, 4000000, 16 }, { 2, 1000000, 64 }, { 3, 1000000, 64 }, { 16, 200000, 64 }, { 64, 50000, 64 },
+        { 128, 25000, 64 }
+    };
+
+    output << "Reduced-precision nearest-center search (single thread, best of " << REPETITIONS << " runs;"
+        << " speedup over double / same labels as double)" << endl;
+    output << setw(4) << "D" << setw(10) << "Samples" << setw(5) << "K" << "  "
+        << left << setw(10) << "Kernel" << right << setw(14) << "Double (ms)"
+        << setw(20) << "Single" << setw(20) << "Half" << setw(20) << "BFloat16" << endl;
+
+    for (const Configuration& configuration : configurations) {
+        const size_t D = configuration.dimension;
+        const size_t N = configuration.sampleCount;
+        const size_t K = configuration.centerCount;
+        const Dataset data = makeBlobs(N, D, K, 42);
+
+        Dataset floatData = data, halfData = data, bfloat16Data = data;
+        floatData.setPrecision(Precision::Single);
+        halfData.setPrecision(Precision::Half);
+        bfloat16Data.setPrecision(Precision::BFloat16);
+
+        vector<const double*> columns(D);
+        vector<const float*> floatColumns(D);
+        vector<const Half*> halfColumns(D);
+        vector<const BFloat16*> bfloat16Columns(D);
+        vector<double> centers(K * D);
+        for (size_t d = 0; d < D; ++d) {
+            columns[d] = data.getColumn(d);
+            floatColumns[d] = floatData.getStoredColumn<float>(d);
+            halfColumns[d] = halfData.getStoredColumn<Half>(d);
+            bfloat16Columns[d] = bfloat16Data.getStoredColumn<BFloat16>(d);
+            for (size_t j = 0; j < K; ++j) {
+                centers[j * D + d] = columns[d][j];
+            }
+        }
+        const vector<float> floatCenters(centers.begin(), centers.end());
+
+        const InstructionSet instructionSets[] = { InstructionSet::Scalar, InstructionSet::AVX2, InstructionSet::AVX512 };
+        for (InstructionSet instructionSet : instructionSets) {
+            const DistanceKernel kernel(instructionSet);
+            if (kernel.getInstructionSet() != instructionSet) continue;  ///< Not supported here
+
+            vector<size_t> labels(N), compactLabels(N);
+            vector<double> distances(N);
+            vector<float> floatDistances(N);
+            const double doubleTime = measure([&]() {
+                for (size_t chunk = 0; chunk < N; chunk += DistanceKernel::CHUNK_SIZE) {
+                    kernel.findNearest(columns.data(), D, chunk, min(N, chunk + DistanceKernel::CHUNK_SIZE),
+                        centers.data(), K, &labels[chunk], &distances[chunk]);
+                }
+                });
+            output << setw(4) << D << setw(10) << N << setw(5) << K << "  "
+                << left << setw(10) << DistanceKernel::getName(instructionSet) << right << fixed << setprecision(2)
+                << setw(14) << doubleTime;
+
+            // Times one compact format and prints its speedup and its share of labels equal to double precision
+            auto runCompact = [&](auto compactColumns) {
+                const double time = measure([&]() {
+                    for (size_t chunk = 0; chunk < N; chunk += DistanceKernel::CHUNK_SIZE) {
+                        kernel.findNearest(compactColumns, D, chunk, min(N, chunk + DistanceKernel::CHUNK_SIZE),
+                            floatCenters.data(), K, &compactLabels[chunk], &floatDistances[chunk]);
+                    }
+                    });
+                size_t same = 0;
+                for (size_t i = 0; i < N; ++i) {
+                    same += labels[i] == compactLabels[i];
+                }
+                output << setw(10) << setprecision(2) << (doubleTime / time) << "x"
+                    << setw(8) << setprecision(3) << (100.0 * static_cast<double>(same) / static_cast<double>(N)) << "%";
+            };
+            runCompact(floatColumns.data());
+            runCompact(halfColumns.data());
+            runCompact(bfloat16Columns.data());
+            output << endl;
+            output.unsetf(ios::floatfield);
+        }
+    }
+    output << endl;
+}
+
+/**
+ * @brief Times one assignment of synthetic data with the Lloyd engine and with the GEMM engine, on a
+ *        single thread and with every instruction set this processor supports. The first K samples are
+ *        the centers; each engine assigns once before the timing, so the GEMM engine has its norms.
+ *        The labels and the sums of the clusters must be the same.
+ */
+void Benchmark::runBlockedDistances()
+{
+    struct Configuration
+    {
+        size_t dimension;
+        size_t sampleCount;
+        size_t centerCount;
+    };
+    const Configuration configurations[] = {
+        { 32, 100000, 64 }, { 64, 50000, 64 }, { 128, 25000, 64 }, { 128, 25000, 256 }, { 300, 10000, 64 }
+    };
+
+    ThreadPool pool(1);
+    output << "Blocked distances of the GEMM engine (single thread, best of " << REPETITIONS << " runs)" << endl;
+    output << setw(4) << "D" << setw(10) << "Samples" << setw(5) << "K" << "  "
+        << left << setw(10) << "Kernel" << right
+        << setw(12) << "Lloyd (ms)" << setw(12) << "GEMM (ms)" << setw(12) << "Mpairs/s"
+        << setw(10) << "Speedup" << "  Results" << endl;
+
+    for (const Configuration& configuration : configurations) {
+        const size_t D = configuration.dimension;
+        const size_t N = configuration.sampleCount;
+        const size_t K = configuration.centerCount;
+        Dataset data = makeBlobs(N, D, K, 11);
+
+        vector<Cluster> clusters;
+        for (size_t k = 0; k < K; ++k) {
+            vector<double> center(D);
+            for (size_t d = 0; d < D; ++d) {
+                center[d] = data.getColumn(d)[k];
+            }
+            clusters.emplace_back(static_cast<int>(k) + 1, center);
+        }
+
+        const InstructionSet instructionSets[] = { InstructionSet::AVX2, InstructionSet::AVX512 };
+        for (InstructionSet instructionSet : instructionSets) {
+            if (DistanceKernel(instructionSet).getInstructionSet() != instructionSet) continue;  ///< Not supported here
+
+            LloydEngine lloyd(data, pool);
+            lloyd.setInstructionSet(instructionSet);
+            lloyd.assign(clusters);
+            const double lloydTime = measure([&]() { lloyd.assign(clusters); });
+            const vector<int> referenceLabels(data.getLabels(), data.getLabels() + N);
+
+            GemmEngine gemm(data, pool);
+            gemm.setInstructionSet(instructionSet);
+            gemm.assign(clusters);
+            const double gemmTime = measure([&]() { gemm.assign(clusters); });
+            const bool agree = equal(referenceLabels.begin(), referenceLabels.end(), data.getLabels())
+                && gemm.getSums() == lloyd.getSums() && gemm.getCounts() == lloyd.getCounts();
+
+            output << setw(4) << D << setw(10) << N << setw(5) << K << "  "
+                << left << setw(10) << DistanceKernel::getName(instructionSet) << right << fixed << setprecision(2)
+                << setw(12) << lloydTime << setw(12) << gemmTime
+                << setw(12) << (static_cast<double>(N) * K / gemmTime / 1000.0)
+                << setw(9) << (lloydTime / gemmTime) << "x"
+                << "  " << (agree ? "same" : "DIFFERENT") << endl;
+            output.unsetf(ios::floatfield);
+        }
+    }
+    output << endl;
+}
+
+/**
+ * @brief Writes generated samples to a temporary file in the input format and loads it with both
+ *        loaders, then loads the same samples from the binary format. The file is written with
+ *        3 decimals, like the usual inputs, and once with 17 significant digits, which sends most
+ *        numbers through the slow path of the parser.
+ */
+void Benchmark::runTextLoader()
+{
+    struct Configuration
+    {
+        size_t dimension;
+        size_t sampleCount;
+        int precision;
+    };
+    const Configuration configurations[] = {
+        { 2, 2000000, 3 }, { 16, 250000, 3 }, { 2, 500000, 17 }
+    };
+
+    ThreadPool pool(0);
+    const TextLoader loader(pool);
+    const string fileName = (filesystem::temp_directory_path() / "kmeans_benchmark_input.txt").string();
+    const string binaryFileName = (filesystem::temp_directory_path() / "kmeans_benchmark_input.kmds").string();
+
+    output << "Text loading (best of " << REPETITIONS << " runs, " << pool.getThreadCount() << " threads)" << endl;
+    output << setw(4) << "D" << setw(10) << "Samples" << setw(8) << "Digits" << setw(10) << "MB" << "  "
+        << left << setw(24) << "Loader" << right
+        << setw(12) << "Time (ms)" << setw(12) << "MB/s" << setw(10) << "Speedup" << "  Samples" << endl;
+
+    for (const Configuration& configuration : configurations) {
+        const Dataset generated = makeBlobs(configuration.sampleCount, configuration.dimension, 16, 42);
+        {
+            ofstream file(fileName);
+            if (configuration.precision <= 6) {
+                file << fixed;
+            }
+            file << setprecision(configuration.precision);
+            for (size_t i = 0; i < generated.size(); ++i) {
+                file << generated.getIndices()[i];
+                for (size_t d = 0; d < generated.getDimension(); ++d) {
+                    file << ' ' << generated.getColumn(d)[i];
+                }
+                file << '\n';
+            }
+        }
+        const double megabytes = static_cast<double>(filesystem::file_size(fileName)) / (1 << 20);
+
+        auto printRow = [&](const char* name, double milliseconds, double reference, bool agree) {
+            output << setw(4) << configuration.dimension << setw(10) << configuration.sampleCount
+                << setw(8) << configuration.precision << fixed << setprecision(1) << setw(10) << megabytes << "  "
+                << left << setw(24) << name << right << setprecision(2)
+                << setw(12) << milliseconds
+                << setw(12) << (megabytes / milliseconds * 1000.0)
+                << setw(9) << (reference / milliseconds) << "x"
+                << "  " << (agree ? "same" : "DIFFERENT") << endl;
+            output.unsetf(ios::floatfield);
+        };
+
+        Dataset reference, mapped;
+        const double referenceTime = measure([&]() { loadWithStreams(fileName, reference); });
+        printRow("ifstream (original)", referenceTime, referenceTime, true);
+        const double mappedTime = measure([&]() { loader.load(fileName, mapped); });
+        printRow("Mapped, parallel", mappedTime, referenceTime, identical(reference, mapped));
+
+        // The same samples in the binary format: no parsing at all, the pages are read on first use
+        BinaryDataset::save(reference, binaryFileName);
+        Dataset binary;
+        const double binaryTime = measure([&]() { BinaryDataset::load(binaryFileName, binary); });
+        printRow("Binary, mapped", binaryTime, referenceTime, identical(reference, binary));
+    }
+
+    filesystem::remove(fileName);
+    filesystem::remove(binaryFileName);
+    output << endl;
+}
+
+/**
+ * @brief Labels generated row-major points with a model whose centers are the first K points:
+ *        first with a per-point loop over the centers, then with KMeansModel::predict() on the
+ *        calling thread and on a pool of all the hardware threads.
+ */
+void Benchmark::runPredict()
+{
+    struct Configuration
+    {
+        size_t dimension;
+        size_t pointCount;
+        size_t centerCount;
+    };
+    const Configuration configurations[] = { { 2, 2000000, 16 }, { 16, 500000, 64 }, { 64, 100000, 256 } };
+
+    ThreadPool pool(0);
+    output << "Batch prediction of row-major points (best of " << REPETITIONS << " runs, "
+        << pool.getThreadCount() << " threads in the pool)" << endl;
+    output << setw(4) << "D" << setw(10) << "Points" << setw(5) << "K" << "  "
+        << left << setw(24) << "Method" << right
+        << setw(12) << "Time (ms)" << setw(12) << "Mpoints/s" << setw(10) << "Speedup" << "  Labels" << endl;
+
+    for (const Configuration& configuration : configurations) {
+        const size_t D = configuration.dimension;
+        const size_t N = configuration.pointCount;
+        const size_t K = configuration.centerCount;
+        const Dataset data = makeBlobs(N, D, K, 7);
+
+        vector<double> points(N * D);
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t d = 0; d < D; ++d) {
+                points[i * D + d] = data.getColumn(d)[i];
+            }
+        }
+        const KMeansModel model(points.data(), K, D);
+
+        auto printRow = [&](const char* name, double milliseconds, double reference, bool agree) {
+            output << setw(4) << D << setw(10) << N << setw(5) << K << "  "
+                << left << setw(24) << name << right << fixed << setprecision(2)
+                << setw(12) << milliseconds
+                << setw(12) << (static_cast<double>(N) / milliseconds / 1000.0)
+                << setw(9) << (reference / milliseconds) << "x"
+                << "  " << (agree ? "same" : "DIFFERENT") << endl;
+            output.unsetf(ios::floatfield);
+        };
+
+        // A plain loop over the centers for every point, as a first predict() would be written
+        vector<int> referenceLabels(N);
+        const double referenceTime = measure([&]() {
+            const double* centers = model.getCenters();
+            for (size_t i = 0; i < N; ++i) {
+                const double* point = &points[i * D];
+                double minDistance = numeric_limits<double>::max();
+                for (size_t j = 0; j < K; ++j) {
+                    double distance = 0.0;
+                    for (size_t d = 0; d < D; ++d) {
+                        const double difference = point[d] - centers[j * D + d];
+                        distance += difference * difference;
+                    }
+                    if (distance < minDistance) {
+                        minDistance = distance;
+                        referenceLabels[i] = static_cast<int>(j) + 1;
+                    }
+                }
+            }
+            });
+        printRow("Per-point loop", referenceTime, referenceTime, true);
+
+        vector<int> labels(N);
+        vector<double> distances(N);
+        const double serialTime = measure([&]() { model.predict(points.data(), N, labels.data(), distances.data()); });
+        printRow("Model, 1 thread", serialTime, referenceTime, labels == referenceLabels);
+
+        fill(labels.begin(), labels.end(), 0);
+        const double parallelTime = measure([&]() { model.predict(points.data(), N, labels.data(), distances.data(), pool); });
+        printRow("Model, thread pool", parallelTime, referenceTime, labels == referenceLabels);
+    }
+    output << endl;
+}
+
+/**
+ * @brief Writes labelled generated samples as the result table, first with the original per-row
+ *        stream formatting, then with ResultWriter on the calling thread and on a pool of all the
+ *        hardware threads. The rows of the table must be the same bytes.
+ */
+void Benchmark::runResultWriter()
+{
+    struct Configuration
+    {
+        size_t dimension;
+        size_t sampleCount;
+    };
+    const Configuration configurations[] = { { 2, 2000000 }, { 16, 250000 } };
+
+    ThreadPool serial(1);
+    ThreadPool pool(0);
+    const string referenceFileName = (filesystem::temp_directory_path() / "kmeans_benchmark_reference.txt").string();
+    const string fileName = (filesystem::temp_directory_path() / "kmeans_benchmark_output.txt").string();
+
+    output << "Result table writing (best of " << REPETITIONS << " runs, " << pool.getThreadCount()
+        << " threads in the pool)" << endl;
+    output << setw(4) << "D" << setw(10) << "Samples" << setw(10) << "MB" << "  "
+        << left << setw(24) << "Writer" << right
+        << setw(12) << "Time (ms)" << setw(12) << "MB/s" << setw(10) << "Speedup" << "  Rows" << endl;
+
+    for (const Configuration& configuration : configurations) {
+        Dataset data = makeBlobs(configuration.sampleCount, configuration.dimension, 16, 11);
+        int* labels = data.getLabels();
+        for (size_t i = 0; i < data.size(); ++i) {
+            labels[i] = static_cast<int>(i % 16) + 1;
+        }
+
+        const double referenceTime = measure([&]() { saveWithStreams(data, referenceFileName); });
+        const string reference = readFile(referenceFileName);
+        const double megabytes = static_cast<double>(reference.size()) / (1 << 20);
+
+        auto printRow = [&](const char* name, double milliseconds, bool agree) {
+            output << setw(4) << configuration.dimension << setw(10) << configuration.sampleCount
+                << fixed << setprecision(1) << setw(10) << megabytes << "  "
+                << left << setw(24) << name << right << setprecision(2)
+                << setw(12) << milliseconds
+                << setw(12) << (megabytes / milliseconds * 1000.0)
+                << setw(9) << (referenceTime / milliseconds) << "x"
+                << "  " << (agree ? "same" : "DIFFERENT") << endl;
+            output.unsetf(ios::floatfield);
+        };
+
+        // The writer frames the rows with the table header and footer: compare the rows only
+        auto sameRows = [&]() {
+            const string written = readFile(fileName);
+            size_t begin = 0;
+            for (int line = 0; line < 3; ++line) {
+                begin = written.find('\n', begin) + 1;
+            }
+            const size_t end = written.rfind('\n', written.size() - 2) + 1;
+            return written.compare(begin, end - begin, reference) == 0;
+        };
+
+        printRow("ofstream (original)", referenceTime, true);
+        const double serialTime = measure([&]() { ResultWriter(data, serial).write(fileName, ResultFormat::Table); });
+        printRow("ResultWriter, 1 thread", serialTime, sameRows());
+        const double parallelTime = measure([&]() { ResultWriter(data, pool).write(fileName, ResultFormat::Table); });
+        printRow("ResultWriter, pool", parallelTime, sameRows());
+    }
+
+    filesystem::remove(referenceFileName);
+    filesystem::remove(fileName);
+    output << endl;
+}
@@ -0,0 +1,73 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <iostream>
+
+using namespace std;
+
+/**
+ * @class Benchmark
+ * @brief Measurements of the performance-critical parts of the program on synthetic data.
+ *        The program runs them instead of the clustering when it is started with --benchmark.
+ *        Each measurement prints one table row per configuration with the time, the throughput,
+ *        the speedup over the reference implementation and whether the results agree with it.
+ */
+class Benchmark
+{
+public:
+
+    /**
+     * @brief Constructor that sets the stream the tables are printed to.
+     *
+     * @param output The stream that receives the results.
+     */
+    explicit Benchmark(ostream& output);
+
+    /**
+     * @brief Runs every benchmark.
+     */
+    void run();
+
+    /**
+     * @brief Compares the nearest-center search of every supported instruction set with the
+     *        original loop (a square root per sample-center pair) in 2D and in higher dimensions.
+     */
+    void runDistanceKernels();
+
+    /**
+     * @brief Compares the single-precision, half and bfloat16 nearest-center searches of every supported
+     *        instruction set with the double-precision one, with the share of the samples that get the same label.
+     */
+    void runPrecision();
+
+    /**
+     * @brief Compares the assignment of the GEMM engine, which screens the centers with a blocked matrix
+     *        product, with the brute-force search of the Lloyd engine in high dimensions, on one thread.
+     */
+    void runBlockedDistances();
+
+    /**
+     * @brief Compares the memory-mapped parallel text loader and the binary format with the
+     *        original ifstream loader on generated input files, in megabytes of text per second.
+     */
+    void runTextLoader();
+
+    /**
+     * @brief Compares the batch prediction of KMeansModel, on one thread and on all threads, with
+     *        a per-point loop over the centers, in points labelled per second.
+     */
+    void runPredict();
+
+    /**
+     * @brief Compares the result table written by ResultWriter, on one thread and on all threads,
+     *        with the original per-row stream formatting, in megabytes written per second.
+     */
+    void runResultWriter();
+
+private:
+
+    /** The stream that receives the results. */
+    ostream& output;
+};
+
+#endif
@@ -0,0 +1,291 @@
+/****************************************************************************
+ * @file BinaryDataset.cpp
+ * @brief Implementation of the BinaryDataset class: the header checks, the
+ *        zero-copy memory-mapped loading, the byte-swapping fallback for
+ *        files of the other byte order, and the writer.
+ ****************************************************************************/
+
+#include "BinaryDataset.h"
+#include "ByteOrder.h"
+#include "MappedFile.h"
+#include "TextLoader.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+/** The magic that starts every binary dataset file. */
+static const char MAGIC[8] = { 'K', 'M', 'E', 'A', 'N', 'S', 'D', 'S' };
+
+/** The byte order mark as written by a machine of the same byte order. */
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+/** The alignment of the offsets and of the column stride. */
+static const uint64_t ALIGNMENT = 64;
+
+/**
+ * The largest dimension of a file. Without samples the columns take no room, so the size of the
+ * file cannot bound the dimension; this keeps the per-column tables of a malformed header small.
+ */
+static const uint64_t MAX_DIMENSION = uint64_t(1) << 20;
+
+static_assert(sizeof(BinaryDatasetHeader) == 64, "The header must be 64 bytes long");
+static_assert(sizeof(int) == sizeof(int32_t), "The sample indices are stored as 32-bit integers");
+
+/**
+ * @brief Rounds a size up to the alignment of the format.
+ *
+ * @param size The size in bytes.
+ * @return uint64_t The smallest multiple of ALIGNMENT not below size.
+ */
+static uint64_t alignUp(uint64_t size)
+{
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+/**
+ * @brief Tells whether a file starts with the magic of the binary format.
+ *
+ * @param fileName The name of the file.
+ * @return true If the file is a binary dataset.
+ */
+bool BinaryDataset::isBinaryFile(const string& fileName)
+{
+    ifstream file(fileName, ios::binary);
+    char magic[sizeof(MAGIC)];
+    return file.read(magic, sizeof(magic)) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+/**
+ * @brief Decodes and checks the header of a binary dataset file.
+ *
+ * @param bytes The first bytes of the file (at least min(fileSize, 64)).
+ * @param fileSize The size of the file in bytes.
+ * @param fileName The name of the file, for the error messages.
+ * @param swapped Receives whether the file was written with the other byte order.
+ * @return BinaryDatasetHeader The header in the byte order of this machine.
+ * @throws runtime_error If the file is not a valid binary dataset.
+ */
+BinaryDatasetHeader BinaryDataset::readHeader(const char* bytes, uint64_t fileSize, const string& fileName, bool& swapped)
+{
+    auto invalid = [&](const string& reason) {
+        return runtime_error("Invalid binary dataset " + fileName + ": " + reason);
+    };
+
+    BinaryDatasetHeader header;
+    if (fileSize < sizeof(header)) {
+        throw invalid("the file is shorter than the header");
+    }
+    memcpy(&header, bytes, sizeof(header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw invalid("wrong magic");
+    }
+
+    swapped = header.byteOrderMark == swapBytes(BYTE_ORDER_MARK);
+    if (!swapped && header.byteOrderMark != BYTE_ORDER_MARK) {
+        throw invalid("unknown byte order");
+    }
+    if (swapped) {
+        header.version = swapBytes(header.version);
+        header.sampleCount = swapBytes(header.sampleCount);
+        header.dimension = swapBytes(header.dimension);
+        header.scalarType = swapBytes(header.scalarType);
+        header.scalarSize = swapBytes(header.scalarSize);
+        header.indexOffset = swapBytes(header.indexOffset);
+        header.columnOffset = swapBytes(header.columnOffset);
+        header.columnStride = swapBytes(header.columnStride);
+    }
+
+    if (header.version != VERSION) {
+        throw invalid("unsupported version " + to_string(header.version));
+    }
+    if (header.scalarType != static_cast<uint32_t>(ScalarType::Float64) || header.scalarSize != sizeof(double)) {
+        throw invalid("unsupported scalar type " + to_string(header.scalarType));
+    }
+
+    // Checked apart from the layout: a file without samples does not bound the dimension
+    const uint64_t N = header.sampleCount;
+    const uint64_t D = header.dimension;
+    if (D == 0 || D > MAX_DIMENSION) {
+        throw invalid("unsupported dimension " + to_string(D));
+    }
+
+    // Every region must be aligned and lie inside the file; the divisions avoid overflows
+    if (header.indexOffset % ALIGNMENT != 0 || header.columnOffset % ALIGNMENT != 0
+        || header.columnStride % ALIGNMENT != 0
+        || N > fileSize / sizeof(int32_t) || header.columnStride < N * sizeof(double)
+        || header.indexOffset > fileSize || header.indexOffset + N * sizeof(int32_t) > header.columnOffset
+        || header.columnOffset > fileSize
+        || (header.columnStride > 0 && D > (fileSize - header.columnOffset) / header.columnStride)) {
+        throw invalid("the layout does not match the size of the file");
+    }
+    return header;
+}
+
+/**
+ * @brief Makes a dataset a view of a memory-mapped binary file, or a byte-swapped or rounded copy of it.
+ *
+ * @param fileName The name of the file.
+ * @param data The dataset that receives the samples.
+ * @param precision The type the coordinates are stored in.
+ * @throws runtime_error If the file is not a valid binary dataset.
+ */
+void BinaryDataset::load(const string& fileName, Dataset& data, Precision precision)
+{
+    auto file = make_shared<MappedFile>(fileName);
+    bool swapped = false;
+    const BinaryDatasetHeader header = readHeader(file->data(), file->size(), fileName, swapped);
+    const uint64_t N = header.sampleCount;
+    const uint64_t D = header.dimension;
+
+    const char* base = file->data();
+    const int* indices = reinterpret_cast<const int*>(base + header.indexOffset);
+    vector<const double*> columns(D);
+    for (size_t d = 0; d < D; ++d) {
+        columns[d] = reinterpret_cast<const double*>(base + header.columnOffset + d * header.columnStride);
+    }
+
+    if (!swapped && precision == Precision::Double) {
+        data.attach(N, indices, columns, move(file));  ///< Zero copy: the dataset keeps the mapping alive
+        return;
+    }
+
+    // The other byte order or a reduced precision: copy every value, reversing its bytes and rounding it;
+    // the mapping is released at the end, so the doubles never stay in memory beside the copy
+    data.reset(D, precision);
+    data.resize(N);
+    copy(indices, indices + N, data.getWritableIndices());
+    if (swapped) {
+        swapArray(data.getWritableIndices(), N);
+    }
+    Dataset::visitPrecision(precision, [&](auto* type) {
+        using T = remove_pointer_t<decltype(type)>;
+        for (size_t d = 0; d < D; ++d) {
+            T* target = data.getWritableStoredColumn<T>(d);
+            for (size_t i = 0; i < N; ++i) {
+                target[i] = Dataset::narrow<T>(swapped ? swapBytes(columns[d][i]) : columns[d][i]);
+            }
+        }
+        });
+}
+
+/**
+ * @brief Reads a range of samples of a binary dataset file into a dataset, without mapping the file.
+ *
+ * @param file The file, opened in binary mode.
+ * @param header The header returned by readHeader().
+ * @param swapped Whether the file was written with the other byte order.
+ * @param first The first sample to read.
+ * @param count The number of samples to read.
+ * @param data The dataset that receives the samples; it is resized to count samples.
+ * @throws runtime_error If the file cannot be read.
+ */
+void BinaryDataset::readSamples(istream& file, const BinaryDatasetHeader& header, bool swapped,
+    size_t first, size_t count, Dataset& data)
+{
+    if (data.getDimension() != header.dimension || data.isView() || data.getPrecision() != Precision::Double) {
+        data.reset(static_cast<size_t>(header.dimension));
+    }
+    data.resize(count);
+
+    auto readAt = [&](uint64_t offset, void* target, size_t size) {
+        file.seekg(static_cast<streamoff>(offset));
+        if (!file.read(static_cast<char*>(target), static_cast<streamsize>(size))) {
+            throw runtime_error("Cannot read the samples of a binary dataset file");
+        }
+    };
+
+    readAt(header.indexOffset + first * sizeof(int32_t), data.getWritableIndices(), count * sizeof(int32_t));
+    for (size_t d = 0; d < header.dimension; ++d) {
+        readAt(header.columnOffset + d * header.columnStride + first * sizeof(double),
+            data.getWritableColumn(d), count * sizeof(double));
+    }
+
+    if (swapped) {
+        swapArray(data.getWritableIndices(), count);
+        for (size_t d = 0; d < header.dimension; ++d) {
+            swapArray(data.getWritableColumn(d), count);
+        }
+    }
+}
+
+/**
+ * @brief Writes a dataset in the binary format. Samples stored in a reduced precision are widened
+ *        to doubles a column at a time.
+ *
+ * @param data The samples to write.
+ * @param fileName The name of the file.
+ * @throws runtime_error If the file cannot be written or the dataset has more than 2^20 dimensions.
+ */
+void BinaryDataset::save(const Dataset& data, const string& fileName)
+{
+    const uint64_t N = data.size();
+    const uint64_t D = data.getDimension();
+    if (D > MAX_DIMENSION) {
+        throw runtime_error("Cannot write " + fileName + ": binary datasets have at most 2^20 dimensions");
+    }
+
+    BinaryDatasetHeader header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrderMark = BYTE_ORDER_MARK;
+    header.sampleCount = N;
+    header.dimension = D;
+    header.scalarType = static_cast<uint32_t>(ScalarType::Float64);
+    header.scalarSize = sizeof(double);
+    header.indexOffset = alignUp(sizeof(header));
+    header.columnOffset = header.indexOffset + alignUp(N * sizeof(int32_t));
+    header.columnStride = alignUp(N * sizeof(double));
+
+    ofstream file(fileName, ios::binary);
+    if (!file) {
+        throw runtime_error("Cannot write " + fileName);
+    }
+
+    const char padding[ALIGNMENT] = {};
+    auto writePadded = [&](const void* values, uint64_t size) {
+        file.write(static_cast<const char*>(values), static_cast<streamsize>(size));
+        file.write(padding, static_cast<streamsize>(alignUp(size) - size));
+    };
+
+    writePadded(&header, sizeof(header));
+    writePadded(data.getIndices(), N * sizeof(int32_t));
+    if (data.getPrecision() == Precision::Double) {
+        for (size_t d = 0; d < D; ++d) {
+            writePadded(data.getColumn(d), N * sizeof(double));
+        }
+    }
+    else {
+        vector<double> column(N);
+        for (size_t d = 0; d < D; ++d) {
+            for (size_t i = 0; i < N; ++i) {
+                column[i] = data.getCoordinate(d, i);
+            }
+            writePadded(column.data(), N * sizeof(double));
+        }
+    }
+
+    if (!file) {
+        throw runtime_error("Cannot write " + fileName);
+    }
+}
+
+/**
+ * @brief Converts a file of the text input format into the binary format.
+ *
+ * @param textFileName The name of the text file.
+ * @param binaryFileName The name of the binary file to write.
+ * @param pool The thread pool used to parse the text.
+ * @return size_t The number of samples converted.
+ */
+size_t BinaryDataset::convertText(const string& textFileName, const string& binaryFileName, ThreadPool& pool)
+{
+    Dataset data;
+    TextLoader(pool).load(textFileName, data);
+    save(data, binaryFileName);
+    return data.size();
+}
@@ -0,0 +1,132 @@
+#ifndef BINARYDATASET_H
+#define BINARYDATASET_H
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include "Dataset.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+/**
+ * @enum ScalarType
+ * @brief The type of the coordinates stored in a binary dataset file.
+ */
+enum class ScalarType : uint32_t
+{
+    Float64 = 1  ///< IEEE 754 double precision.
+};
+
+/**
+ * @struct BinaryDatasetHeader
+ * @brief The 64-byte header at the start of a binary dataset file.
+ *
+ *        The file layout is:
+ *        - the header;
+ *        - at indexOffset, the sampleCount sample indices as 32-bit integers;
+ *        - at columnOffset, one column per dimension, each columnStride bytes apart, holding the
+ *          sampleCount coordinates of that dimension.
+ *        Every offset and the stride are multiples of 64, so a memory-mapped file (whose mapping
+ *        starts on a page boundary) has its columns aligned exactly like an in-memory Dataset.
+ *        All the values are stored in the byte order of the writer, which byteOrderMark tells.
+ */
+struct BinaryDatasetHeader
+{
+    char magic[8];          ///< "KMEANSDS".
+    uint32_t version;       ///< The format version, currently 1.
+    uint32_t byteOrderMark; ///< 0x01020304 written in the byte order of the file.
+    uint64_t sampleCount;   ///< The number of samples (N).
+    uint64_t dimension;     ///< The number of coordinates of every sample (D), from 1 to 2^20.
+    uint32_t scalarType;    ///< The ScalarType of the coordinates.
+    uint32_t scalarSize;    ///< The size of one coordinate in bytes.
+    uint64_t indexOffset;   ///< The position of the sample indices.
+    uint64_t columnOffset;  ///< The position of the first column.
+    uint64_t columnStride;  ///< The distance between two columns in bytes.
+};
+
+/**
+ * @class BinaryDataset
+ * @brief Reading and writing of the binary dataset format described by BinaryDatasetHeader.
+ *        Loading memory-maps the file and makes the Dataset a view of its columns, so a file of
+ *        any size is ready to cluster without a parse step; the pages are read on first access.
+ */
+class BinaryDataset
+{
+public:
+
+    /** The current format version. */
+    static const uint32_t VERSION = 1;
+
+    /**
+     * @brief Tells whether a file starts with the magic of the binary format.
+     *
+     * @param fileName The name of the file.
+     * @return true If the file is a binary dataset; false if it is not or cannot be read.
+     */
+    static bool isBinaryFile(const string& fileName);
+
+    /**
+     * @brief Decodes and checks the header of a binary dataset file.
+     *
+     * @param bytes The first bytes of the file (at least min(fileSize, 64)).
+     * @param fileSize The size of the file in bytes.
+     * @param fileName The name of the file, for the error messages.
+     * @param swapped Receives whether the file was written with the other byte order.
+     * @return The header, converted to the byte order of this machine.
+     * @throws runtime_error If the file is not a valid binary dataset, has an unsupported version
+     *         or scalar type, a dimension of 0 or above 2^20, or is shorter than its header says.
+     */
+    static BinaryDatasetHeader readHeader(const char* bytes, uint64_t fileSize, const string& fileName, bool& swapped);
+
+    /**
+     * @brief Makes a dataset a view of a memory-mapped binary file. Files written with the other
+     *        byte order, and samples stored in a reduced precision, are converted into owned columns
+     *        instead.
+     *
+     * @param fileName The name of the file.
+     * @param data The dataset that receives the samples.
+     * @param precision The type the coordinates are stored in.
+     * @throws runtime_error If the file cannot be mapped, is not a binary dataset, has an
+     *         unsupported version or scalar type, or is shorter than its header says.
+     */
+    static void load(const string& fileName, Dataset& data, Precision precision = Precision::Double);
+
+    /**
+     * @brief Writes a dataset in the binary format, in the byte order of this machine, always with
+     *        double coordinates.
+     *
+     * @param data The samples to write.
+     * @param fileName The name of the file.
+     * @throws runtime_error If the file cannot be written or the dataset has more than 2^20 dimensions.
+     */
+    static void save(const Dataset& data, const string& fileName);
+
+    /**
+     * @brief Reads a range of samples of a binary dataset file into owned double columns of a dataset,
+     *        with one read per column, for data sets that do not fit in memory.
+     *
+     * @param file The file, opened in binary mode.
+     * @param header The header returned by readHeader().
+     * @param swapped Whether the file was written with the other byte order.
+     * @param first The first sample to read.
+     * @param count The number of samples to read.
+     * @param data The dataset that receives the samples; it is resized to count samples.
+     * @throws runtime_error If the file cannot be read.
+     */
+    static void readSamples(istream& file, const BinaryDatasetHeader& header, bool swapped,
+        size_t first, size_t count, Dataset& data);
+
+    /**
+     * @brief Converts a file of the text input format into the binary format.
+     *
+     * @param textFileName The name of the text file.
+     * @param binaryFileName The name of the binary file to write.
+     * @param pool The thread pool used to parse the text.
+     * @return The number of samples converted.
+     * @throws runtime_error If a file cannot be read or written or the text is invalid.
+     */
+    static size_t convertText(const string& textFileName, const string& binaryFileName, ThreadPool& pool);
+};
+
+#endif
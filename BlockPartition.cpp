@@ -0,0 +1,60 @@
+/****************************************************************************
+ * @file BlockPartition.cpp
+ * @brief Implementation of the BlockPartition class, the thread-count
+ *        independent block layout shared by all the parallel loops.
+ ****************************************************************************/
+
+#include "BlockPartition.h"
+#include <algorithm>
+
+using namespace std;
+
+/** The smallest number of samples worth giving to one parallel block. */
+static const size_t MIN_BLOCK_SIZE = 4096;
+
+/** The largest number of blocks, which bounds the memory used for per-block partial results. */
+static const size_t MAX_BLOCK_COUNT = 256;
+
+/**
+ * @brief Constructor that computes the layout for a number of samples.
+ *
+ * @param itemCount The number of samples to split.
+ */
+BlockPartition::BlockPartition(size_t itemCount)
+    : itemCount(itemCount)
+{
+    size_t blocks = (itemCount + MIN_BLOCK_SIZE - 1) / MIN_BLOCK_SIZE;
+    blockCount = max<size_t>(1, min(blocks, MAX_BLOCK_COUNT));
+}
+
+/**
+ * @brief Returns the number of blocks.
+ *
+ * @return size_t The number of blocks (at least 1).
+ */
+size_t BlockPartition::getBlockCount() const
+{
+    return blockCount;
+}
+
+/**
+ * @brief Returns the first sample of a block.
+ *
+ * @param block The block index.
+ * @return size_t The index of the first sample of the block.
+ */
+size_t BlockPartition::getBlockBegin(size_t block) const
+{
+    return block * itemCount / blockCount;
+}
+
+/**
+ * @brief Returns one past the last sample of a block.
+ *
+ * @param block The block index.
+ * @return size_t The index following the last sample of the block.
+ */
+size_t BlockPartition::getBlockEnd(size_t block) const
+{
+    return getBlockBegin(block + 1);
+}
@@ -0,0 +1,57 @@
+#ifndef BLOCKPARTITION_H
+#define BLOCKPARTITION_H
+
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * @class BlockPartition
+ * @brief Splits a range of samples into the contiguous blocks processed by the parallel loops.
+ *        The layout only depends on the number of samples, never on the number of threads, so
+ *        results combined block by block in block order are identical for every thread count.
+ */
+class BlockPartition
+{
+public:
+
+    /**
+     * @brief Constructor that computes the layout for a number of samples.
+     *
+     * @param itemCount The number of samples to split.
+     */
+    explicit BlockPartition(size_t itemCount);
+
+    /**
+     * @brief Returns the number of blocks.
+     *
+     * @return The number of blocks (at least 1).
+     */
+    size_t getBlockCount() const;
+
+    /**
+     * @brief Returns the first sample of a block. Block b covers [getBlockBegin(b), getBlockEnd(b)).
+     *
+     * @param block The block index.
+     * @return The index of the first sample of the block.
+     */
+    size_t getBlockBegin(size_t block) const;
+
+    /**
+     * @brief Returns one past the last sample of a block.
+     *
+     * @param block The block index.
+     * @return The index following the last sample of the block.
+     */
+    size_t getBlockEnd(size_t block) const;
+
+private:
+
+    /** The number of samples. */
+    size_t itemCount;
+
+    /** The number of blocks. */
+    size_t blockCount;
+};
+
+#endif
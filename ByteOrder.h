@@ -0,0 +1,40 @@
+#ifndef BYTEORDER_H
+#define BYTEORDER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+using namespace std;
+
+/**
+ * @brief Reverses the bytes of a value, to read a file written by a machine of the other byte order.
+ *
+ * @param value The value.
+ * @return The value in the other byte order.
+ */
+template <typename T>
+inline T swapBytes(T value)
+{
+    unsigned char bytes[sizeof(T)];
+    memcpy(bytes, &value, sizeof(T));
+    reverse(bytes, bytes + sizeof(T));
+    memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+/**
+ * @brief Reverses the bytes of every value of an array.
+ *
+ * @param values The values.
+ * @param count The number of values.
+ */
+template <typename T>
+inline void swapArray(T* values, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = swapBytes(values[i]);
+    }
+}
+
+#endif
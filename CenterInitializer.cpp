@@ -0,0 +1,465 @@
+/****************************************************************************
+ * @file CenterInitializer.cpp
+ * @brief Implementation of the CenterInitializer class: the original
+ *        first-K-samples choice, k-means++ seeding with a parallel,
+ *        reproducible D^2 sampling pass, and k-means|| oversampling.
+ ****************************************************************************/
+
+#include "CenterInitializer.h"
+#include "BlockPartition.h"
+#include "Dimension.h"
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * @brief Returns a uniformly distributed number in [0, 1) that only depends on a seed and a row.
+ *        The bits come from the SplitMix64 finalizer, which scrambles consecutive inputs well.
+ *
+ * @param seed The seed of the round.
+ * @param row The row.
+ * @return double The random number.
+ */
+static double hashUniform(uint64_t seed, size_t row)
+{
+    uint64_t z = seed + (static_cast<uint64_t>(row) + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return static_cast<double>(z >> 11) * (1.0 / 9007199254740992.0);  ///< 53 bits / 2^53
+}
+
+/**
+ * @brief Constructor that binds the initializer to the samples and the thread pool.
+ *
+ * @param data The samples to choose from.
+ * @param pool The thread pool used by the parallel passes.
+ * @param options The seed, the k-means|| parameters and the instruction set of the distance kernel.
+ */
+CenterInitializer::CenterInitializer(const Dataset& data, ThreadPool& pool, const KMeansOptions& options)
+    : data(data), pool(pool), options(options), kernel(options.instructionSet), generator(options.seed)
+{
+}
+
+/**
+ * @brief Chooses the initial centers with the given method.
+ *
+ * @param initialization The method.
+ * @param k The number of centers.
+ * @return vector<size_t> The rows of the chosen samples.
+ * @throws invalid_argument If the method is unknown.
+ */
+vector<size_t> CenterInitializer::chooseCenters(Initialization initialization, size_t k)
+{
+    switch (initialization) {
+    case Initialization::FirstSamples:
+        return firstSamples(k);
+    case Initialization::KMeansPlusPlus:
+        return kMeansPlusPlus(k);
+    case Initialization::KMeansParallel:
+        return kMeansParallel(k);
+    }
+    throw invalid_argument("Unknown initialization method.");
+}
+
+/**
+ * @brief Chooses the first k samples.
+ *
+ * @param k The number of centers.
+ * @return vector<size_t> The rows 0 to k - 1.
+ */
+vector<size_t> CenterInitializer::firstSamples(size_t k) const
+{
+    vector<size_t> rows(k);
+    for (size_t j = 0; j < k; ++j) {
+        rows[j] = j;
+    }
+    return rows;
+}
+
+/**
+ * @brief Chooses the centers with k-means++ (D^2 sampling).
+ *
+ * @param k The number of centers.
+ * @return vector<size_t> The rows of the chosen samples.
+ */
+vector<size_t> CenterInitializer::kMeansPlusPlus(size_t k)
+{
+    vector<size_t> rows;
+    rows.reserve(k);
+    weights.assign(data.size(), numeric_limits<double>::max());
+
+    rows.push_back(sampleUniformly());
+    while (rows.size() < k) {
+        updateWeights(rows.back());
+        rows.push_back(sampleByWeight());
+    }
+    return rows;
+}
+
+/**
+ * @brief Chooses the centers with k-means|| (oversampling, then weighted k-means++ on the candidates).
+ *        Rounds are added beyond the requested number while there are fewer than k candidates.
+ *
+ * @param k The number of centers.
+ * @return vector<size_t> The rows of the chosen samples.
+ * @throws invalid_argument If the oversampling factor is not positive or there are no rounds.
+ */
+vector<size_t> CenterInitializer::kMeansParallel(size_t k)
+{
+    if (!(options.oversamplingFactor > 0.0) || options.oversamplingRounds == 0) {
+        throw invalid_argument("k-means|| needs a positive oversampling factor and at least one round.");
+    }
+
+    vector<size_t> candidates(1, sampleUniformly());
+    weights.assign(data.size(), numeric_limits<double>::max());
+    lowerWeights(candidates, 0);
+
+    for (unsigned int round = 0; round < options.oversamplingRounds || candidates.size() < k; ++round) {
+        const double total = getTotalWeight();
+        if (!(total > 0.0)) break;  ///< Every sample coincides with a candidate
+
+        const size_t firstNew = candidates.size();
+        drawCandidates(options.oversamplingFactor * k / total, candidates);
+        lowerWeights(candidates, firstNew);
+    }
+
+    return reduceCandidates(candidates, countNearest(candidates), k);
+}
+
+/**
+ * @brief Returns a uniformly distributed number in [0, 1).
+ *        uniform_real_distribution is not used because its algorithm differs between libraries.
+ *
+ * @return double The random number.
+ */
+double CenterInitializer::nextUniform()
+{
+    return static_cast<double>(generator() >> 11) * (1.0 / 9007199254740992.0);  ///< 53 bits / 2^53
+}
+
+/**
+ * @brief Returns a uniformly chosen row.
+ *
+ * @return size_t The row.
+ */
+size_t CenterInitializer::sampleUniformly()
+{
+    return min(data.size() - 1, static_cast<size_t>(nextUniform() * data.size()));
+}
+
+/**
+ * @brief Lowers the weight of every sample to its squared distance to a new center and sums the weights per block.
+ *
+ * @param centerRow The row of the new center.
+ */
+void CenterInitializer::updateWeights(size_t centerRow)
+{
+    const size_t D = data.getDimension();
+    const BlockPartition blocks(data.size());
+    blockWeights.assign(blocks.getBlockCount(), 0.0);
+
+    vector<const double*> columns;
+    vector<double> center(D);
+    data.loadSample(centerRow, center.data());
+    if (data.getPrecision() == Precision::Double) {
+        columns.resize(D);
+        for (size_t d = 0; d < D; ++d) {
+            columns[d] = data.getColumn(d);
+        }
+    }
+
+    dispatchDimension(D, [&](auto dim) {
+        pool.parallelFor(blocks.getBlockCount(), [&](size_t block) {
+            auto point = dim.makePoint();
+            double sum = 0.0;
+            for (size_t i = blocks.getBlockBegin(block); i < blocks.getBlockEnd(block); ++i) {
+                if (columns.empty()) {
+                    data.loadSample(i, point.data());  ///< Widened from a reduced precision
+                }
+                else {
+                    gatherPoint(columns.data(), i, point.data(), dim);
+                }
+                weights[i] = min(weights[i], squaredDistance(point.data(), center.data(), dim));
+                sum += weights[i];
+            }
+            blockWeights[block] = sum;
+            });
+        });
+}
+
+/**
+ * @brief Returns a row chosen with a probability proportional to its weight.
+ *        The target is located with the block totals first and then inside one block,
+ *        adding the weights in the same order as updateWeights() did.
+ *
+ * @return size_t The row.
+ */
+size_t CenterInitializer::sampleByWeight()
+{
+    const BlockPartition blocks(data.size());
+
+    const double total = getTotalWeight();
+    if (!(total > 0.0)) {
+        return sampleUniformly();  ///< Every sample coincides with a chosen center
+    }
+
+    double target = nextUniform() * total;
+    size_t block = 0;
+    while (block + 1 < blocks.getBlockCount() && !(target < blockWeights[block])) {
+        target -= blockWeights[block];
+        ++block;
+    }
+
+    const size_t begin = blocks.getBlockBegin(block);
+    const size_t offset = findWeighted(&weights[begin], blocks.getBlockEnd(block) - begin, target);
+    if (offset < blocks.getBlockEnd(block) - begin) {
+        return begin + offset;
+    }
+
+    // Only possible when rounding led to an empty block; fall back to the last sample with a weight
+    for (size_t i = data.size(); i-- > 0;) {
+        if (weights[i] > 0.0) return i;
+    }
+    return sampleUniformly();
+}
+
+/**
+ * @brief Returns the first index whose running sum of weights exceeds a target, skipping the zero weights.
+ *
+ * @param values The weights.
+ * @param count The number of weights.
+ * @param target A value in [0, sum of the weights).
+ * @return size_t The index, or count when every weight is 0.
+ */
+size_t CenterInitializer::findWeighted(const double* values, size_t count, double target)
+{
+    size_t chosen = count;
+    double sum = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        if (values[i] > 0.0) {
+            chosen = i;
+            sum += values[i];
+            if (target < sum) break;
+        }
+    }
+    return chosen;
+}
+
+/**
+ * @brief Returns the sum of the block weights, added in block order.
+ *
+ * @return double The total weight.
+ */
+double CenterInitializer::getTotalWeight() const
+{
+    double total = 0.0;
+    for (double blockWeight : blockWeights) {
+        total += blockWeight;
+    }
+    return total;
+}
+
+/**
+ * @brief Copies the coordinates of rows[first..] into a row-major array.
+ *
+ * @param rows The rows.
+ * @param first The first element of rows to copy.
+ * @return vector<double> The coordinates.
+ */
+vector<double> CenterInitializer::gatherRows(const vector<size_t>& rows, size_t first) const
+{
+    const size_t D = data.getDimension();
+    vector<double> coordinates((rows.size() - first) * D);
+    for (size_t j = first; j < rows.size(); ++j) {
+        for (size_t d = 0; d < D; ++d) {
+            coordinates[(j - first) * D + d] = data.getCoordinate(d, rows[j]);
+        }
+    }
+    return coordinates;
+}
+
+/**
+ * @brief Returns the columns the distance kernel searches for a chunk of samples. Samples stored in a
+ *        reduced precision are widened into the tile, so the kernel compares them in double like the others.
+ *
+ * @param begin The first sample of the chunk.
+ * @param end One past the last sample, at most DistanceKernel::CHUNK_SIZE after begin.
+ * @param tile Receives the widened chunk, one row of DistanceKernel::CHUNK_SIZE doubles per dimension.
+ * @param columns Receives one column per dimension.
+ * @return size_t The row of the first sample of the chunk in the columns.
+ */
+size_t CenterInitializer::loadChunk(size_t begin, size_t end, vector<double>& tile, vector<const double*>& columns) const
+{
+    const size_t D = data.getDimension();
+    columns.resize(D);
+    if (data.getPrecision() == Precision::Double) {
+        for (size_t d = 0; d < D; ++d) {
+            columns[d] = data.getColumn(d);
+        }
+        return begin;
+    }
+
+    tile.resize(D * DistanceKernel::CHUNK_SIZE);
+    data.copyRows(begin, end, tile.data(), DistanceKernel::CHUNK_SIZE);
+    for (size_t d = 0; d < D; ++d) {
+        columns[d] = &tile[d * DistanceKernel::CHUNK_SIZE];
+    }
+    return 0;
+}
+
+/**
+ * @brief Lowers every weight to the squared distance to the nearest new candidate and sums the weights per block.
+ *        The nearest-center search is the vectorized kernel of the Lloyd engine.
+ *
+ * @param candidates The candidate rows.
+ * @param firstNew The first candidate added since the previous call.
+ */
+void CenterInitializer::lowerWeights(const vector<size_t>& candidates, size_t firstNew)
+{
+    const size_t D = data.getDimension();
+    const BlockPartition blocks(data.size());
+    blockWeights.assign(blocks.getBlockCount(), 0.0);
+
+    const vector<double> centers = gatherRows(candidates, firstNew);
+    const size_t centerCount = candidates.size() - firstNew;
+
+    pool.parallelFor(blocks.getBlockCount(), [&](size_t block) {
+        size_t nearest[DistanceKernel::CHUNK_SIZE];
+        double distances[DistanceKernel::CHUNK_SIZE];
+        vector<double> tile;
+        vector<const double*> columns;
+        const size_t end = blocks.getBlockEnd(block);
+        double sum = 0.0;
+        for (size_t chunk = blocks.getBlockBegin(block); chunk < end; chunk += DistanceKernel::CHUNK_SIZE) {
+            const size_t chunkEnd = min(end, chunk + DistanceKernel::CHUNK_SIZE);
+            const size_t first = loadChunk(chunk, chunkEnd, tile, columns);
+            kernel.findNearest(columns.data(), D, first, first + (chunkEnd - chunk), centers.data(), centerCount,
+                nearest, distances);
+            for (size_t i = chunk; i < chunkEnd; ++i) {
+                weights[i] = min(weights[i], distances[i - chunk] * distances[i - chunk]);
+                sum += weights[i];
+            }
+        }
+        blockWeights[block] = sum;
+        });
+}
+
+/**
+ * @brief Keeps every sample with the probability min(1, scale * weight) and appends the kept rows in row order.
+ *
+ * @param scale The oversampling factor times K divided by the total weight.
+ * @param candidates The candidate rows to append to.
+ */
+void CenterInitializer::drawCandidates(double scale, vector<size_t>& candidates)
+{
+    const BlockPartition blocks(data.size());
+    const uint64_t roundSeed = generator();
+    vector<vector<size_t>> blockCandidates(blocks.getBlockCount());
+
+    pool.parallelFor(blocks.getBlockCount(), [&](size_t block) {
+        for (size_t i = blocks.getBlockBegin(block); i < blocks.getBlockEnd(block); ++i) {
+            // Candidates have a weight of 0 and are never drawn twice
+            if (weights[i] > 0.0 && hashUniform(roundSeed, i) < scale * weights[i]) {
+                blockCandidates[block].push_back(i);
+            }
+        }
+        });
+
+    for (const vector<size_t>& rows : blockCandidates) {
+        candidates.insert(candidates.end(), rows.begin(), rows.end());
+    }
+}
+
+/**
+ * @brief Counts the samples nearest to each candidate. The counts are integers, so the order
+ *        in which the threads add their partial counts does not matter.
+ *
+ * @param candidates The candidate rows.
+ * @return vector<double> The number of samples per candidate.
+ */
+vector<double> CenterInitializer::countNearest(const vector<size_t>& candidates)
+{
+    const size_t D = data.getDimension();
+    const BlockPartition blocks(data.size());
+    const vector<double> centers = gatherRows(candidates, 0);
+
+    vector<size_t> counts(candidates.size(), 0);
+    mutex countsMutex;
+    pool.parallelFor(blocks.getBlockCount(), [&](size_t block) {
+        size_t nearest[DistanceKernel::CHUNK_SIZE];
+        double distances[DistanceKernel::CHUNK_SIZE];
+        vector<double> tile;
+        vector<const double*> columns;
+        vector<size_t> blockCounts(candidates.size(), 0);
+        const size_t end = blocks.getBlockEnd(block);
+        for (size_t chunk = blocks.getBlockBegin(block); chunk < end; chunk += DistanceKernel::CHUNK_SIZE) {
+            const size_t chunkEnd = min(end, chunk + DistanceKernel::CHUNK_SIZE);
+            const size_t first = loadChunk(chunk, chunkEnd, tile, columns);
+            kernel.findNearest(columns.data(), D, first, first + (chunkEnd - chunk), centers.data(), candidates.size(),
+                nearest, distances);
+            for (size_t i = 0; i < chunkEnd - chunk; ++i) {
+                ++blockCounts[nearest[i]];
+            }
+        }
+
+        lock_guard<mutex> lock(countsMutex);
+        for (size_t j = 0; j < counts.size(); ++j) {
+            counts[j] += blockCounts[j];
+        }
+        });
+
+    return vector<double>(counts.begin(), counts.end());
+}
+
+/**
+ * @brief Reduces the weighted candidates to k centers with weighted k-means++: the first one is drawn
+ *        proportionally to its weight, every next one proportionally to its weight times its squared
+ *        distance to the nearest chosen candidate. The candidates are few, so this runs on one thread.
+ *
+ * @param candidates The candidate rows.
+ * @param candidateWeights The weight of each candidate.
+ * @param k The number of centers.
+ * @return vector<size_t> The rows of the chosen candidates.
+ */
+vector<size_t> CenterInitializer::reduceCandidates(const vector<size_t>& candidates,
+    const vector<double>& candidateWeights, size_t k)
+{
+    const size_t C = candidates.size();
+    const size_t D = data.getDimension();
+    const vector<double> coordinates = gatherRows(candidates, 0);
+
+    vector<double> nearestDistances(C, numeric_limits<double>::max());
+    vector<double> scores(candidateWeights);
+    vector<size_t> rows;
+    rows.reserve(k);
+
+    dispatchDimension(D, [&](auto dim) {
+        while (rows.size() < k) {
+            double total = 0.0;
+            for (double score : scores) {
+                total += score;
+            }
+
+            size_t chosen = C;
+            if (total > 0.0) {
+                chosen = findWeighted(scores.data(), C, nextUniform() * total);
+            }
+            if (chosen == C) {
+                // Fewer distinct candidates than centers; repeat one, like k-means++ on duplicate samples
+                chosen = min(C - 1, static_cast<size_t>(nextUniform() * C));
+            }
+            rows.push_back(candidates[chosen]);
+
+            const double* center = &coordinates[chosen * D];
+            for (size_t j = 0; j < C; ++j) {
+                nearestDistances[j] = min(nearestDistances[j], squaredDistance(&coordinates[j * D], center, dim));
+                scores[j] = candidateWeights[j] * nearestDistances[j];
+            }
+        }
+        });
+    return rows;
+}
@@ -0,0 +1,206 @@
+#ifndef CENTERINITIALIZER_H
+#define CENTERINITIALIZER_H
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "Dataset.h"
+#include "DistanceKernel.h"
+#include "KMeansOptions.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+/**
+ * @class CenterInitializer
+ * @brief Chooses the samples used as the initial cluster centers.
+ *        The random methods draw from a 64-bit Mersenne Twister, whose output the C++ standard
+ *        fixes, and turn its numbers into doubles by hand, so a seed gives the same centers on
+ *        every platform. The parallel passes use the thread-count independent BlockPartition
+ *        and add the per-block results in block order, so the thread count never changes them either.
+ */
+class CenterInitializer
+{
+public:
+
+    /**
+     * @brief Constructor that binds the initializer to the samples and the thread pool.
+     *
+     * @param data The samples to choose from.
+     * @param pool The thread pool used by the parallel passes.
+     * @param options The seed, the k-means|| parameters and the instruction set of the distance kernel.
+     */
+    CenterInitializer(const Dataset& data, ThreadPool& pool, const KMeansOptions& options);
+
+    /**
+     * @brief Chooses the initial centers with the given method.
+     *
+     * @param initialization The method.
+     * @param k The number of centers.
+     * @return The rows of the chosen samples, one per center.
+     * @throws invalid_argument If the method is unknown.
+     */
+    vector<size_t> chooseCenters(Initialization initialization, size_t k);
+
+    /**
+     * @brief Chooses the first k samples, as the original program did.
+     *
+     * @param k The number of centers.
+     * @return The rows 0 to k - 1.
+     */
+    vector<size_t> firstSamples(size_t k) const;
+
+    /**
+     * @brief Chooses the centers with k-means++: the first one uniformly, then every next one with a
+     *        probability proportional to its squared distance to the nearest center chosen so far (D^2 sampling).
+     *        The distances are updated in parallel, one pass over the samples per center.
+     *
+     * @param k The number of centers.
+     * @return The rows of the chosen samples, one per center.
+     */
+    vector<size_t> kMeansPlusPlus(size_t k);
+
+    /**
+     * @brief Chooses the centers with k-means||: starting from one uniformly chosen sample, every round
+     *        keeps each sample independently with a probability proportional to its squared distance to
+     *        the nearest candidate, so a few parallel passes replace the k sequential passes of k-means++.
+     *        The candidates are then weighted by the number of samples nearest to them and reduced to
+     *        k centers with weighted k-means++.
+     *
+     * @param k The number of centers.
+     * @return The rows of the chosen samples, one per center.
+     * @throws invalid_argument If the oversampling factor is not positive or there are no rounds.
+     */
+    vector<size_t> kMeansParallel(size_t k);
+
+private:
+
+    /**
+     * @brief Returns a uniformly distributed number in [0, 1) from the 53 high bits of the generator.
+     *
+     * @return The random number.
+     */
+    double nextUniform();
+
+    /**
+     * @brief Returns a uniformly chosen row.
+     *
+     * @return The row.
+     */
+    size_t sampleUniformly();
+
+    /**
+     * @brief Lowers the weight of every sample to its squared distance to a new center, if that is smaller,
+     *        and recomputes the total weight of every block.
+     *
+     * @param centerRow The row of the new center.
+     */
+    void updateWeights(size_t centerRow);
+
+    /**
+     * @brief Returns a row chosen with a probability proportional to its weight.
+     *        A uniformly chosen row is returned when all the weights are 0.
+     *
+     * @return The row.
+     */
+    size_t sampleByWeight();
+
+    /**
+     * @brief Returns the first index whose running sum of weights exceeds a target, skipping the
+     *        zero weights. When rounding leaves the target past the end, the last positive weight wins.
+     *
+     * @param values The weights.
+     * @param count The number of weights.
+     * @param target A value in [0, sum of the weights).
+     * @return The index, or count when every weight is 0.
+     */
+    static size_t findWeighted(const double* values, size_t count, double target);
+
+    /**
+     * @brief Returns the sum of the block weights, added in block order.
+     *
+     * @return The total weight.
+     */
+    double getTotalWeight() const;
+
+    /**
+     * @brief Copies the coordinates of some rows into a row-major array.
+     *
+     * @param rows The rows.
+     * @param first The first element of rows to copy.
+     * @return The coordinates, (rows.size() - first) x dimension.
+     */
+    vector<double> gatherRows(const vector<size_t>& rows, size_t first) const;
+
+    /**
+     * @brief Returns the columns the distance kernel searches for a chunk of samples: those of the
+     *        dataset, or, for samples stored in a reduced precision, the chunk widened into a tile.
+     *
+     * @param begin The first sample of the chunk.
+     * @param end One past the last sample, at most DistanceKernel::CHUNK_SIZE after begin.
+     * @param tile Receives the widened chunk, one row of DistanceKernel::CHUNK_SIZE doubles per dimension.
+     * @param columns Receives one column per dimension.
+     * @return The row of the first sample of the chunk in the columns.
+     */
+    size_t loadChunk(size_t begin, size_t end, vector<double>& tile, vector<const double*>& columns) const;
+
+    /**
+     * @brief k-means||: lowers the weight of every sample to its squared distance to the nearest of the
+     *        new candidates, if that is smaller, and recomputes the total weight of every block.
+     *
+     * @param candidates The candidate rows.
+     * @param firstNew The first candidate added since the previous call.
+     */
+    void lowerWeights(const vector<size_t>& candidates, size_t firstNew);
+
+    /**
+     * @brief k-means||: keeps every sample with the probability min(1, scale * weight) and appends the
+     *        kept rows to the candidates in row order. The random number of a sample only depends on a
+     *        per-round seed and the row, so the thread count does not change the choice.
+     *
+     * @param scale The oversampling factor times K divided by the total weight.
+     * @param candidates The candidate rows to append to.
+     */
+    void drawCandidates(double scale, vector<size_t>& candidates);
+
+    /**
+     * @brief k-means||: counts the samples nearest to each candidate.
+     *
+     * @param candidates The candidate rows.
+     * @return The number of samples per candidate.
+     */
+    vector<double> countNearest(const vector<size_t>& candidates);
+
+    /**
+     * @brief k-means||: reduces the weighted candidates to k centers with weighted k-means++.
+     *
+     * @param candidates The candidate rows.
+     * @param candidateWeights The weight of each candidate.
+     * @param k The number of centers.
+     * @return The rows of the chosen candidates.
+     */
+    vector<size_t> reduceCandidates(const vector<size_t>& candidates, const vector<double>& candidateWeights, size_t k);
+
+    /** The samples to choose from. */
+    const Dataset& data;
+
+    /** The thread pool used by the parallel passes. */
+    ThreadPool& pool;
+
+    /** The seed, the k-means|| parameters and the instruction set of the distance kernel. */
+    KMeansOptions options;
+
+    /** The nearest-candidate search of k-means||. */
+    DistanceKernel kernel;
+
+    /** The random generator. */
+    mt19937_64 generator;
+
+    /** For every sample, the squared distance to the nearest center chosen so far. */
+    vector<double> weights;
+
+    /** The sum of the weights of each block. */
+    vector<double> blockWeights;
+};
+
+#endif
@@ -2,12 +2,13 @@
  * @file Cluster.cpp
  * @brief This file contains the implementation of the Cluster class. Each cluster represents a group
  *        of samples in the K-means algorithm. It stores the unique ID of the cluster, its center
- *        coordinates (centerX, centerY), and a list of samples belonging to the cluster. The center
- *        is updated based on the average of the samples' coordinates. The class also provides methods
- *        to add samples, clear samples, and print cluster information.
+ *        coordinates (one per dimension). The center is updated based on the average of the samples'
+ *        coordinates, from sums collected by the assignment step. The class also provides methods
+ *        to list the samples of the cluster on demand and print cluster information.
  ************************************************************************************************************/
 
 #include "Cluster.h"
+#include <cmath>
 #include <iostream>
 #include <vector>
 
@@ -21,74 +22,133 @@ using namespace std;
  * @param Y The Y coordinate of the cluster's center.
  */
 Cluster::Cluster(int ID, double X, double Y)
-    : clusterID(ID), centerX(X), centerY(Y)
+    : clusterID(ID), center{ X, Y }
 {
     // Constructor: Initializes the cluster with ID, center X, and center Y.
 }
 
 /**
- * @brief Destructor for the Cluster class.
- *        It calls the print method to display the cluster's information when the object is destroyed.
- */
-Cluster::~Cluster()
-{
-    print();
-}
-
-/**
- * @brief Adds a sample to the cluster's list of samples.
- *        The sample is added at the end of the sample list.
+ * @brief Constructor to initialize a cluster with its ID and a center of any dimension.
  *
- * @param sample A pointer to the Sample object to be added to the cluster.
+ * @param ID The unique ID for the cluster.
+ * @param center The coordinates of the cluster's center.
  */
-void Cluster::addSample(Sample* sample)
+Cluster::Cluster(int ID, const vector<double>& center)
+    : clusterID(ID), center(center)
 {
-    samples.push_back(sample);  ///< Add a new sample to the cluster's sample list.
 }
 
 /**
- * @brief Clears all samples from the cluster's list.
+ * @brief Returns the rows of the samples labelled with the ID of the cluster, in dataset order.
+ *
+ * @param data The dataset holding the samples and their cluster IDs.
+ * @return vector<size_t> The rows of the members of the cluster.
  */
-void Cluster::clearSamples(void)
+vector<size_t> Cluster::getSampleRows(const Dataset& data) const
 {
-    samples.clear();  ///< Clears all samples from the cluster's sample list.
+    vector<size_t> rows;
+    const int* labels = data.getLabels();
+    for (size_t row = 0; row < data.size(); ++row) {
+        if (labels[row] == clusterID) {
+            rows.push_back(row);
+        }
+    }
+    return rows;
 }
 
 /**
  * @brief Calculates the new center of the cluster based on the average coordinates of the samples.
  *        If the center changes, it returns true; otherwise, it returns false.
  *
+ * @param data The dataset the samples of the cluster belong to.
  * @return true If the center of the cluster has changed.
  * @return false If the center of the cluster remains the same.
  */
-bool Cluster::calculateCenter(void) {
-    // Check if the sample list is empty. If it is, return false.
-    if (samples.empty()) return false;
+bool Cluster::calculateCenter(const Dataset& data) {
+    const vector<size_t> sampleRows = getSampleRows(data);
 
-    // Initialize variables to store the sum of X and Y coordinates.
-    double sumX = 0, sumY = 0;
+    // Check if the cluster has no sample. If it is empty, return false.
+    if (sampleRows.empty()) return false;
 
-    // Loop through all the samples and sum their X and Y coordinates.
-    for (const auto& sample : samples) {
-        sumX += sample->getX();  ///< Add X coordinate of the sample to sumX.
-        sumY += sample->getY();  ///< Add Y coordinate of the sample to sumY.
+    // Initialize variables to store the sum of each coordinate.
+    vector<double> sums(center.size(), 0.0);
+
+    // Loop through all the samples and sum their coordinates, one column at a time.
+    for (size_t d = 0; d < center.size(); ++d) {
+        for (size_t row : sampleRows) {
+            sums[d] += data.getCoordinate(d, row);  ///< Add the coordinate of the sample to its sum.
+        }
     }
 
-    // Calculate the new center by averaging the X and Y coordinates of all samples.
-    double newCenterX = sumX / samples.size();  ///< Compute the average X coordinate.
-    double newCenterY = sumY / samples.size();  ///< Compute the average Y coordinate.
+    // Calculate the new center by averaging the coordinates of all samples.
+    return calculateCenter(sums.data(), sampleRows.size());
+}
 
-    // Check if the new center is different from the old center.
-    bool changed = (newCenterX != centerX || newCenterY != centerY);
+/**
+ * @brief Sets the center of the cluster from coordinate sums collected during the assignment step.
+ *        An empty cluster keeps its previous center, as in calculateCenter().
+ *
+ * @param sums The sum of each coordinate of the samples in the cluster.
+ * @param count The number of samples in the cluster.
+ * @return true If the center of the cluster has changed.
+ * @return false If the center of the cluster remains the same.
+ */
+bool Cluster::calculateCenter(const double* sums, size_t count)
+{
+    if (count == 0) return false;
 
-    // Update the cluster's center with the new calculated values.
-    centerX = newCenterX;
-    centerY = newCenterY;
+    bool changed = false;
+    for (size_t d = 0; d < center.size(); ++d) {
+        double newCoordinate = sums[d] / count;  ///< Compute the average of the coordinate.
+        changed = changed || newCoordinate != center[d];
+        center[d] = newCoordinate;
+    }
 
-    // Return true if the center has changed, otherwise return false.
     return changed;
 }
 
+/**
+ * @brief Moves the center part of the way towards the mean of a batch of samples.
+ *
+ * @param sums The sum of each coordinate of the batch samples in the cluster.
+ * @param count The number of batch samples in the cluster.
+ * @param learningRate The fraction of the way to the batch mean to move.
+ * @return double The distance the center moved.
+ */
+double Cluster::moveCenter(const double* sums, size_t count, double learningRate)
+{
+    if (count == 0) return 0.0;
+
+    double squaredShift = 0.0;
+    for (size_t d = 0; d < center.size(); ++d) {
+        double step = learningRate * (sums[d] / count - center[d]);
+        center[d] += step;
+        squaredShift += step * step;
+    }
+
+    return sqrt(squaredShift);
+}
+
+/**
+ * @brief Gets the number of coordinates of the cluster's center.
+ *
+ * @return size_t The dimension of the center.
+ */
+size_t Cluster::getDimension(void) const
+{
+    return center.size();
+}
+
+/**
+ * @brief Gets all the coordinates of the cluster's center.
+ *
+ * @return const vector<double>& The coordinates of the center.
+ */
+const vector<double>& Cluster::getCenter(void) const
+{
+    return center;
+}
+
 /**
  * @brief Gets the X coordinate of the cluster's center.
  *
@@ -96,17 +156,17 @@ bool Cluster::calculateCenter(void) {
  */
 double Cluster::getXofCluster(void) const
 {
-    return centerX;  ///< Return the X coordinate of the cluster's center.
+    return center[0];  ///< Return the X coordinate of the cluster's center.
 }
 
 /**
  * @brief Gets the Y coordinate of the cluster's center.
  *
- * @return double The Y coordinate of the cluster's center.
+ * @return double The Y coordinate of the cluster's center, or 0 for one-dimensional data.
  */
 double Cluster::getYofCluster(void) const
 {
-    return centerY;  ///< Return the Y coordinate of the cluster's center.
+    return center.size() > 1 ? center[1] : 0.0;  ///< Return the Y coordinate of the cluster's center.
 }
 
 /**
@@ -127,6 +187,10 @@ void Cluster::print(void) const
     cout << "Cluster Information:" << endl;
     cout << "--------------------" << endl;
     cout << "Cluster ID       : " << getIDofCluster() << endl;
-    cout << "Center Coordinates: (" << getXofCluster() << ", " << getYofCluster() << ")" << endl;
+    cout << "Center Coordinates: (";
+    for (size_t d = 0; d < center.size(); ++d) {
+        cout << (d > 0 ? ", " : "") << center[d];
+    }
+    cout << ")" << endl;
     cout << "--------------------" << endl;
 }
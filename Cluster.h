@@ -3,15 +3,17 @@
 
 #include <iostream>
 #include <vector>
-#include "Sample.h"
+#include "Dataset.h"
 
 using namespace std;
 
 /**
  * @class Cluster
  * @brief Represents a cluster in the K-means algorithm.
- *        Each cluster has a unique ID, a center (calculated as the average of its sample points),
- *        and a list of samples belonging to the cluster.
+ *        Each cluster has a unique ID and a center (calculated as the average of its sample points).
+ *        The members of a cluster are the samples labelled with its ID; the assignment engines
+ *        collect their coordinate sums and counts while they assign them, so no member list is kept.
+ *        getSampleRows() builds the list on demand.
  */
 class Cluster
 {
@@ -27,30 +29,68 @@ public:
     Cluster(int ID, double X, double Y);
 
     /**
-     * @brief Destructor to clean up resources when the Cluster object is destroyed.
+     * @brief Constructor to initialize a cluster with a unique ID and a center of any dimension.
+     *
+     * @param ID The unique ID of the cluster.
+     * @param center The coordinates of the cluster's center.
      */
-    ~Cluster();
+    Cluster(int ID, const vector<double>& center);
 
     /**
-     * @brief Adds a sample to the cluster's list of samples.
+     * @brief Returns the rows of the samples that belong to the cluster, in dataset order.
+     *        The list is built from the labels of the dataset on every call.
      *
-     * @param sample A pointer to the Sample object to be added.
+     * @param data The dataset holding the samples and their cluster IDs.
+     * @return The rows of the samples labelled with the ID of the cluster.
      */
-    void addSample(Sample* sample);
+    vector<size_t> getSampleRows(const Dataset& data) const;
 
     /**
-     * @brief Clears all samples from the cluster's sample list.
+     * @brief Calculates the new center of the cluster based on the average coordinates of its samples,
+     *        found from the labels of the dataset. It returns true if the center has changed, false otherwise.
+     *        The assignment step uses the sums overload instead, which needs no pass over the samples.
+     *
+     * @param data The dataset the samples of the cluster belong to.
+     * @return true If the center has changed.
+     * @return false If the center remains the same.
      */
-    void clearSamples();
+    bool calculateCenter(const Dataset& data);
 
     /**
-     * @brief Calculates the new center of the cluster based on the average coordinates of the samples.
+     * @brief Sets the center of the cluster to the mean of its samples, given as precomputed coordinate sums.
      *        It returns true if the center has changed, false otherwise.
      *
+     * @param sums The sum of each coordinate of the samples in the cluster (getDimension() values).
+     * @param count The number of samples in the cluster.
      * @return true If the center has changed.
-     * @return false If the center remains the same.
+     * @return false If the center remains the same or the cluster is empty.
+     */
+    bool calculateCenter(const double* sums, size_t count);
+
+    /**
+     * @brief Moves the center towards the mean of a batch of samples (mini-batch K-means):
+     *        center += learningRate * (sums / count - center).
+     *
+     * @param sums The sum of each coordinate of the batch samples in the cluster (getDimension() values).
+     * @param count The number of batch samples in the cluster.
+     * @param learningRate The fraction of the way to the batch mean to move, in (0, 1].
+     * @return The distance the center moved, or 0 if the cluster got no sample.
      */
-    bool calculateCenter();
+    double moveCenter(const double* sums, size_t count, double learningRate);
+
+    /**
+     * @brief Returns the number of coordinates of the cluster's center.
+     *
+     * @return The dimension of the center.
+     */
+    size_t getDimension() const;
+
+    /**
+     * @brief Returns all the coordinates of the cluster's center.
+     *
+     * @return A reference to the coordinates of the center.
+     */
+    const vector<double>& getCenter() const;
 
     /**
      * @brief Returns the X coordinate of the cluster's center.
@@ -62,7 +102,7 @@ public:
     /**
      * @brief Returns the Y coordinate of the cluster's center.
      *
-     * @return The Y coordinate of the cluster's center.
+     * @return The Y coordinate of the cluster's center, or 0 for one-dimensional data.
      */
     double getYofCluster() const;
 
@@ -83,14 +123,8 @@ private:
     /** The ID of the cluster. */
     int clusterID;
 
-    /** The X coordinate of the cluster's center. */
-    double centerX;
-
-    /** The Y coordinate of the cluster's center. */
-    double centerY;
-
-    /** A vector of pointers to the samples belonging to the cluster. */
-    vector<Sample*> samples;
+    /** The coordinates of the cluster's center ((X, Y) for 2D data). */
+    vector<double> center;
 };
 
 #endif
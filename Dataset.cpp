@@ -0,0 +1,408 @@
+/****************************************************************************
+ * @file Dataset.cpp
+ * @brief Implementation of the Dataset class, the structure-of-arrays storage
+ *        that holds the coordinates and cluster IDs of all the samples.
+ ****************************************************************************/
+
+#include "Dataset.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * @brief Widens a stored coordinate to a double; halves and bfloat16 widen exactly through a float.
+ *
+ * @param value The stored coordinate.
+ * @return double The coordinate.
+ */
+static double widen(double value) { return value; }
+static double widen(float value) { return value; }
+static double widen(Half value) { return toFloat(value); }
+static double widen(BFloat16 value) { return toFloat(value); }
+
+/**
+ * @brief Constructor that creates an empty dataset.
+ *
+ * @param dimension The number of coordinates of every sample.
+ * @throws invalid_argument If the dimension is 0.
+ */
+Dataset::Dataset(size_t dimension)
+{
+    reset(dimension);
+}
+
+/**
+ * @brief Returns the number of coordinates of every sample.
+ *
+ * @return size_t The dimension of the samples.
+ */
+size_t Dataset::getDimension() const
+{
+    return coordinateCount;
+}
+
+/**
+ * @brief Returns the number of samples.
+ *
+ * @return size_t The number of samples.
+ */
+size_t Dataset::size() const
+{
+    return labels.size();  ///< The cluster IDs are owned by views too
+}
+
+/**
+ * @brief Returns whether the dataset holds no sample.
+ *
+ * @return true If the dataset is empty.
+ */
+bool Dataset::empty() const
+{
+    return labels.empty();
+}
+
+/**
+ * @brief Reserves memory in every column for a number of samples.
+ *
+ * @param count The number of samples to reserve memory for.
+ */
+void Dataset::reserve(size_t count)
+{
+    detach();
+    indices.reserve(count);
+    visitPrecision(storedPrecision, [&](auto* type) {
+        for (auto& column : storedColumns<remove_pointer_t<decltype(type)>>()) {
+            column.reserve(count);
+        }
+        });
+    labels.reserve(count);
+}
+
+/**
+ * @brief Removes all the samples.
+ */
+void Dataset::clear()
+{
+    if (viewOwner) {
+        columns.assign(viewColumns.size(), Column<double>());  ///< Drop the view, keep the dimension
+        viewOwner.reset();
+        viewIndices = nullptr;
+        viewColumns.clear();
+    }
+    indices.clear();
+    visitPrecision(storedPrecision, [&](auto* type) {
+        for (auto& column : storedColumns<remove_pointer_t<decltype(type)>>()) {
+            column.clear();
+        }
+        });
+    labels.clear();
+}
+
+/**
+ * @brief Removes all the samples and changes the number of coordinates and the type they are stored in.
+ *
+ * @param dimension The new number of coordinates of every sample.
+ * @param precision The type of the stored coordinates.
+ * @throws invalid_argument If the dimension is 0.
+ */
+void Dataset::reset(size_t dimension, Precision precision)
+{
+    if (dimension == 0) {
+        throw invalid_argument("A sample needs at least one coordinate.");
+    }
+
+    clear();
+    columns.clear();
+    floatColumns.clear();
+    halfColumns.clear();
+    bfloat16Columns.clear();
+    coordinateCount = dimension;
+    storedPrecision = precision;
+    visitPrecision(precision, [&](auto* type) {
+        using T = remove_pointer_t<decltype(type)>;
+        storedColumns<T>().assign(dimension, Column<T>());
+        });
+}
+
+/**
+ * @brief Returns the type the coordinates are stored in.
+ *
+ * @return Precision The precision of the stored coordinates.
+ */
+Precision Dataset::getPrecision() const
+{
+    return storedPrecision;
+}
+
+/**
+ * @brief Converts the stored coordinates to another type, one column at a time, freeing each
+ *        column of the previous type once converted. A view is released once its samples are copied.
+ *
+ * @param precision The new type of the stored coordinates.
+ */
+void Dataset::setPrecision(Precision precision)
+{
+    if (precision == storedPrecision) return;
+
+    const size_t count = labels.size();
+    visitPrecision(storedPrecision, [&](auto* source) {
+        using From = remove_pointer_t<decltype(source)>;
+        visitPrecision(precision, [&](auto* target) {
+            using To = remove_pointer_t<decltype(target)>;
+            if constexpr (!is_same<From, To>::value) {
+                vector<Column<To>>& converted = storedColumns<To>();
+                converted.assign(coordinateCount, Column<To>());
+                for (size_t d = 0; d < coordinateCount; ++d) {
+                    const From* column = getStoredColumn<From>(d);
+                    converted[d].resize(count);
+                    for (size_t i = 0; i < count; ++i) {
+                        converted[d][i] = narrow<To>(widen(column[i]));
+                    }
+                    if (!viewOwner) {
+                        Column<From>().swap(storedColumns<From>()[d]);  ///< Frees the memory, unlike clear()
+                    }
+                }
+                storedColumns<From>().clear();
+            }
+            });
+        });
+
+    if (viewOwner) {
+        indices.assign(viewIndices, viewIndices + count);
+        viewOwner.reset();
+        viewIndices = nullptr;
+        viewColumns.clear();
+    }
+    storedPrecision = precision;
+}
+
+/**
+ * @brief Appends a sample to every column.
+ *
+ * @param index The index of the sample, as read from the input file.
+ * @param coordinates The getDimension() coordinates of the sample.
+ */
+void Dataset::addSample(int index, const double* coordinates)
+{
+    detach();
+    indices.push_back(index);
+    visitPrecision(storedPrecision, [&](auto* type) {
+        using T = remove_pointer_t<decltype(type)>;
+        vector<Column<T>>& stored = storedColumns<T>();
+        for (size_t d = 0; d < coordinateCount; ++d) {
+            stored[d].push_back(narrow<T>(coordinates[d]));
+        }
+        });
+    labels.push_back(-1);
+}
+
+/**
+ * @brief Changes the number of samples in every column.
+ *
+ * @param count The new number of samples.
+ */
+void Dataset::resize(size_t count)
+{
+    detach();
+    indices.resize(count, 0);
+    visitPrecision(storedPrecision, [&](auto* type) {
+        using T = remove_pointer_t<decltype(type)>;
+        for (auto& column : storedColumns<T>()) {
+            column.resize(count, narrow<T>(0.0));
+        }
+        });
+    labels.resize(count, -1);
+}
+
+/**
+ * @brief Returns a view of one sample that can change its cluster ID.
+ *
+ * @param row The position of the sample in the dataset.
+ * @return Sample A view of the sample.
+ */
+Sample Dataset::operator[](size_t row)
+{
+    return Sample(this, row);
+}
+
+/**
+ * @brief Returns a read-only view of one sample.
+ *
+ * @param row The position of the sample in the dataset.
+ * @return const Sample A view of the sample.
+ */
+const Sample Dataset::operator[](size_t row) const
+{
+    return Sample(const_cast<Dataset*>(this), row);  ///< The const view cannot call setClusterID()
+}
+
+/**
+ * @brief Returns the array of sample indices.
+ *
+ * @return const int* The indices.
+ */
+const int* Dataset::getIndices() const
+{
+    return viewOwner ? viewIndices : indices.data();
+}
+
+/**
+ * @brief Returns the array of sample indices, to fill it in place.
+ *
+ * @return int* The indices.
+ */
+int* Dataset::getWritableIndices()
+{
+    detach();
+    return indices.data();
+}
+
+/**
+ * @brief Returns the array holding one coordinate of every sample stored as doubles.
+ *
+ * @param dimension The coordinate, from 0 to getDimension() - 1.
+ * @return const double* The coordinates.
+ * @throws runtime_error If the coordinates are stored in a reduced precision.
+ */
+const double* Dataset::getColumn(size_t dimension) const
+{
+    if (storedPrecision != Precision::Double) {
+        throw runtime_error("The samples are not stored in double precision.");
+    }
+    return viewOwner ? viewColumns[dimension] : columns[dimension].data();
+}
+
+/**
+ * @brief Returns the array holding one coordinate of every sample stored as doubles, to fill it in place.
+ *
+ * @param dimension The coordinate, from 0 to getDimension() - 1.
+ * @return double* The coordinates.
+ * @throws runtime_error If the coordinates are stored in a reduced precision.
+ */
+double* Dataset::getWritableColumn(size_t dimension)
+{
+    if (storedPrecision != Precision::Double) {
+        throw runtime_error("The samples are not stored in double precision.");
+    }
+    detach();
+    return columns[dimension].data();
+}
+
+/**
+ * @brief Returns one coordinate of one sample, widened to a double.
+ *
+ * @param dimension The coordinate, from 0 to getDimension() - 1.
+ * @param row The position of the sample in the dataset.
+ * @return double The coordinate.
+ */
+double Dataset::getCoordinate(size_t dimension, size_t row) const
+{
+    double value = 0.0;
+    visitPrecision(storedPrecision, [&](auto* type) {
+        value = widen(getStoredColumn<remove_pointer_t<decltype(type)>>(dimension)[row]);
+        });
+    return value;
+}
+
+/**
+ * @brief Copies the coordinates of one sample into a point, widened to doubles.
+ *
+ * @param row The position of the sample in the dataset.
+ * @param point Receives the getDimension() coordinates.
+ */
+void Dataset::loadSample(size_t row, double* point) const
+{
+    visitPrecision(storedPrecision, [&](auto* type) {
+        for (size_t d = 0; d < coordinateCount; ++d) {
+            point[d] = widen(getStoredColumn<remove_pointer_t<decltype(type)>>(d)[row]);
+        }
+        });
+}
+
+/**
+ * @brief Copies the coordinates of a range of samples into rows of doubles, one per dimension.
+ *
+ * @param begin The first sample.
+ * @param end One past the last sample.
+ * @param target Receives coordinate d of sample begin + i at d * stride + i.
+ * @param stride The distance between two rows of the target, at least end - begin.
+ */
+void Dataset::copyRows(size_t begin, size_t end, double* target, size_t stride) const
+{
+    visitPrecision(storedPrecision, [&](auto* type) {
+        for (size_t d = 0; d < coordinateCount; ++d) {
+            const auto* column = getStoredColumn<remove_pointer_t<decltype(type)>>(d);
+            double* row = target + d * stride;
+            for (size_t i = begin; i < end; ++i) {
+                row[i - begin] = widen(column[i]);
+            }
+        }
+        });
+}
+
+/**
+ * @brief Makes the dataset a read-only view of external arrays.
+ *
+ * @param count The number of samples.
+ * @param indices The sample indices.
+ * @param columns One array of coordinates per dimension.
+ * @param owner Keeps the arrays alive as long as the dataset uses them.
+ * @throws invalid_argument If there is no column.
+ */
+void Dataset::attach(size_t count, const int* indices, const vector<const double*>& columns, shared_ptr<const void> owner)
+{
+    reset(columns.size());
+    viewOwner = move(owner);
+    viewIndices = indices;
+    viewColumns = columns;
+    labels.assign(count, -1);
+}
+
+/**
+ * @brief Returns whether the samples are a view of external arrays.
+ *
+ * @return true If the samples are a view.
+ */
+bool Dataset::isView() const
+{
+    return static_cast<bool>(viewOwner);
+}
+
+/**
+ * @brief Copies the samples of a view into owned columns; does nothing for owned samples.
+ */
+void Dataset::detach()
+{
+    if (!viewOwner) return;
+
+    const size_t count = labels.size();
+    indices.assign(viewIndices, viewIndices + count);
+    columns.assign(viewColumns.size(), Column<double>());
+    for (size_t d = 0; d < columns.size(); ++d) {
+        columns[d].assign(viewColumns[d], viewColumns[d] + count);
+    }
+    viewOwner.reset();
+    viewIndices = nullptr;
+    viewColumns.clear();
+}
+
+/**
+ * @brief Returns the array of cluster IDs.
+ *
+ * @return int* The cluster IDs.
+ */
+int* Dataset::getLabels()
+{
+    return labels.data();
+}
+
+/**
+ * @brief Returns the array of cluster IDs.
+ *
+ * @return const int* The cluster IDs.
+ */
+const int* Dataset::getLabels() const
+{
+    return labels.data();
+}
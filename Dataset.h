@@ -0,0 +1,388 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "AlignedAllocator.h"
+#include "HalfFloat.h"
+#include "KMeansOptions.h"
+#include "Sample.h"
+
+using namespace std;
+
+/**
+ * @class Dataset
+ * @brief Contiguous structure-of-arrays storage of all the samples of the K-means algorithm.
+ *        Every coordinate (one per dimension) and the cluster IDs are kept in separate arrays
+ *        aligned to 64 bytes, so the assignment loops stream through memory linearly and can be
+ *        vectorized. Single samples are accessed through lightweight Sample views.
+ *
+ *        The indices and coordinates can also be a read-only view of arrays owned by someone else,
+ *        such as a memory-mapped binary file (see attach()); the cluster IDs are always owned.
+ *        Any change to the samples of a view first copies them into owned columns.
+ *
+ *        The coordinates are stored as doubles, or in one of the reduced precisions of the Lloyd
+ *        search, chosen when the samples are loaded (see reset() and setPrecision()): floats take half
+ *        the memory, halves and bfloat16 a quarter, and no double copy is kept. getColumn() only
+ *        serves double samples; code that works on doubles whatever the storage reads the samples
+ *        through getCoordinate(), loadSample() or copyRows(), which widen the stored values.
+ */
+class Dataset
+{
+public:
+
+    /** A column of the dataset, aligned for SIMD loads. */
+    template <typename T>
+    using Column = vector<T, AlignedAllocator<T>>;
+
+    /**
+     * @brief Constructor that creates an empty dataset.
+     *
+     * @param dimension The number of coordinates of every sample.
+     * @throws invalid_argument If the dimension is 0.
+     */
+    Dataset(size_t dimension = 2);
+
+    /**
+     * @brief Returns the number of coordinates of every sample.
+     *
+     * @return The dimension of the samples.
+     */
+    size_t getDimension() const;
+
+    /**
+     * @brief Returns the number of samples.
+     *
+     * @return The number of samples.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns whether the dataset holds no sample.
+     *
+     * @return true If the dataset is empty.
+     */
+    bool empty() const;
+
+    /**
+     * @brief Reserves memory for a number of samples.
+     *
+     * @param count The number of samples to reserve memory for.
+     */
+    void reserve(size_t count);
+
+    /**
+     * @brief Removes all the samples.
+     */
+    void clear();
+
+    /**
+     * @brief Removes all the samples and changes the number of coordinates and the type they are stored in.
+     *
+     * @param dimension The new number of coordinates of every sample.
+     * @param precision The type of the stored coordinates.
+     * @throws invalid_argument If the dimension is 0.
+     */
+    void reset(size_t dimension, Precision precision = Precision::Double);
+
+    /**
+     * @brief Returns the type the coordinates are stored in.
+     *
+     * @return The precision of the stored coordinates.
+     */
+    Precision getPrecision() const;
+
+    /**
+     * @brief Converts the stored coordinates to another type, one column at a time: each column of the
+     *        previous type is freed once converted, so the memory in use never exceeds the larger of
+     *        the two sets by more than a column. The samples of a view are copied into owned columns,
+     *        unless they stay doubles.
+     *
+     * @param precision The new type of the stored coordinates.
+     */
+    void setPrecision(Precision precision);
+
+    /**
+     * @brief Appends a sample that does not belong to any cluster yet (cluster ID -1).
+     *
+     * @param index The index of the sample, as read from the input file.
+     * @param coordinates The getDimension() coordinates of the sample, rounded to the stored type.
+     */
+    void addSample(int index, const double* coordinates);
+
+    /**
+     * @brief Changes the number of samples. New samples have index 0, coordinates 0 and cluster ID -1;
+     *        they are meant to be filled in place through getWritableIndices() and getWritableColumn(), for example by
+     *        loaders that write several ranges of rows in parallel.
+     *
+     * @param count The new number of samples.
+     */
+    void resize(size_t count);
+
+    /**
+     * @brief Returns a view of one sample that can change its cluster ID.
+     *
+     * @param row The position of the sample in the dataset.
+     * @return A view of the sample.
+     */
+    Sample operator[](size_t row);
+
+    /**
+     * @brief Returns a read-only view of one sample.
+     *
+     * @param row The position of the sample in the dataset.
+     * @return A view of the sample.
+     */
+    const Sample operator[](size_t row) const;
+
+    /**
+     * @brief Returns the array of sample indices read from the input file.
+     *
+     * @return A pointer to size() indices.
+     */
+    const int* getIndices() const;
+
+    /**
+     * @brief Returns the array of sample indices, to fill it in place.
+     *
+     * @return A pointer to size() indices.
+     */
+    int* getWritableIndices();
+
+    /**
+     * @brief Returns the array holding one coordinate of every sample stored as doubles.
+     *
+     * @param dimension The coordinate, from 0 to getDimension() - 1.
+     * @return A pointer to size() coordinates, aligned to 64 bytes.
+     * @throws runtime_error If the coordinates are stored in a reduced precision.
+     */
+    const double* getColumn(size_t dimension) const;
+
+    /**
+     * @brief Returns the array holding one coordinate of every sample stored as doubles, to fill it in place.
+     *
+     * @param dimension The coordinate, from 0 to getDimension() - 1.
+     * @return A pointer to size() coordinates, aligned to 64 bytes.
+     * @throws runtime_error If the coordinates are stored in a reduced precision.
+     */
+    double* getWritableColumn(size_t dimension);
+
+    /**
+     * @brief Returns the array holding one coordinate of every sample in the stored type.
+     *
+     * @tparam T double, float, Half or BFloat16: the type of getPrecision().
+     * @param dimension The coordinate, from 0 to getDimension() - 1.
+     * @return A pointer to size() coordinates, aligned to 64 bytes.
+     */
+    template <typename T>
+    const T* getStoredColumn(size_t dimension) const;
+
+    /**
+     * @brief Returns the array holding one coordinate of every sample in the stored type, to fill it in place.
+     *
+     * @tparam T double, float, Half or BFloat16: the type of getPrecision().
+     * @param dimension The coordinate, from 0 to getDimension() - 1.
+     * @return A pointer to size() coordinates, aligned to 64 bytes.
+     */
+    template <typename T>
+    T* getWritableStoredColumn(size_t dimension);
+
+    /**
+     * @brief Returns one coordinate of one sample, widened to a double.
+     *
+     * @param dimension The coordinate, from 0 to getDimension() - 1.
+     * @param row The position of the sample in the dataset.
+     * @return The coordinate.
+     */
+    double getCoordinate(size_t dimension, size_t row) const;
+
+    /**
+     * @brief Copies the coordinates of one sample into a point, widened to doubles.
+     *
+     * @param row The position of the sample in the dataset.
+     * @param point Receives the getDimension() coordinates.
+     */
+    void loadSample(size_t row, double* point) const;
+
+    /**
+     * @brief Copies the coordinates of a range of samples into rows of doubles, one per dimension.
+     *
+     * @param begin The first sample.
+     * @param end One past the last sample.
+     * @param target Receives coordinate d of sample begin + i at d * stride + i.
+     * @param stride The distance between two rows of the target, at least end - begin.
+     */
+    void copyRows(size_t begin, size_t end, double* target, size_t stride) const;
+
+    /**
+     * @brief Rounds a coordinate to a stored type, the way every conversion of the dataset does:
+     *        halves and bfloat16 are rounded from the float nearest to the double.
+     *
+     * @tparam T double, float, Half or BFloat16.
+     * @param value The coordinate.
+     * @return The stored coordinate.
+     */
+    template <typename T>
+    static T narrow(double value);
+
+    /**
+     * @brief Calls a function with a null pointer of the type of a precision (double, float, Half or
+     *        BFloat16), which selects the code written for that type.
+     *
+     * @param precision The precision.
+     * @param function The function, a generic lambda taking a T*.
+     */
+    template <typename Function>
+    static void visitPrecision(Precision precision, Function function);
+
+    /**
+     * @brief Makes the dataset a read-only view of external arrays, without copying them.
+     *        Every sample gets cluster ID -1.
+     *
+     * @param count The number of samples.
+     * @param indices The count sample indices.
+     * @param columns One array of count coordinates per dimension, best aligned to 64 bytes.
+     * @param owner Keeps the arrays alive as long as the dataset uses them.
+     * @throws invalid_argument If there is no column.
+     */
+    void attach(size_t count, const int* indices, const vector<const double*>& columns, shared_ptr<const void> owner);
+
+    /**
+     * @brief Returns whether the samples are a view of external arrays.
+     *
+     * @return true If attach() was called and the samples have not been changed since.
+     */
+    bool isView() const;
+
+    /**
+     * @brief Returns the array of cluster IDs.
+     *
+     * @return A pointer to size() cluster IDs, aligned to 64 bytes.
+     */
+    int* getLabels();
+
+    /**
+     * @brief Returns the array of cluster IDs.
+     *
+     * @return A pointer to size() cluster IDs, aligned to 64 bytes.
+     */
+    const int* getLabels() const;
+
+private:
+
+    /** The index of each sample, as read from the input file. */
+    vector<int> indices;
+
+    /** The number of coordinates of every sample. */
+    size_t coordinateCount = 0;
+
+    /** The type the coordinates are stored in; only the columns of that type are used. */
+    Precision storedPrecision = Precision::Double;
+
+    /** Double precision: one column per dimension, holding that coordinate of each sample. */
+    vector<Column<double>> columns;
+
+    /** Single precision: the coordinates as floats, one column per dimension. */
+    vector<Column<float>> floatColumns;
+
+    /** Half precision: the coordinates as halves, one column per dimension. */
+    vector<Column<Half>> halfColumns;
+
+    /** Bfloat16 precision: the coordinates as bfloat16, one column per dimension. */
+    vector<Column<BFloat16>> bfloat16Columns;
+
+    /** The ID of the cluster each sample belongs to (-1 before the first assignment). */
+    Column<int> labels;
+
+    /** Keeps the arrays of a view alive; empty when the dataset owns its samples. */
+    shared_ptr<const void> viewOwner;
+
+    /** The indices of a view. */
+    const int* viewIndices = nullptr;
+
+    /** The columns of a view. */
+    vector<const double*> viewColumns;
+
+    /**
+     * @brief Copies the samples of a view into owned columns before they are changed.
+     */
+    void detach();
+
+    /**
+     * @brief Returns the owned columns of a stored type.
+     *
+     * @tparam T double, float, Half or BFloat16.
+     * @return The columns, empty unless T is the stored type.
+     */
+    template <typename T>
+    vector<Column<T>>& storedColumns();
+
+    /**
+     * @brief Returns the owned columns of a stored type.
+     *
+     * @tparam T double, float, Half or BFloat16.
+     * @return The columns, empty unless T is the stored type.
+     */
+    template <typename T>
+    const vector<Column<T>>& storedColumns() const;
+
+};
+
+template <typename T>
+vector<Dataset::Column<T>>& Dataset::storedColumns()
+{
+    return const_cast<vector<Column<T>>&>(static_cast<const Dataset*>(this)->storedColumns<T>());
+}
+
+template <typename T>
+const vector<Dataset::Column<T>>& Dataset::storedColumns() const
+{
+    if constexpr (is_same<T, double>::value) return columns;
+    else if constexpr (is_same<T, float>::value) return floatColumns;
+    else if constexpr (is_same<T, Half>::value) return halfColumns;
+    else return bfloat16Columns;
+}
+
+template <typename Function>
+void Dataset::visitPrecision(Precision precision, Function function)
+{
+    switch (precision) {
+    case Precision::Single:
+        function(static_cast<float*>(nullptr));
+        break;
+    case Precision::Half:
+        function(static_cast<Half*>(nullptr));
+        break;
+    case Precision::BFloat16:
+        function(static_cast<BFloat16*>(nullptr));
+        break;
+    default:
+        function(static_cast<double*>(nullptr));
+        break;
+    }
+}
+
+template <typename T>
+const T* Dataset::getStoredColumn(size_t dimension) const
+{
+    if constexpr (is_same<T, double>::value) return getColumn(dimension);
+    else return storedColumns<T>()[dimension].data();
+}
+
+template <typename T>
+T* Dataset::getWritableStoredColumn(size_t dimension)
+{
+    if constexpr (is_same<T, double>::value) return getWritableColumn(dimension);
+    else return storedColumns<T>()[dimension].data();
+}
+
+template <typename T>
+T Dataset::narrow(double value)
+{
+    if constexpr (is_same<T, Half>::value) return toHalf(static_cast<float>(value));
+    else if constexpr (is_same<T, BFloat16>::value) return toBFloat16(static_cast<float>(value));
+    else return static_cast<T>(value);
+}
+
+#endif
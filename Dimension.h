@@ -0,0 +1,249 @@
+#ifndef DIMENSION_H
+#define DIMENSION_H
+
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct StaticDimension
+ * @brief A number of coordinates known at compile time.
+ *        The kernels below are fully unrolled for it and the points live in registers or on the stack.
+ *
+ * @tparam D The number of coordinates.
+ */
+template <size_t D>
+struct StaticDimension
+{
+    /** Scratch storage for one point of scalar type T. */
+    template <typename T = double>
+    using Point = array<T, D>;
+
+    /**
+     * @brief Returns the number of coordinates.
+     *
+     * @return D.
+     */
+    static constexpr size_t size() { return D; }
+
+    /**
+     * @brief Creates scratch storage for one point.
+     *
+     * @tparam T The scalar type of the coordinates.
+     * @return An uninitialized point.
+     */
+    template <typename T = double>
+    Point<T> makePoint() const { return Point<T>(); }
+};
+
+/**
+ * @struct DynamicDimension
+ * @brief A number of coordinates only known at run time, for the sizes without a specialization.
+ */
+struct DynamicDimension
+{
+    /** Scratch storage for one point of scalar type T. */
+    template <typename T = double>
+    using Point = vector<T>;
+
+    /** The number of coordinates. */
+    size_t dimension;
+
+    /**
+     * @brief Returns the number of coordinates.
+     *
+     * @return The number of coordinates.
+     */
+    size_t size() const { return dimension; }
+
+    /**
+     * @brief Creates scratch storage for one point.
+     *
+     * @tparam T The scalar type of the coordinates.
+     * @return A point of dimension coordinates.
+     */
+    template <typename T = double>
+    Point<T> makePoint() const { return Point<T>(dimension); }
+};
+
+/**
+ * @brief Unrolled body of squaredDistance() for StaticDimension.
+ *        The sum starts from the first term rather than from 0 to save one addition.
+ */
+template <typename T, size_t... I>
+inline T unrolledSquaredDistance(const T* a, const T* b, index_sequence<0, I...>)
+{
+    T sum = (a[0] - b[0]) * (a[0] - b[0]);
+    ((sum += (a[I] - b[I]) * (a[I] - b[I])), ...);
+    return sum;
+}
+
+/**
+ * @brief Returns the squared Euclidean distance between two points of D coordinates.
+ *        The terms are added in coordinate order, exactly like the DynamicDimension loop,
+ *        so both paths return the same bits. The sum has the scalar type of the coordinates.
+ *
+ * @param a The coordinates of the first point.
+ * @param b The coordinates of the second point.
+ * @return The squared distance.
+ */
+template <typename T, size_t D>
+inline T squaredDistance(const T* a, const T* b, StaticDimension<D>)
+{
+    return unrolledSquaredDistance(a, b, make_index_sequence<D>());
+}
+
+/**
+ * @brief Returns the squared Euclidean distance between two points.
+ *
+ * @param a The coordinates of the first point.
+ * @param b The coordinates of the second point.
+ * @param dim The number of coordinates.
+ * @return The squared distance.
+ */
+template <typename T>
+inline T squaredDistance(const T* a, const T* b, DynamicDimension dim)
+{
+    T sum = (a[0] - b[0]) * (a[0] - b[0]);
+    for (size_t d = 1; d < dim.size(); ++d) {
+        sum += (a[d] - b[d]) * (a[d] - b[d]);
+    }
+    return sum;
+}
+
+/**
+ * @brief Unrolled body of gatherPoint() for StaticDimension.
+ */
+template <typename T, size_t... I>
+inline void unrolledGatherPoint(const T* const* columns, size_t row, T* point, index_sequence<I...>)
+{
+    ((point[I] = columns[I][row]), ...);
+}
+
+/**
+ * @brief Copies one row of column-major data into a point.
+ *
+ * @param columns One array per coordinate.
+ * @param row The row to copy.
+ * @param point Receives the D coordinates of the row.
+ */
+template <typename T, size_t D>
+inline void gatherPoint(const T* const* columns, size_t row, T* point, StaticDimension<D>)
+{
+    unrolledGatherPoint(columns, row, point, make_index_sequence<D>());
+}
+
+/**
+ * @brief Copies one row of column-major data into a point.
+ *
+ * @param columns One array per coordinate.
+ * @param row The row to copy.
+ * @param point Receives the coordinates of the row.
+ * @param dim The number of coordinates.
+ */
+template <typename T>
+inline void gatherPoint(const T* const* columns, size_t row, T* point, DynamicDimension dim)
+{
+    for (size_t d = 0; d < dim.size(); ++d) {
+        point[d] = columns[d][row];
+    }
+}
+
+/**
+ * @brief Unrolled body of accumulatePoint() for StaticDimension.
+ */
+template <size_t... I>
+inline void unrolledAccumulatePoint(double* sums, const double* point, index_sequence<I...>)
+{
+    ((sums[I] += point[I]), ...);
+}
+
+/**
+ * @brief Adds the coordinates of a point to running sums.
+ *
+ * @param sums The D sums to update.
+ * @param point The coordinates to add.
+ */
+template <size_t D>
+inline void accumulatePoint(double* sums, const double* point, StaticDimension<D>)
+{
+    unrolledAccumulatePoint(sums, point, make_index_sequence<D>());
+}
+
+/**
+ * @brief Adds the coordinates of a point to running sums.
+ *
+ * @param sums The sums to update.
+ * @param point The coordinates to add.
+ * @param dim The number of coordinates.
+ */
+inline void accumulatePoint(double* sums, const double* point, DynamicDimension dim)
+{
+    for (size_t d = 0; d < dim.size(); ++d) {
+        sums[d] += point[d];
+    }
+}
+
+/**
+ * @brief Unrolled body of removePoint() for StaticDimension.
+ */
+template <size_t... I>
+inline void unrolledRemovePoint(double* sums, const double* point, index_sequence<I...>)
+{
+    ((sums[I] -= point[I]), ...);
+}
+
+/**
+ * @brief Subtracts the coordinates of a point from running sums.
+ *
+ * @param sums The D sums to update.
+ * @param point The coordinates to subtract.
+ */
+template <size_t D>
+inline void removePoint(double* sums, const double* point, StaticDimension<D>)
+{
+    unrolledRemovePoint(sums, point, make_index_sequence<D>());
+}
+
+/**
+ * @brief Subtracts the coordinates of a point from running sums.
+ *
+ * @param sums The sums to update.
+ * @param point The coordinates to subtract.
+ * @param dim The number of coordinates.
+ */
+inline void removePoint(double* sums, const double* point, DynamicDimension dim)
+{
+    for (size_t d = 0; d < dim.size(); ++d) {
+        sums[d] -= point[d];
+    }
+}
+
+/**
+ * @brief Calls a generic function with the dimension object matching a run-time number of coordinates:
+ *        a StaticDimension for 2, 3, 4, 8, 16, 32, 64 and 128, and a DynamicDimension otherwise.
+ *        Hot loops are written once as a generic lambda and compiled once per specialization.
+ *
+ * @param dimension The number of coordinates.
+ * @param function The function to call, taking the dimension object as its only argument.
+ */
+template <typename Function>
+inline void dispatchDimension(size_t dimension, Function&& function)
+{
+    switch (dimension) {
+    case 2:   function(StaticDimension<2>());   break;
+    case 3:   function(StaticDimension<3>());   break;
+    case 4:   function(StaticDimension<4>());   break;
+    case 8:   function(StaticDimension<8>());   break;
+    case 16:  function(StaticDimension<16>());  break;
+    case 32:  function(StaticDimension<32>());  break;
+    case 64:  function(StaticDimension<64>());  break;
+    case 128: function(StaticDimension<128>()); break;
+    default:  function(DynamicDimension{ dimension }); break;
+    }
+}
+
+#endif
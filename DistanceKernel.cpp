@@ -0,0 +1,1010 @@
+/****************************************************************************
+ * @file DistanceKernel.cpp
+ * @brief Implementation of the DistanceKernel class: run-time detection of
+ *        AVX2 / AVX-512 and the scalar, AVX2 and AVX-512 versions of the
+ *        nearest-center search, in double and in single precision, and over
+ *        half and bfloat16 samples widened to single precision as they are
+ *        loaded, and the blocked search of the GEMM engine.
+ *        The vector versions are compiled for their instruction set with
+ *        function attributes, so the rest of the program keeps running on
+ *        processors without them.
+ ****************************************************************************/
+
+#include "DistanceKernel.h"
+#include "Dimension.h"
+#include "HalfFloat.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define DISTANCEKERNEL_X86_64
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang need to be told which functions may use the wider instructions; MSVC accepts the intrinsics anywhere
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2,f16c,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+// The target attributes make FMA available, and GCC and Clang would then fuse the multiplications and
+// additions of the search, which would no longer compute the same bits as the scalar loop; the blocked
+// product asks for its fused operations explicitly. GCC ignores this pragma: the file must be compiled
+// with -ffp-contract=off there (MSVC does not fuse them with /fp:precise, set on this file in the project)
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#endif
+
+using namespace std;
+
+/** The number of coordinates multiplied per pass over a block of points, so that the tiles in use stay in the first-level cache. */
+static const size_t DEPTH_BLOCK = 128;
+
+/** The number of points per row of a block of points must be a multiple of this. */
+static const size_t POINT_ALIGNMENT = 32;
+
+/**
+ * @struct ComputeType
+ * @brief The type the distances of samples stored as S are computed in: the type itself for double
+ *        and float, float for the 16-bit formats.
+ */
+template <typename S>
+struct ComputeType
+{
+    typedef S type;
+};
+
+template <>
+struct ComputeType<Half>
+{
+    typedef float type;
+};
+
+template <>
+struct ComputeType<BFloat16>
+{
+    typedef float type;
+};
+
+/**
+ * @brief Copies one sample into a point of the compute type: a plain copy for double and float samples.
+ */
+template <typename T, typename Dim>
+static void widenPoint(const T* const* columns, size_t row, T* point, Dim dim)
+{
+    gatherPoint(columns, row, point, dim);
+}
+
+/**
+ * @brief Copies one half sample into a float point.
+ */
+template <typename Dim>
+static void widenPoint(const Half* const* columns, size_t row, float* point, Dim dim)
+{
+    for (size_t d = 0; d < dim.size(); ++d) {
+        point[d] = toFloat(columns[d][row]);
+    }
+}
+
+/**
+ * @brief Copies one bfloat16 sample into a float point.
+ */
+template <typename Dim>
+static void widenPoint(const BFloat16* const* columns, size_t row, float* point, Dim dim)
+{
+    for (size_t d = 0; d < dim.size(); ++d) {
+        point[d] = toFloat(columns[d][row]);
+    }
+}
+
+/**
+ * @brief Stores the result of one sample from its two smallest squared distances.
+ *        When the two square roots are equal the sample is searched again with the exact
+ *        distances, which applies the tie rule of the brute-force loop.
+ *
+ * @param columns One array per dimension.
+ * @param dimension The number of coordinates.
+ * @param row The sample.
+ * @param centers The centers, row-major.
+ * @param centerCount The number of centers.
+ * @param bestSquared The smallest squared distance.
+ * @param secondSquared The second smallest squared distance.
+ * @param best The first center with the smallest squared distance.
+ * @param nearest Receives the nearest center.
+ * @param distance Receives the distance to the nearest center.
+ */
+template <typename S, typename T>
+static void finishSample(const S* const* columns, size_t dimension, size_t row, const T* centers,
+    size_t centerCount, T bestSquared, T secondSquared, size_t best, size_t& nearest, T& distance)
+{
+    distance = sqrt(bestSquared);
+    nearest = best;
+    if (sqrt(secondSquared) != distance) return;
+
+    const DynamicDimension dim{ dimension };
+    vector<T> point(dimension);
+    widenPoint(columns, row, point.data(), dim);
+
+    distance = numeric_limits<T>::max();
+    for (size_t j = 0; j < centerCount; ++j) {
+        T d = sqrt(squaredDistance(point.data(), centers + j * dimension, dim));
+        if (d < distance) {
+            distance = d;
+            nearest = j;
+        }
+    }
+}
+
+/**
+ * @brief Scalar nearest-center search, also used for the samples left over by the vector versions.
+ */
+template <typename S, typename Dim, typename T = typename ComputeType<S>::type>
+static void findNearestScalar(const S* const* columns, Dim dim, size_t begin, size_t end,
+    const T* centers, size_t centerCount, size_t* nearest, T* distances)
+{
+    auto point = dim.template makePoint<T>();
+
+    for (size_t i = begin; i < end; ++i) {
+        widenPoint(columns, i, point.data(), dim);
+
+        T best = numeric_limits<T>::max();
+        T second = numeric_limits<T>::max();
+        size_t bestIndex = 0;
+        for (size_t j = 0; j < centerCount; ++j) {
+            T s = squaredDistance(point.data(), centers + j * dim.size(), dim);
+            second = min(second, max(best, s));
+            if (s < best) {
+                best = s;
+                bestIndex = j;
+            }
+        }
+
+        finishSample(columns, dim.size(), i, centers, centerCount, best, second, bestIndex,
+            nearest[i - begin], distances[i - begin]);
+    }
+}
+
+/**
+ * @brief Portable blocked search: the products are accumulated for every center, a coordinate at a
+ *        time over a whole row of points, then turned into ||c||^2 - 2 x.c and compared per point.
+ */
+static void findNearestBlockScalar(const double* points, size_t pointStride, size_t dimension,
+    const double* centers, const double* centerNorms, size_t centerCount, size_t* nearest, double* best, double* second,
+    double* products)
+{
+    fill(best, best + pointStride, numeric_limits<double>::max());
+    fill(second, second + pointStride, numeric_limits<double>::max());
+    fill(nearest, nearest + pointStride, 0);
+
+    for (size_t k = 0; k < centerCount; ++k) {
+        fill(products, products + pointStride, 0.0);
+        for (size_t d = 0; d < dimension; ++d) {
+            const double weight = centers[k * dimension + d];
+            const double* coordinates = points + d * pointStride;
+            for (size_t p = 0; p < pointStride; ++p) {
+                products[p] += coordinates[p] * weight;
+            }
+        }
+
+        for (size_t p = 0; p < pointStride; ++p) {
+            const double s = centerNorms[k] - (products[p] + products[p]);
+            second[p] = min(second[p], max(best[p], s));
+            if (s < best[p]) {
+                best[p] = s;
+                nearest[p] = k;
+            }
+        }
+    }
+}
+
+#ifdef DISTANCEKERNEL_X86_64
+
+/**
+ * @brief AVX2 nearest-center search, 8 samples per step. Each lane keeps its smallest squared
+ *        distance, the center it belongs to, and its second smallest squared distance.
+ */
+template <typename Dim>
+TARGET_AVX2 static void findNearestAvx2(const double* const* columns, Dim dim, size_t begin, size_t end,
+    const double* centers, size_t centerCount, size_t* nearest, double* distances)
+{
+    const size_t D = dim.size();
+    alignas(32) double best[8], second[8], bestIndex[8];
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256d best0 = _mm256_set1_pd(numeric_limits<double>::max()), best1 = best0;
+        __m256d second0 = best0, second1 = best0;
+        __m256d index0 = _mm256_setzero_pd(), index1 = index0;
+
+        for (size_t j = 0; j < centerCount; ++j) {
+            const double* center = centers + j * D;
+
+            // Same operations, in the same order, as squaredDistance()
+            __m256d c = _mm256_broadcast_sd(center);
+            __m256d t0 = _mm256_sub_pd(_mm256_loadu_pd(columns[0] + i), c);
+            __m256d t1 = _mm256_sub_pd(_mm256_loadu_pd(columns[0] + i + 4), c);
+            __m256d s0 = _mm256_mul_pd(t0, t0);
+            __m256d s1 = _mm256_mul_pd(t1, t1);
+            for (size_t d = 1; d < D; ++d) {
+                c = _mm256_broadcast_sd(center + d);
+                t0 = _mm256_sub_pd(_mm256_loadu_pd(columns[d] + i), c);
+                t1 = _mm256_sub_pd(_mm256_loadu_pd(columns[d] + i + 4), c);
+                s0 = _mm256_add_pd(s0, _mm256_mul_pd(t0, t0));
+                s1 = _mm256_add_pd(s1, _mm256_mul_pd(t1, t1));
+            }
+
+            // Strictly smaller only, so the first of equal centers is kept
+            const __m256d j4 = _mm256_set1_pd(static_cast<double>(j));
+            const __m256d closer0 = _mm256_cmp_pd(s0, best0, _CMP_LT_OQ);
+            const __m256d closer1 = _mm256_cmp_pd(s1, best1, _CMP_LT_OQ);
+            second0 = _mm256_min_pd(second0, _mm256_max_pd(best0, s0));
+            second1 = _mm256_min_pd(second1, _mm256_max_pd(best1, s1));
+            best0 = _mm256_blendv_pd(best0, s0, closer0);
+            best1 = _mm256_blendv_pd(best1, s1, closer1);
+            index0 = _mm256_blendv_pd(index0, j4, closer0);
+            index1 = _mm256_blendv_pd(index1, j4, closer1);
+        }
+
+        _mm256_store_pd(best, best0);
+        _mm256_store_pd(best + 4, best1);
+        _mm256_store_pd(second, second0);
+        _mm256_store_pd(second + 4, second1);
+        _mm256_store_pd(bestIndex, index0);
+        _mm256_store_pd(bestIndex + 4, index1);
+        for (size_t lane = 0; lane < 8; ++lane) {
+            finishSample(columns, D, i + lane, centers, centerCount, best[lane], second[lane],
+                static_cast<size_t>(bestIndex[lane]), nearest[i + lane - begin], distances[i + lane - begin]);
+        }
+    }
+
+    findNearestScalar(columns, dim, i, end, centers, centerCount, nearest + (i - begin), distances + (i - begin));
+}
+
+/**
+ * @brief Loads 8 float coordinates.
+ */
+TARGET_AVX2 static inline __m256 loadAvx2(const float* values)
+{
+    return _mm256_loadu_ps(values);
+}
+
+/**
+ * @brief Loads 8 half coordinates and widens them to floats with F16C.
+ */
+TARGET_AVX2 static inline __m256 loadAvx2(const Half* values)
+{
+    return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values)));
+}
+
+/**
+ * @brief Loads 8 bfloat16 coordinates and widens them to floats, which only appends 16 zero bits.
+ */
+TARGET_AVX2 static inline __m256 loadAvx2(const BFloat16* values)
+{
+    const __m256i widened = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values)));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(widened, 16));
+}
+
+/**
+ * @brief Single-precision AVX2 nearest-center search, 16 samples per step (two registers of 8).
+ *        Half and bfloat16 samples are widened to floats once per step, into a tile of 16 x D floats
+ *        that stays in the first-level cache while it is compared with every center.
+ *        The center indices are kept in float lanes, which hold every index below 2^24 exactly.
+ */
+template <typename S, typename Dim>
+TARGET_AVX2 static void findNearestAvx2(const S* const* columns, Dim dim, size_t begin, size_t end,
+    const float* centers, size_t centerCount, size_t* nearest, float* distances)
+{
+    const size_t D = dim.size();
+    alignas(32) float best[16], second[16], bestIndex[16];
+    vector<float> tile;
+    vector<const float*> tileColumns;
+    if (!is_same<S, float>::value) {
+        tile.resize(16 * D);
+        for (size_t d = 0; d < D; ++d) {
+            tileColumns.push_back(tile.data() + 16 * d);
+        }
+    }
+
+    size_t i = begin;
+    for (; i + 16 <= end; i += 16) {
+        // The center loop reads coordinate d of the step's samples at rows[d] + at
+        const float* const* rows;
+        size_t at;
+        if constexpr (is_same<S, float>::value) {
+            rows = columns;
+            at = i;
+        }
+        else {
+            for (size_t d = 0; d < D; ++d) {
+                _mm256_storeu_ps(tile.data() + 16 * d, loadAvx2(columns[d] + i));
+                _mm256_storeu_ps(tile.data() + 16 * d + 8, loadAvx2(columns[d] + i + 8));
+            }
+            rows = tileColumns.data();
+            at = 0;
+        }
+
+        __m256 best0 = _mm256_set1_ps(numeric_limits<float>::max()), best1 = best0;
+        __m256 second0 = best0, second1 = best0;
+        __m256 index0 = _mm256_setzero_ps(), index1 = index0;
+
+        for (size_t j = 0; j < centerCount; ++j) {
+            const float* center = centers + j * D;
+
+            // Same operations, in the same order, as squaredDistance()
+            __m256 c = _mm256_broadcast_ss(center);
+            __m256 t0 = _mm256_sub_ps(_mm256_loadu_ps(rows[0] + at), c);
+            __m256 t1 = _mm256_sub_ps(_mm256_loadu_ps(rows[0] + at + 8), c);
+            __m256 s0 = _mm256_mul_ps(t0, t0);
+            __m256 s1 = _mm256_mul_ps(t1, t1);
+            for (size_t d = 1; d < D; ++d) {
+                c = _mm256_broadcast_ss(center + d);
+                t0 = _mm256_sub_ps(_mm256_loadu_ps(rows[d] + at), c);
+                t1 = _mm256_sub_ps(_mm256_loadu_ps(rows[d] + at + 8), c);
+                s0 = _mm256_add_ps(s0, _mm256_mul_ps(t0, t0));
+                s1 = _mm256_add_ps(s1, _mm256_mul_ps(t1, t1));
+            }
+
+            // Strictly smaller only, so the first of equal centers is kept
+            const __m256 j8 = _mm256_set1_ps(static_cast<float>(j));
+            const __m256 closer0 = _mm256_cmp_ps(s0, best0, _CMP_LT_OQ);
+            const __m256 closer1 = _mm256_cmp_ps(s1, best1, _CMP_LT_OQ);
+            second0 = _mm256_min_ps(second0, _mm256_max_ps(best0, s0));
+            second1 = _mm256_min_ps(second1, _mm256_max_ps(best1, s1));
+            best0 = _mm256_blendv_ps(best0, s0, closer0);
+            best1 = _mm256_blendv_ps(best1, s1, closer1);
+            index0 = _mm256_blendv_ps(index0, j8, closer0);
+            index1 = _mm256_blendv_ps(index1, j8, closer1);
+        }
+
+        _mm256_store_ps(best, best0);
+        _mm256_store_ps(best + 8, best1);
+        _mm256_store_ps(second, second0);
+        _mm256_store_ps(second + 8, second1);
+        _mm256_store_ps(bestIndex, index0);
+        _mm256_store_ps(bestIndex + 8, index1);
+        for (size_t lane = 0; lane < 16; ++lane) {
+            finishSample(columns, D, i + lane, centers, centerCount, best[lane], second[lane],
+                static_cast<size_t>(bestIndex[lane]), nearest[i + lane - begin], distances[i + lane - begin]);
+        }
+    }
+
+    findNearestScalar(columns, dim, i, end, centers, centerCount, nearest + (i - begin), distances + (i - begin));
+}
+
+/**
+ * @brief Lane-wise minimum of 8 doubles. The masked form with every lane selected is the same
+ *        instruction as _mm512_min_pd(), whose undefined pass-through operand GCC reports as
+ *        possibly uninitialized.
+ */
+TARGET_AVX512 static inline __m512d minAvx512(__m512d a, __m512d b)
+{
+    return _mm512_mask_min_pd(a, 0xFF, a, b);
+}
+
+/**
+ * @brief Lane-wise maximum of 8 doubles, masked for the same reason as minAvx512().
+ */
+TARGET_AVX512 static inline __m512d maxAvx512(__m512d a, __m512d b)
+{
+    return _mm512_mask_max_pd(a, 0xFF, a, b);
+}
+
+/**
+ * @brief AVX-512 nearest-center search, 16 samples per step, with the same lane bookkeeping as the AVX2 version.
+ */
+template <typename Dim>
+TARGET_AVX512 static void findNearestAvx512(const double* const* columns, Dim dim, size_t begin, size_t end,
+    const double* centers, size_t centerCount, size_t* nearest, double* distances)
+{
+    const size_t D = dim.size();
+    alignas(64) double best[16], second[16], bestIndex[16];
+
+    size_t i = begin;
+    for (; i + 16 <= end; i += 16) {
+        __m512d best0 = _mm512_set1_pd(numeric_limits<double>::max()), best1 = best0;
+        __m512d second0 = best0, second1 = best0;
+        __m512d index0 = _mm512_setzero_pd(), index1 = index0;
+
+        for (size_t j = 0; j < centerCount; ++j) {
+            const double* center = centers + j * D;
+
+            // Same operations, in the same order, as squaredDistance()
+            __m512d c = _mm512_set1_pd(center[0]);
+            __m512d t0 = _mm512_sub_pd(_mm512_loadu_pd(columns[0] + i), c);
+            __m512d t1 = _mm512_sub_pd(_mm512_loadu_pd(columns[0] + i + 8), c);
+            __m512d s0 = _mm512_mul_pd(t0, t0);
+            __m512d s1 = _mm512_mul_pd(t1, t1);
+            for (size_t d = 1; d < D; ++d) {
+                c = _mm512_set1_pd(center[d]);
+                t0 = _mm512_sub_pd(_mm512_loadu_pd(columns[d] + i), c);
+                t1 = _mm512_sub_pd(_mm512_loadu_pd(columns[d] + i + 8), c);
+                s0 = _mm512_add_pd(s0, _mm512_mul_pd(t0, t0));
+                s1 = _mm512_add_pd(s1, _mm512_mul_pd(t1, t1));
+            }
+
+            // Strictly smaller only, so the first of equal centers is kept
+            const __m512d j8 = _mm512_set1_pd(static_cast<double>(j));
+            const __mmask8 closer0 = _mm512_cmp_pd_mask(s0, best0, _CMP_LT_OQ);
+            const __mmask8 closer1 = _mm512_cmp_pd_mask(s1, best1, _CMP_LT_OQ);
+            second0 = minAvx512(second0, maxAvx512(best0, s0));
+            second1 = minAvx512(second1, maxAvx512(best1, s1));
+            best0 = _mm512_mask_blend_pd(closer0, best0, s0);
+            best1 = _mm512_mask_blend_pd(closer1, best1, s1);
+            index0 = _mm512_mask_blend_pd(closer0, index0, j8);
+            index1 = _mm512_mask_blend_pd(closer1, index1, j8);
+        }
+
+        _mm512_store_pd(best, best0);
+        _mm512_store_pd(best + 8, best1);
+        _mm512_store_pd(second, second0);
+        _mm512_store_pd(second + 8, second1);
+        _mm512_store_pd(bestIndex, index0);
+        _mm512_store_pd(bestIndex + 8, index1);
+        for (size_t lane = 0; lane < 16; ++lane) {
+            finishSample(columns, D, i + lane, centers, centerCount, best[lane], second[lane],
+                static_cast<size_t>(bestIndex[lane]), nearest[i + lane - begin], distances[i + lane - begin]);
+        }
+    }
+
+    findNearestScalar(columns, dim, i, end, centers, centerCount, nearest + (i - begin), distances + (i - begin));
+}
+
+/**
+ * @brief Lane-wise minimum of 16 floats, masked for the same reason as the double minAvx512().
+ */
+TARGET_AVX512 static inline __m512 minAvx512(__m512 a, __m512 b)
+{
+    return _mm512_mask_min_ps(a, 0xFFFF, a, b);
+}
+
+/**
+ * @brief Lane-wise maximum of 16 floats, masked for the same reason as the double minAvx512().
+ */
+TARGET_AVX512 static inline __m512 maxAvx512(__m512 a, __m512 b)
+{
+    return _mm512_mask_max_ps(a, 0xFFFF, a, b);
+}
+
+/**
+ * @brief Loads 16 float coordinates.
+ */
+TARGET_AVX512 static inline __m512 loadAvx512(const float* values)
+{
+    return _mm512_loadu_ps(values);
+}
+
+/**
+ * @brief Loads 16 half coordinates and widens them to floats. Like minAvx512(), the conversion is
+ *        written in its masked form with every lane selected, to which GCC passes no undefined operand.
+ */
+TARGET_AVX512 static inline __m512 loadAvx512(const Half* values)
+{
+    return _mm512_maskz_cvtph_ps(0xFFFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values)));
+}
+
+/**
+ * @brief Loads 16 bfloat16 coordinates and widens them to floats, with the masked forms as for halves.
+ */
+TARGET_AVX512 static inline __m512 loadAvx512(const BFloat16* values)
+{
+    const __m512i widened = _mm512_maskz_cvtepu16_epi32(0xFFFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values)));
+    return _mm512_castsi512_ps(_mm512_maskz_slli_epi32(0xFFFF, widened, 16));
+}
+
+/**
+ * @brief Single-precision AVX-512 nearest-center search, 32 samples per step (two registers of 16),
+ *        with the same lane bookkeeping and tile of widened samples as the single-precision AVX2 version.
+ */
+template <typename S, typename Dim>
+TARGET_AVX512 static void findNearestAvx512(const S* const* columns, Dim dim, size_t begin, size_t end,
+    const float* centers, size_t centerCount, size_t* nearest, float* distances)
+{
+    const size_t D = dim.size();
+    alignas(64) float best[32], second[32], bestIndex[32];
+    vector<float> tile;
+    vector<const float*> tileColumns;
+    if (!is_same<S, float>::value) {
+        tile.resize(32 * D);
+        for (size_t d = 0; d < D; ++d) {
+            tileColumns.push_back(tile.data() + 32 * d);
+        }
+    }
+
+    size_t i = begin;
+    for (; i + 32 <= end; i += 32) {
+        const float* const* rows;
+        size_t at;
+        if constexpr (is_same<S, float>::value) {
+            rows = columns;
+            at = i;
+        }
+        else {
+            for (size_t d = 0; d < D; ++d) {
+                _mm512_storeu_ps(tile.data() + 32 * d, loadAvx512(columns[d] + i));
+                _mm512_storeu_ps(tile.data() + 32 * d + 16, loadAvx512(columns[d] + i + 16));
+            }
+            rows = tileColumns.data();
+            at = 0;
+        }
+
+        __m512 best0 = _mm512_set1_ps(numeric_limits<float>::max()), best1 = best0;
+        __m512 second0 = best0, second1 = best0;
+        __m512 index0 = _mm512_setzero_ps(), index1 = index0;
+
+        for (size_t j = 0; j < centerCount; ++j) {
+            const float* center = centers + j * D;
+
+            // Same operations, in the same order, as squaredDistance()
+            __m512 c = _mm512_set1_ps(center[0]);
+            __m512 t0 = _mm512_sub_ps(_mm512_loadu_ps(rows[0] + at), c);
+            __m512 t1 = _mm512_sub_ps(_mm512_loadu_ps(rows[0] + at + 16), c);
+            __m512 s0 = _mm512_mul_ps(t0, t0);
+            __m512 s1 = _mm512_mul_ps(t1, t1);
+            for (size_t d = 1; d < D; ++d) {
+                c = _mm512_set1_ps(center[d]);
+                t0 = _mm512_sub_ps(_mm512_loadu_ps(rows[d] + at), c);
+                t1 = _mm512_sub_ps(_mm512_loadu_ps(rows[d] + at + 16), c);
+                s0 = _mm512_add_ps(s0, _mm512_mul_ps(t0, t0));
+                s1 = _mm512_add_ps(s1, _mm512_mul_ps(t1, t1));
+            }
+
+            // Strictly smaller only, so the first of equal centers is kept
+            const __m512 j16 = _mm512_set1_ps(static_cast<float>(j));
+            const __mmask16 closer0 = _mm512_cmp_ps_mask(s0, best0, _CMP_LT_OQ);
+            const __mmask16 closer1 = _mm512_cmp_ps_mask(s1, best1, _CMP_LT_OQ);
+            second0 = minAvx512(second0, maxAvx512(best0, s0));
+            second1 = minAvx512(second1, maxAvx512(best1, s1));
+            best0 = _mm512_mask_blend_ps(closer0, best0, s0);
+            best1 = _mm512_mask_blend_ps(closer1, best1, s1);
+            index0 = _mm512_mask_blend_ps(closer0, index0, j16);
+            index1 = _mm512_mask_blend_ps(closer1, index1, j16);
+        }
+
+        _mm512_store_ps(best, best0);
+        _mm512_store_ps(best + 16, best1);
+        _mm512_store_ps(second, second0);
+        _mm512_store_ps(second + 16, second1);
+        _mm512_store_ps(bestIndex, index0);
+        _mm512_store_ps(bestIndex + 16, index1);
+        for (size_t lane = 0; lane < 32; ++lane) {
+            finishSample(columns, D, i + lane, centers, centerCount, best[lane], second[lane],
+                static_cast<size_t>(bestIndex[lane]), nearest[i + lane - begin], distances[i + lane - begin]);
+        }
+    }
+
+    findNearestScalar(columns, dim, i, end, centers, centerCount, nearest + (i - begin), distances + (i - begin));
+}
+
+/**
+ * @brief AVX2 tile of the blocked search: C centers times 8 points (two registers) over the coordinates
+ *        [dBegin, dEnd), with the 2 x C sums kept in registers. Between passes the sums wait in products;
+ *        after the last pass they become ||c||^2 - 2 x.c and update the smallest values of the points.
+ */
+template <size_t C>
+TARGET_AVX2 static void findNearestTileAvx2(const double* points, size_t pointStride, const double* centers,
+    size_t dimension, size_t dBegin, size_t dEnd, size_t firstCenter, const double* centerNorms, double* products,
+    double* best, double* second, double* bestIndex)
+{
+    __m256d sum[C][2];
+    for (size_t c = 0; c < C; ++c) {
+        sum[c][0] = dBegin == 0 ? _mm256_setzero_pd() : _mm256_loadu_pd(products + c * pointStride);
+        sum[c][1] = dBegin == 0 ? _mm256_setzero_pd() : _mm256_loadu_pd(products + c * pointStride + 4);
+    }
+    for (size_t d = dBegin; d < dEnd; ++d) {
+        const __m256d p0 = _mm256_loadu_pd(points + d * pointStride);
+        const __m256d p1 = _mm256_loadu_pd(points + d * pointStride + 4);
+        for (size_t c = 0; c < C; ++c) {
+            const __m256d weight = _mm256_broadcast_sd(centers + c * dimension + d);
+            sum[c][0] = _mm256_fmadd_pd(p0, weight, sum[c][0]);
+            sum[c][1] = _mm256_fmadd_pd(p1, weight, sum[c][1]);
+        }
+    }
+
+    if (dEnd < dimension) {
+        for (size_t c = 0; c < C; ++c) {
+            _mm256_storeu_pd(products + c * pointStride, sum[c][0]);
+            _mm256_storeu_pd(products + c * pointStride + 4, sum[c][1]);
+        }
+        return;
+    }
+
+    // Strictly smaller only, and the centers in index order, so the first of equal centers is kept
+    for (size_t v = 0; v < 2; ++v) {
+        __m256d smallest = _mm256_loadu_pd(best + 4 * v);
+        __m256d next = _mm256_loadu_pd(second + 4 * v);
+        __m256d index = _mm256_loadu_pd(bestIndex + 4 * v);
+        for (size_t c = 0; c < C; ++c) {
+            const __m256d s = _mm256_sub_pd(_mm256_broadcast_sd(centerNorms + c), _mm256_add_pd(sum[c][v], sum[c][v]));
+            const __m256d closer = _mm256_cmp_pd(s, smallest, _CMP_LT_OQ);
+            next = _mm256_min_pd(next, _mm256_max_pd(smallest, s));
+            smallest = _mm256_blendv_pd(smallest, s, closer);
+            index = _mm256_blendv_pd(index, _mm256_set1_pd(static_cast<double>(firstCenter + c)), closer);
+        }
+        _mm256_storeu_pd(best + 4 * v, smallest);
+        _mm256_storeu_pd(second + 4 * v, next);
+        _mm256_storeu_pd(bestIndex + 4 * v, index);
+    }
+}
+
+/**
+ * @brief AVX2 blocked search: passes of DEPTH_BLOCK coordinates, each split into tiles of 8 points
+ *        times 6 centers.
+ */
+TARGET_AVX2 static void findNearestBlockAvx2(const double* points, size_t pointStride, size_t dimension,
+    const double* centers, const double* centerNorms, size_t centerCount, double* products,
+    double* best, double* second, double* bestIndex)
+{
+    for (size_t dBegin = 0; dBegin < dimension; dBegin += DEPTH_BLOCK) {
+        const size_t dEnd = min(dimension, dBegin + DEPTH_BLOCK);
+        // The 6 centers of a tile stay in the first-level cache while the points stream past them
+        size_t k = 0;
+        for (; k + 6 <= centerCount; k += 6) {
+            for (size_t p = 0; p < pointStride; p += 8) {
+                findNearestTileAvx2<6>(points + p, pointStride, centers + k * dimension, dimension, dBegin, dEnd,
+                    k, centerNorms + k, products + k * pointStride + p, best + p, second + p, bestIndex + p);
+            }
+        }
+
+        const double* rest = centers + k * dimension;
+        for (size_t p = 0; p < pointStride; p += 8) {
+            double* restProducts = products + k * pointStride + p;
+            switch (centerCount - k) {
+            case 5: findNearestTileAvx2<5>(points + p, pointStride, rest, dimension, dBegin, dEnd, k, centerNorms + k, restProducts, best + p, second + p, bestIndex + p); break;
+            case 4: findNearestTileAvx2<4>(points + p, pointStride, rest, dimension, dBegin, dEnd, k, centerNorms + k, restProducts, best + p, second + p, bestIndex + p); break;
+            case 3: findNearestTileAvx2<3>(points + p, pointStride, rest, dimension, dBegin, dEnd, k, centerNorms + k, restProducts, best + p, second + p, bestIndex + p); break;
+            case 2: findNearestTileAvx2<2>(points + p, pointStride, rest, dimension, dBegin, dEnd, k, centerNorms + k, restProducts, best + p, second + p, bestIndex + p); break;
+            case 1: findNearestTileAvx2<1>(points + p, pointStride, rest, dimension, dBegin, dEnd, k, centerNorms + k, restProducts, best + p, second + p, bestIndex + p); break;
+            default: break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief AVX-512 tile of the blocked search: C centers times 32 points (four registers), with the
+ *        same passes and comparisons as the AVX2 version.
+ */
+template <size_t C>
+TARGET_AVX512 static void findNearestTileAvx512(const double* points, size_t pointStride, const double* centers,
+    size_t dimension, size_t dBegin, size_t dEnd, size_t firstCenter, const double* centerNorms, double* products,
+    double* best, double* second, double* bestIndex)
+{
+    __m512d sum[C][4];
+    for (size_t c = 0; c < C; ++c) {
+        for (size_t v = 0; v < 4; ++v) {
+            sum[c][v] = dBegin == 0 ? _mm512_setzero_pd() : _mm512_loadu_pd(products + c * pointStride + 8 * v);
+        }
+    }
+    for (size_t d = dBegin; d < dEnd; ++d) {
+        const double* row = points + d * pointStride;
+        const __m512d p0 = _mm512_loadu_pd(row);
+        const __m512d p1 = _mm512_loadu_pd(row + 8);
+        const __m512d p2 = _mm512_loadu_pd(row + 16);
+        const __m512d p3 = _mm512_loadu_pd(row + 24);
+        for (size_t c = 0; c < C; ++c) {
+            const __m512d weight = _mm512_set1_pd(centers[c * dimension + d]);
+            sum[c][0] = _mm512_fmadd_pd(p0, weight, sum[c][0]);
+            sum[c][1] = _mm512_fmadd_pd(p1, weight, sum[c][1]);
+            sum[c][2] = _mm512_fmadd_pd(p2, weight, sum[c][2]);
+            sum[c][3] = _mm512_fmadd_pd(p3, weight, sum[c][3]);
+        }
+    }
+
+    if (dEnd < dimension) {
+        for (size_t c = 0; c < C; ++c) {
+            for (size_t v = 0; v < 4; ++v) {
+                _mm512_storeu_pd(products + c * pointStride + 8 * v, sum[c][v]);
+            }
+        }
+        return;
+    }
+
+    for (size_t v = 0; v < 4; ++v) {
+        __m512d smallest = _mm512_loadu_pd(best + 8 * v);
+        __m512d next = _mm512_loadu_pd(second + 8 * v);
+        __m512d index = _mm512_loadu_pd(bestIndex + 8 * v);
+        for (size_t c = 0; c < C; ++c) {
+            const __m512d s = _mm512_sub_pd(_mm512_set1_pd(centerNorms[c]), _mm512_add_pd(sum[c][v], sum[c][v]));
+            const __mmask8 closer = _mm512_cmp_pd_mask(s, smallest, _CMP_LT_OQ);
+            next = minAvx512(next, maxAvx512(smallest, s));
+            smallest = _mm512_mask_blend_pd(closer, smallest, s);
+            index = _mm512_mask_blend_pd(closer, index, _mm512_set1_pd(static_cast<double>(firstCenter + c)));
+        }
+        _mm512_storeu_pd(best + 8 * v, smallest);
+        _mm512_storeu_pd(second + 8 * v, next);
+        _mm512_storeu_pd(bestIndex + 8 * v, index);
+    }
+}
+
+/**
+ * @brief AVX-512 blocked search: passes of DEPTH_BLOCK coordinates, each split into tiles of 32 points
+ *        times 6 centers.
+ */
+TARGET_AVX512 static void findNearestBlockAvx512(const double* points, size_t pointStride, size_t dimension,
+    const double* centers, const double* centerNorms, size_t centerCount, double* products,
+    double* best, double* second, double* bestIndex)
+{
+    for (size_t dBegin = 0; dBegin < dimension; dBegin += DEPTH_BLOCK) {
+        const size_t dEnd = min(dimension, dBegin + DEPTH_BLOCK);
+        // The 6 centers of a tile stay in the first-level cache while the points stream past them
+        size_t k = 0;
+        for (; k + 6 <= centerCount; k += 6) {
+            for (size_t p = 0; p < pointStride; p += 32) {
+                findNearestTileAvx512<6>(points + p, pointStride, centers + k * dimension, dimension, dBegin, dEnd,
+                    k, centerNorms + k, products + k * pointStride + p, best + p, second + p, bestIndex + p);
+            }
+        }
+
+        const double* rest = centers + k * dimension;
+        for (size_t p = 0; p < pointStride; p += 32) {
+            double* restProducts = products + k * pointStride + p;
+            switch (centerCount - k) {
+            case 5: findNearestTileAvx512<5>(points + p, pointStride, rest, dimension, dBegin, dEnd, k, centerNorms + k, restProducts, best + p, second + p, bestIndex + p); break;
+            case 4: findNearestTileAvx512<4>(points + p, pointStride, rest, dimension, dBegin, dEnd, k, centerNorms + k, restProducts, best + p, second + p, bestIndex + p); break;
+            case 3: findNearestTileAvx512<3>(points + p, pointStride, rest, dimension, dBegin, dEnd, k, centerNorms + k, restProducts, best + p, second + p, bestIndex + p); break;
+            case 2: findNearestTileAvx512<2>(points + p, pointStride, rest, dimension, dBegin, dEnd, k, centerNorms + k, restProducts, best + p, second + p, bestIndex + p); break;
+            case 1: findNearestTileAvx512<1>(points + p, pointStride, rest, dimension, dBegin, dEnd, k, centerNorms + k, restProducts, best + p, second + p, bestIndex + p); break;
+            default: break;
+            }
+        }
+    }
+}
+
+#endif
+
+/**
+ * @brief Returns the best instruction set supported by the processor and the operating system.
+ *        The result is computed once.
+ *
+ * @return InstructionSet The supported instruction set.
+ */
+InstructionSet DistanceKernel::getSupportedInstructionSet()
+{
+    static const InstructionSet supported = []() {
+#if defined(DISTANCEKERNEL_X86_64) && defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return InstructionSet::Scalar;
+
+        __cpuid(info, 1);
+        const bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0;
+        if (!osSavesAvx) return InstructionSet::Scalar;
+        const bool fmaAndF16c = (info[2] & (1 << 12)) != 0 && (info[2] & (1 << 29)) != 0;
+
+        const unsigned long long enabledStates = _xgetbv(0);
+        __cpuidex(info, 7, 0);
+        if ((info[1] & (1 << 16)) != 0 && (enabledStates & 0xE6) == 0xE6) return InstructionSet::AVX512;
+        if ((info[1] & (1 << 5)) != 0 && fmaAndF16c && (enabledStates & 0x6) == 0x6) return InstructionSet::AVX2;
+        return InstructionSet::Scalar;
+#elif defined(DISTANCEKERNEL_X86_64) && defined(__GNUC__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return InstructionSet::AVX512;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c")) return InstructionSet::AVX2;
+        return InstructionSet::Scalar;
+#else
+        return InstructionSet::Scalar;
+#endif
+    }();
+
+    return supported;
+}
+
+/**
+ * @brief Returns a printable name of an instruction set.
+ *
+ * @param instructionSet The instruction set.
+ * @return const char* The name.
+ */
+const char* DistanceKernel::getName(InstructionSet instructionSet)
+{
+    switch (instructionSet) {
+    case InstructionSet::Automatic: return "Automatic";
+    case InstructionSet::Scalar: return "Scalar";
+    case InstructionSet::AVX2: return "AVX2";
+    case InstructionSet::AVX512: return "AVX-512";
+    }
+    return "Unknown";
+}
+
+/**
+ * @brief Constructor that selects the instruction set, lowered to the best supported one when needed.
+ *
+ * @param requested The wanted instruction set.
+ */
+DistanceKernel::DistanceKernel(InstructionSet requested)
+{
+    const InstructionSet supported = getSupportedInstructionSet();
+    if (requested == InstructionSet::Automatic || static_cast<int>(requested) > static_cast<int>(supported)) {
+        instructionSet = supported;
+    }
+    else {
+        instructionSet = requested;
+    }
+}
+
+/**
+ * @brief Returns the instruction set actually used.
+ *
+ * @return InstructionSet The instruction set.
+ */
+InstructionSet DistanceKernel::getInstructionSet() const
+{
+    return instructionSet;
+}
+
+/**
+ * @brief Runs the nearest-center search of an instruction set, for the dimension of the samples.
+ *
+ * @param instructionSet The instruction set.
+ * @param columns One array per dimension.
+ * @param dimension The number of coordinates.
+ * @param begin The first sample.
+ * @param end One past the last sample.
+ * @param centers The centers, row-major.
+ * @param centerCount The number of centers.
+ * @param nearest Receives the nearest center of each sample.
+ * @param distances Receives the distance of each sample to its nearest center.
+ */
+template <typename S, typename T = typename ComputeType<S>::type>
+static void findNearestWith(InstructionSet instructionSet, const S* const* columns, size_t dimension, size_t begin,
+    size_t end, const T* centers, size_t centerCount, size_t* nearest, T* distances)
+{
+    dispatchDimension(dimension, [&](auto dim) {
+        switch (instructionSet) {
+#ifdef DISTANCEKERNEL_X86_64
+        case InstructionSet::AVX512:
+            findNearestAvx512(columns, dim, begin, end, centers, centerCount, nearest, distances);
+            return;
+        case InstructionSet::AVX2:
+            findNearestAvx2(columns, dim, begin, end, centers, centerCount, nearest, distances);
+            return;
+#endif
+        default:
+            findNearestScalar(columns, dim, begin, end, centers, centerCount, nearest, distances);
+            return;
+        }
+        });
+}
+
+/**
+ * @brief Finds the nearest center of every sample in [begin, end) with the selected instruction set.
+ *
+ * @param columns One array per dimension.
+ * @param dimension The number of coordinates.
+ * @param begin The first sample.
+ * @param end One past the last sample.
+ * @param centers The centers, row-major.
+ * @param centerCount The number of centers.
+ * @param nearest Receives the nearest center of each sample.
+ * @param distances Receives the distance of each sample to its nearest center.
+ */
+void DistanceKernel::findNearest(const double* const* columns, size_t dimension, size_t begin, size_t end,
+    const double* centers, size_t centerCount, size_t* nearest, double* distances) const
+{
+    findNearestWith(instructionSet, columns, dimension, begin, end, centers, centerCount, nearest, distances);
+}
+
+/**
+ * @brief Finds the nearest center of every sample in [begin, end) in single precision, with the
+ *        selected instruction set.
+ *
+ * @param columns One array per dimension.
+ * @param dimension The number of coordinates.
+ * @param begin The first sample.
+ * @param end One past the last sample.
+ * @param centers The centers, row-major.
+ * @param centerCount The number of centers.
+ * @param nearest Receives the nearest center of each sample.
+ * @param distances Receives the distance of each sample to its nearest center.
+ */
+void DistanceKernel::findNearest(const float* const* columns, size_t dimension, size_t begin, size_t end,
+    const float* centers, size_t centerCount, size_t* nearest, float* distances) const
+{
+    findNearestWith(instructionSet, columns, dimension, begin, end, centers, centerCount, nearest, distances);
+}
+
+/**
+ * @brief Finds the nearest center of every sample in [begin, end), widening half samples to single precision.
+ *
+ * @param columns One array per dimension.
+ * @param dimension The number of coordinates.
+ * @param begin The first sample.
+ * @param end One past the last sample.
+ * @param centers The centers, row-major.
+ * @param centerCount The number of centers.
+ * @param nearest Receives the nearest center of each sample.
+ * @param distances Receives the distance of each sample to its nearest center.
+ */
+void DistanceKernel::findNearest(const Half* const* columns, size_t dimension, size_t begin, size_t end,
+    const float* centers, size_t centerCount, size_t* nearest, float* distances) const
+{
+    findNearestWith(instructionSet, columns, dimension, begin, end, centers, centerCount, nearest, distances);
+}
+
+/**
+ * @brief Finds the nearest center of every sample in [begin, end), widening bfloat16 samples to single precision.
+ *
+ * @param columns One array per dimension.
+ * @param dimension The number of coordinates.
+ * @param begin The first sample.
+ * @param end One past the last sample.
+ * @param centers The centers, row-major.
+ * @param centerCount The number of centers.
+ * @param nearest Receives the nearest center of each sample.
+ * @param distances Receives the distance of each sample to its nearest center.
+ */
+void DistanceKernel::findNearest(const BFloat16* const* columns, size_t dimension, size_t begin, size_t end,
+    const float* centers, size_t centerCount, size_t* nearest, float* distances) const
+{
+    findNearestWith(instructionSet, columns, dimension, begin, end, centers, centerCount, nearest, distances);
+}
+
+/**
+ * @brief Finds, for every point of a block, the center with the smallest ||c||^2 - 2 x.c, with the blocked
+ *        products of the selected instruction set. The vector versions keep the center indices in double
+ *        lanes and need room for the sums of the centers between passes over the coordinates.
+ *
+ * @param points The points of the block, one row of pointStride values per coordinate.
+ * @param pointStride The number of points per row, a multiple of POINT_ALIGNMENT.
+ * @param dimension The number of coordinates.
+ * @param centers The centers, row-major.
+ * @param centerNorms The squared norm of every center.
+ * @param centerCount The number of centers.
+ * @param nearest Receives the first center with the smallest value, for every point.
+ * @param best Receives the smallest value of every point.
+ * @param second Receives the second smallest value of every point.
+ * @param scratch Working space, grown when too small: the indices of the best centers, then the
+ *        partial products when the coordinates are split into several depth blocks.
+ * @throws invalid_argument If pointStride is not a multiple of POINT_ALIGNMENT.
+ */
+void DistanceKernel::findNearestBlock(const double* points, size_t pointStride, size_t dimension,
+    const double* centers, const double* centerNorms, size_t centerCount, size_t* nearest, double* best, double* second,
+    vector<double>& scratch) const
+{
+    if (pointStride % POINT_ALIGNMENT != 0) {
+        throw invalid_argument("The rows of a block of points must hold a multiple of 32 points.");
+    }
+
+#ifdef DISTANCEKERNEL_X86_64
+    if (instructionSet == InstructionSet::AVX512 || instructionSet == InstructionSet::AVX2) {
+        const size_t required = pointStride + (dimension > DEPTH_BLOCK ? centerCount * pointStride : 0);
+        if (scratch.size() < required) {
+            scratch.resize(required);
+        }
+        double* bestIndex = scratch.data();
+        double* products = bestIndex + pointStride;
+        fill(bestIndex, bestIndex + pointStride, 0.0);
+        fill(best, best + pointStride, numeric_limits<double>::max());
+        fill(second, second + pointStride, numeric_limits<double>::max());
+
+        if (instructionSet == InstructionSet::AVX512) {
+            findNearestBlockAvx512(points, pointStride, dimension, centers, centerNorms, centerCount, products,
+                best, second, bestIndex);
+        }
+        else {
+            findNearestBlockAvx2(points, pointStride, dimension, centers, centerNorms, centerCount, products,
+                best, second, bestIndex);
+        }
+        for (size_t p = 0; p < pointStride; ++p) {
+            nearest[p] = static_cast<size_t>(bestIndex[p]);
+        }
+        return;
+    }
+#endif
+    if (scratch.size() < pointStride) {
+        scratch.resize(pointStride);
+    }
+    findNearestBlockScalar(points, pointStride, dimension, centers, centerNorms, centerCount, nearest, best, second,
+        scratch.data());
+}
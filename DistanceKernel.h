@@ -0,0 +1,164 @@
+#ifndef DISTANCEKERNEL_H
+#define DISTANCEKERNEL_H
+
+#include <cstddef>
+#include <vector>
+#include "HalfFloat.h"
+#include "KMeansOptions.h"
+
+using namespace std;
+
+/**
+ * @class DistanceKernel
+ * @brief Nearest-center search over a range of samples, vectorized across samples.
+ *        The AVX2 version handles 8 samples per step (two registers of 4) and the AVX-512 version
+ *        16 (two registers of 8); the instruction set is chosen at run time, with a scalar fallback
+ *        for other processors and 32-bit builds. The single-precision search fits twice as many
+ *        samples in a register; half and bfloat16 samples are widened to single precision in the
+ *        registers, so they are read from memory at a quarter of the size of doubles.
+ *
+ *        findNearest() compares squared distances and never fuses multiplications and additions,
+ *        so every version computes the same bits as squaredDistance() in Dimension.h. Two centers
+ *        whose squared distances differ but whose square roots are equal count as a tie in the
+ *        other engines; those rare samples are searched again with the exact distances, so the
+ *        labels always match the brute-force loop, ties included. findNearestBlock() is a
+ *        screening search and fuses them where it can.
+ */
+class DistanceKernel
+{
+public:
+
+    /**
+     * The number of samples the callers hand to the search at once: large enough to amortize the
+     * call, small enough for the results to stay on the stack.
+     */
+    static constexpr size_t CHUNK_SIZE = 256;
+
+    /**
+     * @brief Returns the best instruction set supported by the processor and the operating system.
+     *
+     * @return InstructionSet::AVX512, InstructionSet::AVX2 or InstructionSet::Scalar.
+     */
+    static InstructionSet getSupportedInstructionSet();
+
+    /**
+     * @brief Returns a printable name of an instruction set.
+     *
+     * @param instructionSet The instruction set.
+     * @return The name.
+     */
+    static const char* getName(InstructionSet instructionSet);
+
+    /**
+     * @brief Constructor that selects the instruction set.
+     *
+     * @param requested The wanted instruction set. It is lowered to the best supported one when needed.
+     */
+    explicit DistanceKernel(InstructionSet requested = InstructionSet::Automatic);
+
+    /**
+     * @brief Returns the instruction set actually used.
+     *
+     * @return The instruction set.
+     */
+    InstructionSet getInstructionSet() const;
+
+    /**
+     * @brief Finds the nearest center of every sample in [begin, end).
+     *        Ties go to the center with the lower index.
+     *
+     * @param columns One array per dimension holding that coordinate of every sample.
+     * @param dimension The number of coordinates.
+     * @param begin The first sample.
+     * @param end One past the last sample.
+     * @param centers The centers, row-major (centerCount x dimension).
+     * @param centerCount The number of centers (at least 1).
+     * @param nearest Receives end - begin center indices.
+     * @param distances Receives end - begin Euclidean distances to the nearest center.
+     */
+    void findNearest(const double* const* columns, size_t dimension, size_t begin, size_t end,
+        const double* centers, size_t centerCount, size_t* nearest, double* distances) const;
+
+    /**
+     * @brief Finds the nearest center of every sample in [begin, end) in single precision: the same
+     *        search with float coordinates, squared distances and square roots, and twice as many
+     *        samples per vector. Ties go to the center with the lower index.
+     *
+     * @param columns One array per dimension holding that coordinate of every sample.
+     * @param dimension The number of coordinates.
+     * @param begin The first sample.
+     * @param end One past the last sample.
+     * @param centers The centers, row-major (centerCount x dimension), fewer than 2^24.
+     * @param centerCount The number of centers (at least 1).
+     * @param nearest Receives end - begin center indices.
+     * @param distances Receives end - begin Euclidean distances to the nearest center.
+     */
+    void findNearest(const float* const* columns, size_t dimension, size_t begin, size_t end,
+        const float* centers, size_t centerCount, size_t* nearest, float* distances) const;
+
+    /**
+     * @brief Finds the nearest center of every sample in [begin, end) for samples stored as halves:
+     *        they are widened to floats as they are loaded (with F16C in the AVX2 version) and
+     *        searched like single-precision samples against float centers.
+     *
+     * @param columns One array per dimension holding that coordinate of every sample.
+     * @param dimension The number of coordinates.
+     * @param begin The first sample.
+     * @param end One past the last sample.
+     * @param centers The centers, row-major (centerCount x dimension), fewer than 2^24.
+     * @param centerCount The number of centers (at least 1).
+     * @param nearest Receives end - begin center indices.
+     * @param distances Receives end - begin Euclidean distances to the nearest center.
+     */
+    void findNearest(const Half* const* columns, size_t dimension, size_t begin, size_t end,
+        const float* centers, size_t centerCount, size_t* nearest, float* distances) const;
+
+    /**
+     * @brief Finds the nearest center of every sample in [begin, end) for samples stored as bfloat16,
+     *        widened to floats as they are loaded and searched against float centers.
+     *
+     * @param columns One array per dimension holding that coordinate of every sample.
+     * @param dimension The number of coordinates.
+     * @param begin The first sample.
+     * @param end One past the last sample.
+     * @param centers The centers, row-major (centerCount x dimension), fewer than 2^24.
+     * @param centerCount The number of centers (at least 1).
+     * @param nearest Receives end - begin center indices.
+     * @param distances Receives end - begin Euclidean distances to the nearest center.
+     */
+    void findNearest(const BFloat16* const* columns, size_t dimension, size_t begin, size_t end,
+        const float* centers, size_t centerCount, size_t* nearest, float* distances) const;
+
+    /**
+     * @brief Finds, for every point x of a block, the center c with the smallest ||c||^2 - 2 x.c, which
+     *        differs from the squared distance by ||x||^2 only: the search of the GEMM engine. The dot
+     *        products are a cache-blocked matrix product, in passes over 128 coordinates at a time split
+     *        into tiles of points times 6 centers whose sums stay in registers (8 points with AVX2, 32
+     *        with AVX-512); the comparisons are made on the tiles as they are finished. Unlike
+     *        findNearest(), the vector versions fuse multiplications and additions, so the values may
+     *        differ between instruction sets in the last bits: they are meant for screening.
+     *
+     * @param points The points, one row per coordinate: coordinate d of point p is at d * pointStride + p.
+     * @param pointStride The number of points per row, a multiple of 32; padding points are searched too.
+     * @param dimension The number of coordinates.
+     * @param centers The centers, row-major (centerCount x dimension), fewer than 2^53.
+     * @param centerNorms The squared norm of every center.
+     * @param centerCount The number of centers (at least 1).
+     * @param nearest Receives pointStride center indices: the first center with the smallest value.
+     * @param best Receives pointStride smallest values.
+     * @param second Receives pointStride second smallest values (the smallest one again for ties).
+     * @param scratch Working space, grown when too small; pass the same vector to every call to avoid
+     *        allocations.
+     * @throws invalid_argument If pointStride is not a multiple of 32.
+     */
+    void findNearestBlock(const double* points, size_t pointStride, size_t dimension, const double* centers,
+        const double* centerNorms, size_t centerCount, size_t* nearest, double* best, double* second,
+        vector<double>& scratch) const;
+
+private:
+
+    /** The instruction set used by findNearest() and findNearestBlock(). */
+    InstructionSet instructionSet;
+};
+
+#endif
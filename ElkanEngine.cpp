@@ -0,0 +1,180 @@
+/****************************************************************************
+ * @file ElkanEngine.cpp
+ * @brief Implementation of the ElkanEngine class. The engine keeps, for every
+ *        sample, an upper bound on the distance to its own center and a lower
+ *        bound on the distance to each other center, and uses the triangle
+ *        inequality to skip the distances that cannot change the assignment.
+ ****************************************************************************/
+
+#include "ElkanEngine.h"
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+/**
+ * @brief Constructor that binds the engine to the samples and the thread pool.
+ *
+ * @param data The samples to assign.
+ * @param pool The thread pool used to process the blocks.
+ */
+ElkanEngine::ElkanEngine(Dataset& data, ThreadPool& pool)
+    : AssignmentEngine(data, pool), initialized(false), clusterCount(0)
+{
+}
+
+/**
+ * @brief Assigns each sample to the nearest cluster.
+ *        A center j is skipped for a sample whose current center is a when the upper bound u
+ *        of the sample is below max(lower bound of j, half the distance between a and j).
+ *        When j has a lower ID than a, the test is strict so that ties are resolved like in
+ *        the brute-force loop, which keeps the first of several equally close centers.
+ *
+ * @param clusters The clusters with their current centers.
+ */
+void ElkanEngine::assign(const vector<Cluster>& clusters)
+{
+    loadCenters(clusters);
+
+    if (!initialized || clusterCount != clusters.size() || upperBounds.size() != data.size()) {
+        clusterCount = clusters.size();
+        assignAll();
+        return;
+    }
+
+    computeCenterShifts();
+    computeCenterDistances();
+    resetBlockSums(clusterCount);
+
+    const size_t K = clusterCount;
+
+    int* labels = data.getLabels();
+
+    dispatchDimension(dimension, [&](auto dim) {
+        pool.parallelFor(getBlockCount(), [&](size_t block) {
+            const size_t end = getBlockBegin(block + 1);
+            double* sums = getBlockSums(block);
+            auto point = dim.makePoint();
+            size_t distanceCount = 0;
+
+            for (size_t i = getBlockBegin(block); i < end; ++i) {
+                loadPoint(i, point.data(), dim);
+                double* lower = &lowerBounds[i * K];
+                size_t a = static_cast<size_t>(labels[i] - 1);
+
+                // Move the bounds by the distance the centers travelled
+                for (size_t j = 0; j < K; ++j) {
+                    lower[j] = max(0.0, lower[j] - centerShifts[j]);
+                }
+                double upper = upperBounds[i] + centerShifts[a];
+
+                // No other center can be closer than half the distance to the nearest other center
+                if (upper < halfNearestCenter[a]) {
+                    upperBounds[i] = upper;
+                    recordAssignment(sums, labels[i], a, point.data(), dim);
+                    continue;
+                }
+
+                bool tight = false;  ///< Whether upper is the exact distance to center a
+                for (size_t j = 0; j < K; ++j) {
+                    if (j == a) continue;
+
+                    double bound = max(lower[j], 0.5 * centerDistances[a * K + j]);
+                    if (j < a ? upper < bound : upper <= bound) continue;
+
+                    // Make the upper bound exact before giving up on the test
+                    if (!tight) {
+                        upper = distance(point.data(), a, dim);
+                        lower[a] = upper;
+                        tight = true;
+                        ++distanceCount;
+                        if (j < a ? upper < bound : upper <= bound) continue;
+                    }
+
+                    double d = distance(point.data(), j, dim);
+                    lower[j] = d;
+                    ++distanceCount;
+                    if (d < upper || (d == upper && j < a)) {
+                        a = j;
+                        upper = d;
+                    }
+                }
+
+                upperBounds[i] = upper;
+                recordAssignment(sums, labels[i], a, point.data(), dim);
+            }
+
+            setBlockDistanceCount(block, distanceCount);
+            });
+        });
+
+    mergeBlockSums();
+    storeCenters();
+}
+
+/**
+ * @brief Computes every distance once, which sets all the bounds to exact values.
+ */
+void ElkanEngine::assignAll()
+{
+    const size_t K = clusterCount;
+
+    upperBounds.assign(data.size(), 0.0);
+    lowerBounds.assign(data.size() * K, 0.0);
+    resetBlockSums(K);
+
+    int* labels = data.getLabels();
+
+    dispatchDimension(dimension, [&](auto dim) {
+        pool.parallelFor(getBlockCount(), [&](size_t block) {
+            const size_t end = getBlockBegin(block + 1);
+            double* sums = getBlockSums(block);
+            auto point = dim.makePoint();
+
+            for (size_t i = getBlockBegin(block); i < end; ++i) {
+                loadPoint(i, point.data(), dim);
+                double* lower = &lowerBounds[i * K];
+                double minDistance = numeric_limits<double>::max();
+                size_t best = 0;
+
+                for (size_t j = 0; j < K; ++j) {
+                    lower[j] = distance(point.data(), j, dim);
+                    if (lower[j] < minDistance) {
+                        minDistance = lower[j];
+                        best = j;
+                    }
+                }
+
+                upperBounds[i] = minDistance;
+                recordAssignment(sums, labels[i], best, point.data(), dim);
+            }
+
+            setBlockDistanceCount(block, (end - getBlockBegin(block)) * K);
+            });
+        });
+
+    mergeBlockSums();
+    storeCenters();
+    initialized = true;
+}
+
+/**
+ * @brief Computes the distances between all pairs of centers and half the distance
+ *        from every center to its nearest other center.
+ */
+void ElkanEngine::computeCenterDistances()
+{
+    const size_t K = clusterCount;
+    centerDistances.assign(K * K, 0.0);
+    halfNearestCenter.assign(K, numeric_limits<double>::max());
+
+    for (size_t a = 0; a < K; ++a) {
+        for (size_t b = a + 1; b < K; ++b) {
+            double d = centerDistance(a, b);
+            centerDistances[a * K + b] = d;
+            centerDistances[b * K + a] = d;
+            halfNearestCenter[a] = min(halfNearestCenter[a], 0.5 * d);
+            halfNearestCenter[b] = min(halfNearestCenter[b], 0.5 * d);
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef ELKANENGINE_H
+#define ELKANENGINE_H
+
+#include "AssignmentEngine.h"
+
+using namespace std;
+
+/**
+ * @class ElkanEngine
+ * @brief Assignment step accelerated with the triangle inequality (Elkan, 2003).
+ *        For every sample the engine keeps an upper bound on the distance to its own center
+ *        and a lower bound on the distance to every other center. Together with the
+ *        center-to-center distances these bounds prove, for most samples and centers, that
+ *        the center cannot be closer, so the distance does not have to be computed.
+ *        The labels are the same as the brute-force LloydEngine, including ties.
+ */
+class ElkanEngine : public AssignmentEngine
+{
+public:
+
+    /**
+     * @brief Constructor that binds the engine to the samples and the thread pool.
+     *
+     * @param data The samples to assign.
+     * @param pool The thread pool used to process the blocks.
+     */
+    ElkanEngine(Dataset& data, ThreadPool& pool);
+
+    /**
+     * @brief Assigns each sample to the nearest cluster, skipping the distances that the bounds rule out.
+     *
+     * @param clusters The clusters with their current centers.
+     */
+    void assign(const vector<Cluster>& clusters) override;
+
+private:
+
+    /**
+     * @brief Computes every distance once to set exact bounds (first call only).
+     */
+    void assignAll();
+
+    /**
+     * @brief Computes the distances between all pairs of centers and,
+     *        for every center, half the distance to its nearest other center.
+     */
+    void computeCenterDistances();
+
+    /** Whether the bounds have been initialized. */
+    bool initialized;
+
+    /** The number of clusters the bounds were built for. */
+    size_t clusterCount;
+
+    /** For every sample, an upper bound on the distance to its assigned center. */
+    vector<double> upperBounds;
+
+    /** For every sample and every center (row-major), a lower bound on their distance. */
+    vector<double> lowerBounds;
+
+    /** The distances between all pairs of centers (row-major, K x K). */
+    vector<double> centerDistances;
+
+    /** For every center, half the distance to its nearest other center. */
+    vector<double> halfNearestCenter;
+};
+
+#endif
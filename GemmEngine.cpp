@@ -0,0 +1,206 @@
+/****************************************************************************
+ * @file GemmEngine.cpp
+ * @brief Implementation of the GemmEngine class: the cached lengths of the
+ *        samples, the screening of the centers with the blocked products of
+ *        the distance kernel and the exact search of the samples left with
+ *        several candidates.
+ ****************************************************************************/
+
+#include "GemmEngine.h"
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+/** The number of samples multiplied with the centers at once: a multiple of 32, as the kernel needs. */
+static const size_t POINT_BLOCK_SIZE = 128;
+
+/** The smallest number of centers for which the blocked product is faster than the brute-force search. */
+static const size_t MIN_CENTER_COUNT = 16;
+
+/** The smallest dimension from which the automatic choice runs the blocked product. */
+static const size_t AUTOMATIC_MIN_DIMENSION = 32;
+
+/** The smallest D x K from which the automatic choice runs the blocked product (1.1x to 1.6x faster there with AVX-512). */
+static const size_t AUTOMATIC_MIN_PRODUCT_SIZE = 4096;
+
+/**
+ * @brief Constructor that binds the engine to the samples and the thread pool.
+ *
+ * @param data The samples to assign.
+ * @param pool The thread pool used to process the blocks.
+ * @param automatic true to run the products only where they are faster than the brute-force search.
+ */
+GemmEngine::GemmEngine(Dataset& data, ThreadPool& pool, bool automatic)
+    : LloydEngine(data, pool), automatic(automatic)
+{
+}
+
+/**
+ * @brief Tells whether the blocked product pays off. Below 16 centers or with the scalar kernel it never
+ *        does. For the automatic choice, it also needs AVX-512 and a large enough D x K: with AVX2, and
+ *        with AVX-512 on smaller problems, the products were measured slower than LloydEngine.
+ *
+ * @param centerCount The number of centers.
+ * @return true If assign() screens the centers with the products.
+ */
+bool GemmEngine::usesProducts(size_t centerCount) const
+{
+    const InstructionSet instructionSet = kernel.getInstructionSet();
+    if (centerCount < MIN_CENTER_COUNT || instructionSet == InstructionSet::Scalar) {
+        return false;
+    }
+    return !automatic || (instructionSet == InstructionSet::AVX512 && dimension >= AUTOMATIC_MIN_DIMENSION
+        && dimension * centerCount >= AUTOMATIC_MIN_PRODUCT_SIZE);
+}
+
+/**
+ * @brief Assigns each sample to the nearest cluster. For every group of POINT_BLOCK_SIZE samples,
+ *        the shifted coordinates are packed into rows and the kernel finds the two smallest values
+ *        of ||c||^2 - 2 x.c, which are the two smallest squared distances less ||x||^2.
+ *
+ *        For a sample at length a from the origin and centers at most at length b, these values are
+ *        within (D + 3) x epsilon x (a + b)^2 of the exact ones, and the exact ones within
+ *        D x epsilon x (a + b)^2 of those squaredDistance() computes, the shift included. With the
+ *        bound (4D + 16) x epsilon x (a + b)^2, a sample whose two smallest values differ by more than
+ *        twice the bound has the same nearest center as in the brute-force search; the others are
+ *        searched again with the exact distances, like the ties of the distance kernel.
+ *        Where the products do not pay off (see usesProducts()), the brute-force search of the
+ *        LloydEngine runs instead.
+ *
+ * @param clusters The clusters with their current centers.
+ */
+void GemmEngine::assign(const vector<Cluster>& clusters)
+{
+    const size_t K = clusters.size();
+    if (!usesProducts(K)) {
+        LloydEngine::assign(clusters);
+        return;
+    }
+    loadCenters(clusters);
+    resetBlockSums(K);
+
+    if (sampleLengths.size() != data.size() || origin.size() != dimension) {
+        computeSampleLengths();
+    }
+
+    // Shifted centers and their norms, once per assignment
+    shiftedCenters.resize(K * dimension);
+    centerNorms.resize(K);
+    centerLengths.resize(K);
+    for (size_t k = 0; k < K; ++k) {
+        double norm = 0.0;
+        for (size_t d = 0; d < dimension; ++d) {
+            const double shifted = centers[k * dimension + d] - origin[d];
+            shiftedCenters[k * dimension + d] = shifted;
+            norm += shifted * shifted;
+        }
+        centerNorms[k] = norm;
+        centerLengths[k] = sqrt(norm);
+    }
+    const double farthestCenter = K > 0 ? *max_element(centerLengths.begin(), centerLengths.end()) : 0.0;
+
+    const double tolerance = (4.0 * static_cast<double>(dimension) + 16.0) * numeric_limits<double>::epsilon();
+    int* labels = data.getLabels();
+
+    dispatchDimension(dimension, [&](auto dim) {
+        pool.parallelFor(getBlockCount(), [&](size_t block) {
+            const size_t end = getBlockBegin(block + 1);
+            double* sums = getBlockSums(block);
+            auto point = dim.makePoint();
+            static thread_local vector<double> packed;  ///< One per pool thread, reused by its blocks and assignments
+            static thread_local vector<double> scratch;  ///< Working space of findNearestBlock(), kept likewise
+            packed.resize(dimension * POINT_BLOCK_SIZE);
+            size_t nearest[POINT_BLOCK_SIZE];
+            double best[POINT_BLOCK_SIZE];
+            double second[POINT_BLOCK_SIZE];
+
+            for (size_t group = getBlockBegin(block); group < end; group += POINT_BLOCK_SIZE) {
+                const size_t count = min(end - group, POINT_BLOCK_SIZE);
+                const double* lengths = &sampleLengths[group];
+
+                // One row of shifted coordinates per dimension; the padding of the last group stays zero
+                for (size_t d = 0; d < dimension; ++d) {
+                    const double* column = columns[d] + group;
+                    double* row = &packed[d * POINT_BLOCK_SIZE];
+                    for (size_t p = 0; p < count; ++p) {
+                        row[p] = column[p] - origin[d];
+                    }
+                    fill(row + count, row + POINT_BLOCK_SIZE, 0.0);
+                }
+                kernel.findNearestBlock(packed.data(), POINT_BLOCK_SIZE, dimension, shiftedCenters.data(),
+                    centerNorms.data(), K, nearest, best, second, scratch);
+
+                for (size_t p = 0; p < count; ++p) {
+                    const size_t i = group + p;
+                    const double reach = lengths[p] + farthestCenter;
+                    const bool tooClose = second[p] - best[p] <= 2.0 * tolerance * reach * reach;
+
+                    if (tooClose || changesSums(labels[i], nearest[p])) {
+                        loadPoint(i, point.data(), dim);
+                    }
+                    if (tooClose) {
+                        // Too close to call: the exact distances decide, the first center winning ties
+                        double nearestDistance = numeric_limits<double>::max();
+                        for (size_t k = 0; k < K; ++k) {
+                            const double d = distance(point.data(), k, dim);
+                            if (d < nearestDistance) {
+                                nearestDistance = d;
+                                nearest[p] = k;
+                            }
+                        }
+                    }
+                    recordAssignment(sums, labels[i], nearest[p], point.data(), dim);
+                }
+            }
+
+            setBlockDistanceCount(block, (end - getBlockBegin(block)) * K);
+            });
+        });
+
+    mergeBlockSums();
+}
+
+/**
+ * @brief Returns whether the engine searches samples stored in a reduced precision.
+ *
+ * @return false The products and the error bounds are computed from the double columns.
+ */
+bool GemmEngine::supportsReducedPrecision() const
+{
+    return false;
+}
+
+/**
+ * @brief Computes the mean of the samples, then the length of every sample shifted by it, a block of
+ *        samples per task. The squares are added a column at a time into the lengths, which are then
+ *        turned into square roots. They stay valid until the samples change.
+ */
+void GemmEngine::computeSampleLengths()
+{
+    const size_t N = data.size();
+    origin.assign(dimension, 0.0);
+    pool.parallelFor(dimension, [&](size_t d) {
+        double sum = 0.0;
+        for (size_t i = 0; i < N; ++i) {
+            sum += columns[d][i];
+        }
+        origin[d] = N > 0 ? sum / static_cast<double>(N) : 0.0;
+        });
+
+    sampleLengths.assign(N, 0.0);
+    pool.parallelFor(getBlockCount(), [&](size_t block) {
+        const size_t begin = getBlockBegin(block);
+        const size_t end = getBlockBegin(block + 1);
+        for (size_t d = 0; d < dimension; ++d) {
+            const double* column = columns[d];
+            for (size_t i = begin; i < end; ++i) {
+                const double shifted = column[i] - origin[d];
+                sampleLengths[i] += shifted * shifted;
+            }
+        }
+        for (size_t i = begin; i < end; ++i) {
+            sampleLengths[i] = sqrt(sampleLengths[i]);
+        }
+        });
+}
@@ -0,0 +1,97 @@
+#ifndef GEMMENGINE_H
+#define GEMMENGINE_H
+
+#include "LloydEngine.h"
+
+using namespace std;
+
+/**
+ * @class GemmEngine
+ * @brief Assignment step for high dimensions based on a blocked matrix product.
+ *        The squared distance of a sample x to a center c is written ||x||^2 - 2 x.c + ||c||^2. The
+ *        ||x||^2 term is the same for every center, so the search only compares ||c||^2 - 2 x.c: the
+ *        norms of the centers are computed once per assignment, and the dot products of a block of
+ *        samples with every center come from the cache-blocked product of the distance kernel, which
+ *        does a multiplication and an addition per coordinate instead of the three operations of a
+ *        direct distance. The lengths of the samples, which bound the rounding errors, are computed
+ *        once and kept across iterations.
+ *
+ *        The samples and centers are shifted by the mean of the samples first, which keeps the norms
+ *        small and the cancellation in the formula low. The formula is still less accurate than a
+ *        direct distance, so it only screens the centers: a sample takes the center with the smallest
+ *        approximate squared distance when the second smallest one is farther by more than twice a
+ *        bound on their rounding errors. The rare samples almost equally close to two centers are
+ *        searched again with the exact distances. The labels are therefore the same as the brute-force
+ *        LloydEngine, including ties, and the sums are too.
+ *
+ *        With fewer than 16 centers, or without vector instructions, the products save less than the
+ *        packing and the bookkeeping cost, and the engine runs the brute-force search of the LloydEngine.
+ *        Created for the automatic choice, it only runs the products where they were measured faster
+ *        than that search: with AVX-512, from 32 dimensions and when D x K reaches 4096. With AVX2 the
+ *        direct distances are faster at every measured size up to 128 dimensions.
+ */
+class GemmEngine : public LloydEngine
+{
+public:
+
+    /**
+     * @brief Constructor that binds the engine to the samples and the thread pool.
+     *
+     * @param data The samples to assign.
+     * @param pool The thread pool used to process the blocks.
+     * @param automatic true to run the products only where they are faster than the brute-force search.
+     */
+    GemmEngine(Dataset& data, ThreadPool& pool, bool automatic = false);
+
+    /**
+     * @brief Assigns each sample to the nearest cluster, screening the centers with the blocked product
+     *        when it pays off.
+     *
+     * @param clusters The clusters with their current centers.
+     */
+    void assign(const vector<Cluster>& clusters) override;
+
+protected:
+
+    /**
+     * @brief Returns whether the engine searches samples stored in a reduced precision.
+     *
+     * @return false The products and the error bounds are computed from the double columns.
+     */
+    bool supportsReducedPrecision() const override;
+
+private:
+
+    /**
+     * @brief Tells whether the blocked product pays off for the current instruction set and dimension.
+     *
+     * @param centerCount The number of centers.
+     * @return true If assign() screens the centers with the products.
+     */
+    bool usesProducts(size_t centerCount) const;
+
+    /**
+     * @brief Computes the mean of the samples and the length of every sample shifted by it.
+     */
+    void computeSampleLengths();
+
+    /** Whether the products only run where they were measured faster than the brute-force search. */
+    bool automatic;
+
+    /** The mean of the samples, subtracted from the samples and the centers before the products. */
+    vector<double> origin;
+
+    /** The length of every shifted sample, used in the error bounds and kept across assignments. */
+    vector<double> sampleLengths;
+
+    /** The centers shifted by the origin, row-major (K x D). */
+    vector<double> shiftedCenters;
+
+    /** The squared norm of every shifted center, computed at every assignment. */
+    vector<double> centerNorms;
+
+    /** The norm of every shifted center, used in the error bounds. */
+    vector<double> centerLengths;
+};
+
+#endif
@@ -0,0 +1,230 @@
+/****************************************************************************
+ * @file GridEngine.cpp
+ * @brief Implementation of the GridEngine class: the uniform grid laid over
+ *        the 2D samples, the candidate centers of every cell and the search
+ *        of each sample among the candidates of its cell.
+ ****************************************************************************/
+
+#include "GridEngine.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+/** The number of cells of the grid per cluster center. */
+static const size_t CELLS_PER_CENTER = 4;
+
+/**
+ * The relative margin by which a center must lose against another one on a whole cell to be left out.
+ * The squared distances of a point are computed with a relative error of a few times 1.1e-16, so a gap
+ * of 1e-10 keeps the order of the computed distances, and of their square roots, intact.
+ */
+static const double PRUNING_MARGIN = 1e-10;
+
+/**
+ * @brief Constructor that binds the engine to the samples and the thread pool.
+ *
+ * @param data The 2D samples to assign.
+ * @param pool The thread pool used to process the blocks.
+ */
+GridEngine::GridEngine(Dataset& data, ThreadPool& pool)
+    : AssignmentEngine(data, pool), columnCount(0), rowCount(0), gridClusterCount(0)
+{
+}
+
+/**
+ * @brief Assigns each sample to the nearest cluster. The candidate lists are rebuilt from the new
+ *        centers, then every sample is compared with the candidates of its cell only, in index order.
+ *        As in the distance kernel, the squared distances are compared and a sample whose two nearest
+ *        candidates have equal distances is searched again with the exact distances, so a tie goes to
+ *        the lowest cluster ID as in the brute-force search.
+ *
+ * @param clusters The clusters with their current centers.
+ * @throws invalid_argument If the samples are not 2D.
+ */
+void GridEngine::assign(const vector<Cluster>& clusters)
+{
+    const size_t K = clusters.size();
+    loadCenters(clusters);
+    if (dimension != 2) {
+        throw invalid_argument("The grid assignment needs 2D samples.");
+    }
+    resetBlockSums(K);
+
+    if (sampleCells.size() != data.size() || gridClusterCount != K) {
+        buildGrid(K);
+    }
+    updateCandidates();
+
+    int* labels = data.getLabels();
+    const StaticDimension<2> dim;
+
+    pool.parallelFor(getBlockCount(), [&](size_t block) {
+        const size_t end = getBlockBegin(block + 1);
+        double* sums = getBlockSums(block);
+        auto point = dim.makePoint();
+        size_t distances = 0;
+
+        for (size_t i = getBlockBegin(block); i < end; ++i) {
+            const size_t cell = sampleCells[i];
+            const size_t* candidates = &cellCenters[cellStarts[cell]];
+            const size_t count = cellStarts[cell + 1] - cellStarts[cell];
+            loadPoint(i, point.data(), dim);
+
+            // Squared distances first, like the distance kernel; equal square roots are searched again
+            size_t nearest = candidates[0];
+            double best = numeric_limits<double>::max();
+            double second = numeric_limits<double>::max();
+            for (size_t k = 0; k < count; ++k) {
+                const double s = squaredDistance(point.data(), &centers[2 * candidates[k]], dim);
+                const bool closer = s < best;  ///< Selected without branches: the winner is hard to predict
+                second = min(second, max(best, s));
+                nearest = closer ? candidates[k] : nearest;
+                best = closer ? s : best;
+            }
+            if (sqrt(second) == sqrt(best)) {
+                double nearestDistance = numeric_limits<double>::max();
+                for (size_t k = 0; k < count; ++k) {
+                    const double d = distance(point.data(), candidates[k], dim);
+                    if (d < nearestDistance) {
+                        nearestDistance = d;
+                        nearest = candidates[k];
+                    }
+                }
+            }
+            distances += count;
+            recordAssignment(sums, labels[i], nearest, point.data(), dim);
+        }
+
+        setBlockDistanceCount(block, distances);
+        });
+
+    mergeBlockSums();
+}
+
+/**
+ * @brief Lays the grid over the bounding box of the samples. The grid has about CELLS_PER_CENTER
+ *        cells per cluster, never more than samples, and its cells are about as wide as high; a side
+ *        of zero length gets a single cell.
+ *
+ * @param clusterCount The number of clusters.
+ */
+void GridEngine::buildGrid(size_t clusterCount)
+{
+    const size_t N = data.size();
+    const double* x = columns[0];
+    const double* y = columns[1];
+
+    double lowX = 0.0, highX = 0.0, lowY = 0.0, highY = 0.0;
+    if (N > 0) {
+        const pair<const double*, const double*> rangeX = minmax_element(x, x + N);
+        const pair<const double*, const double*> rangeY = minmax_element(y, y + N);
+        lowX = *rangeX.first;
+        highX = *rangeX.second;
+        lowY = *rangeY.first;
+        highY = *rangeY.second;
+    }
+    const double width = highX - lowX;
+    const double height = highY - lowY;
+
+    const size_t cellCount = max<size_t>(1, min(CELLS_PER_CENTER * clusterCount, N));
+    if (width > 0.0 && height > 0.0) {
+        const double square = round(sqrt(static_cast<double>(cellCount) * width / height));
+        columnCount = static_cast<size_t>(min(max(square, 1.0), static_cast<double>(cellCount)));
+        rowCount = (cellCount + columnCount - 1) / columnCount;
+    }
+    else {
+        columnCount = width > 0.0 ? cellCount : 1;
+        rowCount = height > 0.0 ? cellCount : 1;
+    }
+    gridClusterCount = clusterCount;
+
+    const double scaleX = width > 0.0 ? static_cast<double>(columnCount) / width : 0.0;
+    const double scaleY = height > 0.0 ? static_cast<double>(rowCount) / height : 0.0;
+    sampleCells.resize(N);
+    pool.parallelFor(getBlockCount(), [&](size_t block) {
+        for (size_t i = getBlockBegin(block); i < getBlockBegin(block + 1); ++i) {
+            const size_t column = min(columnCount - 1, static_cast<size_t>((x[i] - lowX) * scaleX));
+            const size_t row = min(rowCount - 1, static_cast<size_t>((y[i] - lowY) * scaleY));
+            sampleCells[i] = row * columnCount + column;
+        }
+        });
+
+    // The boxes only depend on the samples of each cell, so the rounding of the cell index is harmless
+    const size_t cells = columnCount * rowCount;
+    cellLower.assign(2 * cells, numeric_limits<double>::max());
+    cellUpper.assign(2 * cells, numeric_limits<double>::lowest());
+    for (size_t i = 0; i < N; ++i) {
+        const size_t cell = sampleCells[i];
+        cellLower[2 * cell] = min(cellLower[2 * cell], x[i]);
+        cellUpper[2 * cell] = max(cellUpper[2 * cell], x[i]);
+        cellLower[2 * cell + 1] = min(cellLower[2 * cell + 1], y[i]);
+        cellUpper[2 * cell + 1] = max(cellUpper[2 * cell + 1], y[i]);
+    }
+
+    cellStarts.assign(cells + 1, 0);
+    rowCenters.resize(rowCount);
+    rowCounts.resize(rowCount);
+}
+
+/**
+ * @brief Lists the candidates of every cell. The center with the smallest largest distance to the
+ *        box bounds the distance from any point of the box to its nearest center; every center whose
+ *        smallest distance to the box is not clearly above that bound is a candidate. The rows of
+ *        cells are processed in parallel, then their lists are joined in cell order.
+ */
+void GridEngine::updateCandidates()
+{
+    const size_t K = gridClusterCount;
+    const double* center = centers.data();
+
+    pool.parallelFor(rowCount, [&](size_t row) {
+        vector<size_t>& list = rowCenters[row];
+        vector<size_t>& counts = rowCounts[row];
+        list.clear();
+        counts.assign(columnCount, 0);
+
+        for (size_t column = 0; column < columnCount; ++column) {
+            const size_t cell = row * columnCount + column;
+            const double* lower = &cellLower[2 * cell];
+            const double* upper = &cellUpper[2 * cell];
+            if (lower[0] > upper[0]) {
+                continue;  ///< No sample in the cell
+            }
+
+            // The smallest, over the centers, of the squared distance to the farthest corner of the box
+            double bound = numeric_limits<double>::max();
+            for (size_t k = 0; k < K; ++k) {
+                const double farX = max(fabs(center[2 * k] - lower[0]), fabs(center[2 * k] - upper[0]));
+                const double farY = max(fabs(center[2 * k + 1] - lower[1]), fabs(center[2 * k + 1] - upper[1]));
+                bound = min(bound, farX * farX + farY * farY);
+            }
+            bound *= 1.0 + PRUNING_MARGIN;
+
+            const size_t before = list.size();
+            for (size_t k = 0; k < K; ++k) {
+                const double nearX = max(max(lower[0] - center[2 * k], center[2 * k] - upper[0]), 0.0);
+                const double nearY = max(max(lower[1] - center[2 * k + 1], center[2 * k + 1] - upper[1]), 0.0);
+                if (nearX * nearX + nearY * nearY <= bound) {
+                    list.push_back(k);
+                }
+            }
+            counts[column] = list.size() - before;
+        }
+        });
+
+    size_t total = 0;
+    for (size_t row = 0; row < rowCount; ++row) {
+        for (size_t column = 0; column < columnCount; ++column) {
+            cellStarts[row * columnCount + column] = total;
+            total += rowCounts[row][column];
+        }
+    }
+    cellStarts[rowCount * columnCount] = total;
+
+    cellCenters.resize(total);
+    for (size_t row = 0; row < rowCount; ++row) {
+        copy(rowCenters[row].begin(), rowCenters[row].end(), cellCenters.begin() + cellStarts[row * columnCount]);
+    }
+}
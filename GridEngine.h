@@ -0,0 +1,93 @@
+#ifndef GRIDENGINE_H
+#define GRIDENGINE_H
+
+#include "AssignmentEngine.h"
+
+using namespace std;
+
+/**
+ * @class GridEngine
+ * @brief Assignment step for 2D samples based on a uniform grid over the plane.
+ *        The grid is laid once over the bounding box of the samples, with a few cells per center,
+ *        and every sample remembers its cell; each cell knows the tight bounding box of its samples.
+ *        At every assignment, each cell lists the centers that can be the nearest one to some point
+ *        of its box: a center is left out when its smallest distance to the box exceeds the largest
+ *        distance from the box to another center. A sample is then only compared with the short list
+ *        of its cell instead of the K centers.
+ *
+ *        A center is only left out when it loses by a relative margin far above the rounding errors
+ *        of the distances, and the lists keep the centers in index order, so the labels are the same
+ *        as the brute-force LloydEngine, including ties. The samples are processed in the same blocks,
+ *        so the sums are bitwise identical too.
+ *
+ *        Rebuilding the lists costs about 8 x K^2 box-to-center distances per assignment, far below
+ *        the N x K distances of the brute-force search as long as K is much smaller than N.
+ */
+class GridEngine : public AssignmentEngine
+{
+public:
+
+    /**
+     * @brief Constructor that binds the engine to the samples and the thread pool.
+     *
+     * @param data The 2D samples to assign.
+     * @param pool The thread pool used to process the blocks.
+     */
+    GridEngine(Dataset& data, ThreadPool& pool);
+
+    /**
+     * @brief Assigns each sample to the nearest cluster among the candidates of its cell.
+     *        The grid is laid at the first call, and again when the samples or the number of clusters change.
+     *
+     * @param clusters The clusters with their current centers.
+     * @throws invalid_argument If the samples are not 2D.
+     */
+    void assign(const vector<Cluster>& clusters) override;
+
+private:
+
+    /**
+     * @brief Lays the grid over the samples: sets its size from the number of clusters and the
+     *        shape of the bounding box, finds the cell of every sample and the box of every cell.
+     *
+     * @param clusterCount The number of clusters.
+     */
+    void buildGrid(size_t clusterCount);
+
+    /**
+     * @brief Lists, for every cell, the centers that can be the nearest one to a point of its box.
+     */
+    void updateCandidates();
+
+    /** The number of cells along the first coordinate. */
+    size_t columnCount;
+
+    /** The number of cells along the second coordinate. */
+    size_t rowCount;
+
+    /** The number of clusters the grid was laid for. */
+    size_t gridClusterCount;
+
+    /** The cell of every sample: row * columnCount + column. */
+    vector<size_t> sampleCells;
+
+    /** The lowest coordinates of the samples of every cell, row-major (cells x 2); empty cells have lower > upper. */
+    vector<double> cellLower;
+
+    /** The highest coordinates of the samples of every cell, row-major (cells x 2). */
+    vector<double> cellUpper;
+
+    /** The candidates of cell c are cellCenters[cellStarts[c]] to cellCenters[cellStarts[c + 1] - 1]. */
+    vector<size_t> cellStarts;
+
+    /** The candidate centers of all cells, one list after the other, each in index order. */
+    vector<size_t> cellCenters;
+
+    /** The candidate lists of each row of cells, built in parallel before they are joined. */
+    vector<vector<size_t>> rowCenters;
+
+    /** The number of candidates of each cell of each row. */
+    vector<vector<size_t>> rowCounts;
+};
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef HALFFLOAT_H
+#define HALFFLOAT_H
+
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+/**
+ * @struct Half
+ * @brief An IEEE 754 binary16 number: 1 sign bit, 5 exponent bits, 10 fraction bits. It keeps about
+ *        3 significant digits over a range of 6e-5 to 65504.
+ */
+struct Half
+{
+    uint16_t bits; ///< The encoded number.
+};
+
+/**
+ * @struct BFloat16
+ * @brief A bfloat16 number: the upper half of a float, with its 8 exponent bits. It keeps about
+ *        2 significant digits over the whole float range.
+ */
+struct BFloat16
+{
+    uint16_t bits; ///< The encoded number.
+};
+
+/**
+ * @brief Returns the bits of a float.
+ *
+ * @param value The float.
+ * @return The IEEE 754 encoding of the float.
+ */
+inline uint32_t floatBits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/**
+ * @brief Returns the float encoded by some bits.
+ *
+ * @param bits The IEEE 754 encoding.
+ * @return The float.
+ */
+inline float bitsToFloat(uint32_t bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Rounds a float to the nearest half, ties to even, like the F16C conversion instructions.
+ *        Values beyond the half range become infinities and tiny values become subnormals or zero.
+ *
+ * @param value The float.
+ * @return The half.
+ */
+inline Half toHalf(float value)
+{
+    const uint32_t bits = floatBits(value);
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    const uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+    if (magnitude >= 0x7F800000u) {
+        // Infinity stays infinity; a NaN keeps its upper fraction bits and stays a NaN
+        const uint16_t fraction = magnitude > 0x7F800000u ? static_cast<uint16_t>(0x0200u | ((magnitude >> 13) & 0x03FFu)) : 0;
+        return { static_cast<uint16_t>(sign | 0x7C00u | fraction) };
+    }
+    if (magnitude >= 0x477FF000u) {
+        return { static_cast<uint16_t>(sign | 0x7C00u) };  ///< Rounds above 65504
+    }
+    if (magnitude < 0x38800000u) {
+        // Below the smallest normal half: scale into a subnormal, rounding the shifted-out bits
+        if (magnitude < 0x33000000u) {
+            return { sign };  ///< Below half the smallest subnormal
+        }
+        const uint32_t exponent = magnitude >> 23;
+        const uint32_t mantissa = (magnitude & 0x007FFFFFu) | 0x00800000u;
+        const uint32_t shift = 126 - exponent;
+        uint32_t result = mantissa >> shift;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (result & 1))) {
+            ++result;
+        }
+        return { static_cast<uint16_t>(sign | result) };
+    }
+
+    // Normal: rebias the exponent from 127 to 15 and round the 13 dropped fraction bits
+    uint32_t result = (magnitude - 0x38000000u) >> 13;
+    const uint32_t remainder = magnitude & 0x1FFFu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (result & 1))) {
+        ++result;
+    }
+    return { static_cast<uint16_t>(sign | result) };
+}
+
+/**
+ * @brief Widens a half to the float of the same value.
+ *
+ * @param value The half.
+ * @return The float.
+ */
+inline float toFloat(Half value)
+{
+    const uint32_t sign = static_cast<uint32_t>(value.bits & 0x8000u) << 16;
+    const uint32_t exponent = (value.bits >> 10) & 0x1Fu;
+    uint32_t fraction = value.bits & 0x03FFu;
+
+    if (exponent == 0x1Fu) {
+        // Infinity, or a NaN made quiet like the conversion instructions do
+        return bitsToFloat(sign | 0x7F800000u | (fraction != 0 ? 0x00400000u | (fraction << 13) : 0));
+    }
+    if (exponent != 0) {
+        return bitsToFloat(sign | ((exponent + 112) << 23) | (fraction << 13));
+    }
+    if (fraction == 0) {
+        return bitsToFloat(sign);
+    }
+
+    // Subnormal: normalize the fraction
+    uint32_t floatExponent = 113;
+    while ((fraction & 0x0400u) == 0) {
+        fraction <<= 1;
+        --floatExponent;
+    }
+    return bitsToFloat(sign | (floatExponent << 23) | ((fraction & 0x03FFu) << 13));
+}
+
+/**
+ * @brief Rounds a float to the nearest bfloat16, ties to even. A NaN stays a NaN.
+ *
+ * @param value The float.
+ * @return The bfloat16.
+ */
+inline BFloat16 toBFloat16(float value)
+{
+    const uint32_t bits = floatBits(value);
+    if ((bits & 0x7FFFFFFFu) > 0x7F800000u) {
+        return { static_cast<uint16_t>((bits >> 16) | 0x0040u) };
+    }
+    return { static_cast<uint16_t>((bits + 0x7FFFu + ((bits >> 16) & 1)) >> 16) };
+}
+
+/**
+ * @brief Widens a bfloat16 to the float of the same value.
+ *
+ * @param value The bfloat16.
+ * @return The float.
+ */
+inline float toFloat(BFloat16 value)
+{
+    return bitsToFloat(static_cast<uint32_t>(value.bits) << 16);
+}
+
+#endif
@@ -0,0 +1,164 @@
+/****************************************************************************
+ * @file HamerlyEngine.cpp
+ * @brief Implementation of the HamerlyEngine class. The engine keeps one upper
+ *        and one lower bound per sample and only recomputes the distances of
+ *        the samples whose bounds no longer prove that their center is closest.
+ ****************************************************************************/
+
+#include "HamerlyEngine.h"
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+/**
+ * @brief Constructor that binds the engine to the samples and the thread pool.
+ *
+ * @param data The samples to assign.
+ * @param pool The thread pool used to process the blocks.
+ */
+HamerlyEngine::HamerlyEngine(Dataset& data, ThreadPool& pool)
+    : AssignmentEngine(data, pool), initialized(false), clusterCount(0)
+{
+}
+
+/**
+ * @brief Assigns each sample to the nearest cluster.
+ *        The bounds are first moved by the distance the centers travelled. A sample keeps its
+ *        center when its upper bound is strictly below max(lower bound, half the distance from
+ *        its center to the nearest other center); the strict test keeps the tie handling of the
+ *        brute-force loop. Otherwise the upper bound is made exact and tested again, and only
+ *        then are all the distances of the sample computed.
+ *
+ * @param clusters The clusters with their current centers.
+ */
+void HamerlyEngine::assign(const vector<Cluster>& clusters)
+{
+    loadCenters(clusters);
+
+    const bool rebuild = !initialized || clusterCount != clusters.size() || upperBounds.size() != data.size();
+    clusterCount = clusters.size();
+    resetBlockSums(clusterCount);
+
+    if (rebuild) {
+        upperBounds.assign(data.size(), 0.0);
+        lowerBounds.assign(data.size(), 0.0);
+        centerShifts.assign(clusterCount, 0.0);
+        halfNearestCenter.assign(clusterCount, 0.0);  ///< Never lets a sample skip the first pass
+    }
+    else {
+        computeCenterShifts();
+        computeHalfNearestCenter();
+    }
+
+    // The lower bound of a sample drops by the largest shift among the other centers
+    size_t farthestMoved = 0;
+    double largestShift = 0.0, secondLargestShift = 0.0;
+    for (size_t j = 0; j < clusterCount; ++j) {
+        if (centerShifts[j] > largestShift) {
+            secondLargestShift = largestShift;
+            largestShift = centerShifts[j];
+            farthestMoved = j;
+        }
+        else if (centerShifts[j] > secondLargestShift) {
+            secondLargestShift = centerShifts[j];
+        }
+    }
+
+    int* labels = data.getLabels();
+
+    dispatchDimension(dimension, [&](auto dim) {
+        pool.parallelFor(getBlockCount(), [&](size_t block) {
+            const size_t end = getBlockBegin(block + 1);
+            double* sums = getBlockSums(block);
+            auto point = dim.makePoint();
+            size_t distanceCount = 0;
+
+            for (size_t i = getBlockBegin(block); i < end; ++i) {
+                loadPoint(i, point.data(), dim);
+                size_t a = rebuild ? 0 : static_cast<size_t>(labels[i] - 1);
+                double upper = upperBounds[i] + centerShifts[a];
+                double lower = lowerBounds[i] - (a == farthestMoved ? secondLargestShift : largestShift);
+                double limit = max(halfNearestCenter[a], lower);
+
+                if (!rebuild && upper < limit) {
+                    upperBounds[i] = upper;
+                    lowerBounds[i] = lower;
+                    recordAssignment(sums, labels[i], a, point.data(), dim);
+                    continue;
+                }
+
+                // Make the upper bound exact and try again
+                if (!rebuild) {
+                    upper = distance(point.data(), a, dim);
+                    ++distanceCount;
+                    if (upper < limit) {
+                        upperBounds[i] = upper;
+                        lowerBounds[i] = lower;
+                        recordAssignment(sums, labels[i], a, point.data(), dim);
+                        continue;
+                    }
+                }
+
+                findTwoClosest(point.data(), dim, a, upper, lower);
+                distanceCount += clusterCount;
+
+                upperBounds[i] = upper;
+                lowerBounds[i] = lower;
+                recordAssignment(sums, labels[i], a, point.data(), dim);
+            }
+
+            setBlockDistanceCount(block, distanceCount);
+            });
+        });
+
+    mergeBlockSums();
+    storeCenters();
+    initialized = true;
+}
+
+/**
+ * @brief Computes half the distance from every center to its nearest other center.
+ */
+void HamerlyEngine::computeHalfNearestCenter()
+{
+    halfNearestCenter.assign(clusterCount, numeric_limits<double>::max());
+
+    for (size_t a = 0; a < clusterCount; ++a) {
+        for (size_t b = a + 1; b < clusterCount; ++b) {
+            double half = 0.5 * centerDistance(a, b);
+            halfNearestCenter[a] = min(halfNearestCenter[a], half);
+            halfNearestCenter[b] = min(halfNearestCenter[b], half);
+        }
+    }
+}
+
+/**
+ * @brief Finds the closest and the second closest center of a sample by computing every distance.
+ *
+ * @param point The coordinates of the sample.
+ * @param dim The dimension object given by dispatchDimension().
+ * @param closest Receives the index of the closest center.
+ * @param closestDistance Receives the distance to the closest center.
+ * @param secondDistance Receives the distance to the second closest center.
+ */
+template <typename Dim>
+void HamerlyEngine::findTwoClosest(const double* point, Dim dim, size_t& closest, double& closestDistance,
+    double& secondDistance) const
+{
+    closest = 0;
+    closestDistance = numeric_limits<double>::max();
+    secondDistance = numeric_limits<double>::max();
+
+    for (size_t j = 0; j < clusterCount; ++j) {
+        double d = distance(point, j, dim);
+        if (d < closestDistance) {
+            secondDistance = closestDistance;
+            closestDistance = d;
+            closest = j;
+        }
+        else if (d < secondDistance) {
+            secondDistance = d;
+        }
+    }
+}
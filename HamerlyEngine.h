@@ -0,0 +1,74 @@
+#ifndef HAMERLYENGINE_H
+#define HAMERLYENGINE_H
+
+#include "AssignmentEngine.h"
+
+using namespace std;
+
+/**
+ * @class HamerlyEngine
+ * @brief Assignment step accelerated with a single pair of bounds per sample (Hamerly, 2010).
+ *        Every sample keeps an upper bound on the distance to its own center and one lower
+ *        bound on the distance to any other center. A sample is only examined again when its
+ *        upper bound exceeds both the lower bound and half the distance from its center to
+ *        the nearest other center. The memory use is O(N + K) instead of O(N x K) for Elkan,
+ *        which makes it the better choice when K is small.
+ *        The labels are the same as the brute-force LloydEngine, including ties.
+ */
+class HamerlyEngine : public AssignmentEngine
+{
+public:
+
+    /**
+     * @brief Constructor that binds the engine to the samples and the thread pool.
+     *
+     * @param data The samples to assign.
+     * @param pool The thread pool used to process the blocks.
+     */
+    HamerlyEngine(Dataset& data, ThreadPool& pool);
+
+    /**
+     * @brief Assigns each sample to the nearest cluster, skipping the samples whose bounds prove it unchanged.
+     *
+     * @param clusters The clusters with their current centers.
+     */
+    void assign(const vector<Cluster>& clusters) override;
+
+private:
+
+    /**
+     * @brief Computes half the distance from every center to its nearest other center.
+     */
+    void computeHalfNearestCenter();
+
+    /**
+     * @brief Finds the closest and the second closest center of a sample by computing every distance.
+     *        Ties go to the center with the lower ID, like in the brute-force loop.
+     *
+     * @param point The coordinates of the sample.
+     * @param dim The dimension object given by dispatchDimension().
+     * @param closest Receives the index of the closest center.
+     * @param closestDistance Receives the distance to the closest center.
+     * @param secondDistance Receives the distance to the second closest center.
+     */
+    template <typename Dim>
+    void findTwoClosest(const double* point, Dim dim, size_t& closest, double& closestDistance,
+        double& secondDistance) const;
+
+    /** Whether the bounds have been initialized. */
+    bool initialized;
+
+    /** The number of clusters the bounds were built for. */
+    size_t clusterCount;
+
+    /** For every sample, an upper bound on the distance to its assigned center. */
+    vector<double> upperBounds;
+
+    /** For every sample, a lower bound on the distance to every center other than its own. */
+    vector<double> lowerBounds;
+
+    /** For every center, half the distance to its nearest other center. */
+    vector<double> halfNearestCenter;
+};
+
+#endif
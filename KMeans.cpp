@@ -2,190 +2,440 @@
  * @file KMeans.cpp
  * @brief This code is a C++ program that implements the K-means clustering algorithm.
  *        The K-means algorithm is used to divide data points into groups (clusters)
- *        with similar properties. It divides the given data set into K clusters
- *        and prints the results of these clusters on the screen and saves them to a file.
- *        It takes the data in the form of a file path, gets the number of clusters and
- *        finally gets the directory to save.
+ *        with similar properties. It divides the given data set into K clusters,
+ *        read from a file or given in memory, labels new points with the trained
+ *        centers, and prints or saves the labelled samples when asked to.
  ****************************************************************************/
 
 #include "KMeans.h"  // Definition of the KMeans class
+#include "BinaryDataset.h" // Memory-mapped binary input files
+#include "CenterInitializer.h" // Choice of the initial cluster centers
 #include "Cluster.h" // Definition of the Cluster class
-#include "Sample.h"  // Definition of the Sample data class
+#include "ResultWriter.h" // Parallel formatting of the results
+#include "StreamingTrainer.h" // Out-of-core K-means over binary files
+#include "TextLoader.h" // Parallel parsing of the input file
 #include <fstream>   // For file reading/writing
 #include <iostream>  // For console input/output
 #include <cmath>     // For mathematical operations 
 #include <limits>    // For defining boundary values 
 #include <stdexcept> // For exception handling
-#include <iomanip>   // For formatted output
 #include <vector>
 #include <algorithm>
+#include <chrono>    // For the time budget
 
 using namespace std; // Use standard namespace
 
 /**
- * @brief Constructor for KMeans class that initializes the algorithm with the given input file,
- *        the number of clusters (K), and the output file name.
+ * @brief Describes why training stopped, for the printed results.
+ *
+ * @param reason The stop reason.
+ * @return const char* The description.
+ */
+static const char* describeStopReason(StopReason reason)
+{
+    switch (reason) {
+    case StopReason::Converged:        return "the centers converged";
+    case StopReason::MaxIterations:    return "the iteration limit was reached";
+    case StopReason::InertiaTolerance: return "the inertia stopped improving";
+    case StopReason::LabelChanges:     return "too few samples changed cluster";
+    case StopReason::TimeBudget:       return "the time budget was spent";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Constructor for KMeans class that sets the number of clusters (K) and the tuning parameters.
+ *        No file is read and nothing is trained until fit() is called.
  *
- * @param fileName The input file name containing sample data.
  * @param k The number of clusters (K).
- * @param OutputfileName The output file name to save the results.
+ * @param options Tuning parameters such as the number of threads and the assignment algorithm.
  */
-KMeans::KMeans(const string& fileName, int k, const string& OutputfileName)
-    : K(k) {
+KMeans::KMeans(int k, const KMeansOptions& options)
+    : K(k), options(options), pool(options.threadCount),
+    engine(AssignmentEngine::create(options, samples, pool)), stopReason(StopReason::Converged) {
 
     // Ensure the number of clusters (K) is a positive integer
     if (K <= 0) {
         throw invalid_argument("K must be a positive number.");
     }
+}
 
-    setFileName(fileName);                ///< Set the input file name
-    setOutputFileName(OutputfileName);    ///< Set the output file name
+/**
+ * @brief Trains the clusters on the samples of a text or binary file, or streams the file
+ *        chunk by chunk in the out-of-core mode.
+ *
+ * @param fileName The input file name containing sample data.
+ */
+void KMeans::fit(const string& fileName) {
+    if (options.chunkSize > 0) {
+        samples.clear();
+        updateKMOutOfCore(fileName);      ///< Stream the file chunk by chunk instead of loading it
+        return;
+    }
 
-    loadSamples(getFileName());           ///< Load the sample data from the file
-    initialize();                         ///< Initialize the clusters using the first K samples
-    updateKM();                           ///< Perform the K-means clustering algorithm
+    loadSamples(fileName);                ///< Load the sample data from the file
+    train();
 }
 
 /**
- * @brief Destructor for the KMeans class that prints and saves the results when the object is destroyed.
+ * @brief Trains the clusters on a copy of a dataset.
+ *
+ * @param data The samples.
  */
-KMeans::~KMeans()
-{
-    printResults(getSamples());          ///< Print the final results
-    saveResultsToFile(getOutputFileName()); ///< Save the results to a file
+void KMeans::fit(const Dataset& data) {
+    samples = data;
+    train();
+}
+
+/**
+ * @brief Trains the clusters on row-major points, numbered from 1.
+ *
+ * @param points The sampleCount x dimension coordinates.
+ * @param sampleCount The number of points.
+ * @param dimension The number of coordinates of every point.
+ */
+void KMeans::fit(const double* points, size_t sampleCount, size_t dimension) {
+    samples.reset(dimension, options.precision);
+    samples.resize(sampleCount);
+
+    int* indices = samples.getWritableIndices();
+    for (size_t i = 0; i < sampleCount; ++i) {
+        indices[i] = static_cast<int>(i + 1);
+    }
+    Dataset::visitPrecision(options.precision, [&](auto* type) {
+        using T = remove_pointer_t<decltype(type)>;
+        for (size_t d = 0; d < dimension; ++d) {
+            T* column = samples.getWritableStoredColumn<T>(d);
+            for (size_t i = 0; i < sampleCount; ++i) {
+                column[i] = Dataset::narrow<T>(points[i * dimension + d]);  ///< Transpose into the columns
+            }
+        }
+        });
+    train();
 }
 
 /**
- * @brief Get input file directory.
+ * @brief Trains the clusters on the loaded samples with the algorithm selected in the options.
+ *        The engine is created again, so no bound of a previous fit survives.
+ */
+void KMeans::train() {
+    clusters.clear();
+    model.reset();
+    iterationStatistics.clear();
+    miniBatchReports.clear();
+    engine = AssignmentEngine::create(options, samples, pool);
+    samples.setPrecision(options.precision);  ///< Once the engine accepted it; the loaders already store it
+
+    initialize();                         ///< Initialize the clusters with the method selected in the options
+    if (options.batchSize > 0) {
+        trainMiniBatch();                 ///< Train on random batches of samples
+    }
+    else {
+        updateKM();                       ///< Perform the K-means clustering algorithm
+    }
+}
+
+/**
+ * @brief Records the training summary of the last fit and builds the frozen model once, so that
+ *        getModel() and predict() do not copy the centers at every call.
  *
- * @return string The input file path.
+ * @param sampleCount The number of training samples.
+ * @param iterationCount The number of iterations, batches or passes run.
+ * @param inertia The sum of the squared distances of the samples to their centers.
+ * @param counts The number of samples of every cluster.
  */
-string KMeans::getFileName() const {
-    return fileName;
+void KMeans::summarizeTraining(size_t sampleCount, size_t iterationCount, double inertia, const vector<size_t>& counts) {
+    summary.sampleCount = sampleCount;
+    summary.iterationCount = iterationCount;
+    summary.inertia = inertia;
+    summary.algorithm = options.algorithm;
+    summary.initialization = options.initialization;
+    summary.seed = options.seed;
+    summary.stopReason = stopReason;
+    model.emplace(clusters, counts, summary, options.instructionSet);
 }
 
 /**
- * @brief Set input file directory.
+ * @brief Returns the frozen copy of the trained centers built at the end of the last fit.
  *
- * @param fileName The file path to the input data.
+ * @return const KMeansModel& The model.
+ * @throws runtime_error If the model has not been fitted.
  */
-void KMeans::setFileName(const string& fileName) {
-    this->fileName = fileName;
+const KMeansModel& KMeans::getModel() const {
+    if (!model) {
+        throw runtime_error("The model has not been fitted.");
+    }
+    return *model;
 }
 
 /**
- * @brief Get output file directory.
+ * @brief Returns the ID of the nearest trained cluster center of each point.
  *
- * @return string The output file path.
+ * @param points The count x D coordinates, row-major.
+ * @param count The number of points.
+ * @return vector<int> The cluster ID of every point.
  */
-string KMeans::getOutputFileName() const {
-    return outputfileName;
+vector<int> KMeans::predict(const double* points, size_t count) {
+    vector<int> labels(count);
+    predict(points, count, labels.data(), nullptr);
+    return labels;
 }
 
 /**
- * @brief Set output file directory.
+ * @brief Labels a batch of points with the nearest trained cluster center.
  *
- * @param OutputfileName The file path to save the output data.
+ * @param points The count x D coordinates, row-major.
+ * @param count The number of points.
+ * @param labels Receives the cluster ID of every point.
+ * @param distances Receives the distance of every point to its center; may be null.
  */
-void KMeans::setOutputFileName(const string& OutputfileName) {
-    this->outputfileName = OutputfileName;
+void KMeans::predict(const double* points, size_t count, int* labels, double* distances) {
+    getModel().predict(points, count, labels, distances, pool);
+}
+
+/**
+ * @brief Get the number of threads used by the parallel steps.
+ *
+ * @return unsigned int The number of threads, including the calling thread.
+ */
+unsigned int KMeans::getThreadCount() const {
+    return pool.getThreadCount();
+}
+
+/**
+ * @brief Get the algorithm used to assign the samples to the clusters.
+ *
+ * @return Algorithm The assignment algorithm.
+ */
+Algorithm KMeans::getAlgorithm() const {
+    return options.algorithm;
+}
+
+/**
+ * @brief Get the instruction set used by the distance kernel, after the run-time CPU detection.
+ *
+ * @return InstructionSet The instruction set.
+ */
+InstructionSet KMeans::getInstructionSet() const {
+    return engine->getInstructionSet();
 }
 
 /**
  * @brief Method to load sample data from the specified file.
- *        This function reads sample data (index, x, y)
- *        from a file and creates Sample objects to store the data in a vector.
+ *        This function reads one sample per line (index followed by its coordinates,
+ *        e.g. index, x, y for 2D data) into the sample dataset. The file is memory-mapped
+ *        and parsed in parallel chunks by TextLoader.
+ *        The dimension is the number of coordinates on the first non-empty line.
+ *        Files in the binary format (see BinaryDataset) are memory-mapped and used without parsing.
+ *        The coordinates are stored in the precision of the options as they are read.
  *
  * @param fileName The name of the input file to load sample data from.
- * @throws runtime_error If the file cannot be opened.
+ * @throws runtime_error If the file cannot be opened or a line has the wrong number of values.
  */
 void KMeans::loadSamples(const string& fileName) {
-    ifstream file(getFileName());  ///< Open the file
-    if (!file) {
-        throw runtime_error("File not found: " + getFileName());  ///< Throw an exception if the file cannot be opened
+    if (BinaryDataset::isBinaryFile(fileName)) {
+        BinaryDataset::load(fileName, samples, options.precision);
     }
-
-    int index;
-    double x, y;
-
-    // Read the data (index, x, y) and create Sample objects to store them
-    while (file >> index >> x >> y) {
-        samples.emplace_back(index, -1, x, y);  ///< Create a Sample object and add it to the samples vector
+    else {
+        TextLoader(pool).load(fileName, samples, options.precision);
     }
-
-    file.close();  ///< Close the file after reading
 }
 
 /**
- * @brief This function creates K clusters and sets their centers to the first K samples.
+ * @brief This function creates K clusters and sets their centers to K samples chosen with the
+ *        initialization method of the options: the first K samples, or k-means++ seeding.
+ *
+ * @throws runtime_error If there are fewer samples than clusters.
  */
 void KMeans::initialize() {
-    int clusterId = 1;
-    for_each(samples.begin(), samples.begin() + K, [&](const Sample& sample) {
-        clusters.emplace_back(clusterId++, sample.getX(), sample.getY());
-        });
+    if (samples.size() < static_cast<size_t>(K)) {
+        throw runtime_error("The input file holds fewer samples than the number of clusters.");
+    }
+
+    CenterInitializer initializer(samples, pool, options);
+    const vector<size_t> rows = initializer.chooseCenters(options.initialization, K);
+
+    vector<double> center(samples.getDimension());
+    for (int clusterId = 1; clusterId <= K; ++clusterId) {
+        for (size_t d = 0; d < center.size(); ++d) {
+            center[d] = samples.getCoordinate(d, rows[clusterId - 1]);
+        }
+        clusters.emplace_back(clusterId, center);
+    }
 }
 
 /**
- * @brief This method calculates the Euclidean distance between each sample and
- *        the centers of all clusters, and assigns the sample to the nearest cluster.
+ * @brief This method assigns every sample to the nearest cluster with the selected
+ *        assignment engine. The engine labels the samples and collects the coordinate sums
+ *        and counts of every cluster on the way; no member list is built.
  */
 void KMeans::assignSamplesToClusters() {
-    // Clear all existing samples from the clusters before reassigning
-    for_each(clusters.begin(), clusters.end(), [](Cluster& cluster) {
-        cluster.clearSamples();
-        });
-
-    // Assign each sample to the nearest cluster
-    for_each(samples.begin(), samples.end(), [&](Sample& sample) {
-        double minDistance = numeric_limits<double>::max();  ///< Initialize with a large value
-        int bestClusterID = -1;
-
-        // Calculate the distance from the sample to each cluster center
-        for_each(clusters.begin(), clusters.end(), [&](const Cluster& cluster) {
-            double distance = sqrt(pow(sample.getX() - cluster.getXofCluster(), 2) +
-                pow(sample.getY() - cluster.getYofCluster(), 2));
-
-            // Update the best cluster if the current one is closer
-            if (distance < minDistance) {
-                minDistance = distance;
-                bestClusterID = cluster.getIDofCluster();
-            }
-            });
-
-        // Assign the sample to the closest cluster
-        sample.setClusterID(bestClusterID);  ///< Ensure this method exists and is accessible
-        clusters[bestClusterID - 1].addSample(&sample);  ///< Add the sample to the best cluster
-        });
+    engine->assign(clusters);
+    iterationStatistics.push_back({ engine->getDistanceCount(), engine->getSkippedDistanceCount() });
 }
 
 /**
- * @brief This function assigns samples to clusters, calculates
- *        new cluster centers, and repeats the process until the cluster centers stop changing.
+ * @brief This function assigns samples to clusters, calculates new cluster centers, and repeats
+ *        the process until the cluster centers stop changing or another stopping criterion of the
+ *        options is met. When the sums are updated incrementally, the final centers come from exact sums.
+ *        When training stops before the centers settle, one more assignment labels the samples with
+ *        the final centers; it is not counted in the iteration statistics.
  */
 void KMeans::updateKM() {
-    bool changed;
-    do {
-        changed = false;
+    const auto start = chrono::steady_clock::now();
+    const size_t N = samples.size();
+    vector<int> previousLabels;
+    double previousInertia = 0.0;
+
+    // With the default tolerance, only centers that did not change at all have converged
+    auto converged = [this](bool changed, double shift) {
+        return !changed || (options.shiftTolerance > 0.0 && shift <= options.shiftTolerance);
+    };
+
+    for (size_t iteration = 1; ; ++iteration) {
+        if (options.labelChangeTolerance > 0.0) {
+            previousLabels.assign(samples.getLabels(), samples.getLabels() + N);
+        }
 
         // Step 1: Assign samples to the closest clusters
         assignSamplesToClusters();
 
-        // Step 2: Update the cluster centers and check if any of them changed
-        for (auto& cluster : clusters) {
-            if (cluster.calculateCenter()) {
-                changed = true;  ///< If any cluster center changed, continue the iteration
+        const double inertia = options.inertiaTolerance > 0.0 ? engine->computeInertia() : 0.0;
+        size_t changedLabels = 0;
+        if (options.labelChangeTolerance > 0.0) {
+            const int* labels = samples.getLabels();
+            for (size_t i = 0; i < N; ++i) {
+                changedLabels += labels[i] != previousLabels[i];
             }
         }
-    } while (changed);  ///< Repeat until no cluster centers change
+
+        // Step 2: Update the cluster centers from the merged sums and measure how far they moved
+        double shift = 0.0;
+        bool changed = updateCenters(shift);
+
+        // Incremental sums may carry rounding errors: convergence is confirmed with exact sums
+        if (converged(changed, shift) && engine->hasIncrementalSums()) {
+            engine->recomputeSums();
+            changed = updateCenters(shift);
+        }
+
+        // Step 3: Check the stopping criteria, the convergence of the centers first
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        if (converged(changed, shift)) {
+            stopReason = StopReason::Converged;
+        }
+        else if (options.labelChangeTolerance > 0.0 && changedLabels < options.labelChangeTolerance * N) {
+            stopReason = StopReason::LabelChanges;
+        }
+        else if (options.inertiaTolerance > 0.0 && iteration > 1
+            && previousInertia - inertia < options.inertiaTolerance * previousInertia) {
+            stopReason = StopReason::InertiaTolerance;
+        }
+        else if (options.maxIterations > 0 && iteration >= options.maxIterations) {
+            stopReason = StopReason::MaxIterations;
+        }
+        else if (options.timeBudget > 0.0 && elapsed.count() >= options.timeBudget) {
+            stopReason = StopReason::TimeBudget;
+        }
+        else {
+            previousInertia = inertia;
+            continue;  ///< No criterion met: run another iteration
+        }
+
+        if (engine->hasIncrementalSums()) {
+            engine->recomputeSums();
+            changed = updateCenters(shift) || changed;
+        }
+
+        // The last assignment used the centers before their update: unless they stayed the same, the
+        // samples are assigned once more so that the labels, inertia and counts belong to the saved centers
+        if (changed) {
+            engine->assign(clusters);
+        }
+        summarizeTraining(N, iteration, engine->computeInertia(), engine->getCounts());
+        break;
+    }
+}
+
+/**
+ * @brief This function sets the center of every cluster from the sums and counts of the engine.
+ *
+ * @param largestShift Receives the largest distance a center moved.
+ * @return true If any cluster center changed.
+ */
+bool KMeans::updateCenters(double& largestShift) {
+    const vector<double>& sums = engine->getSums();
+    const vector<size_t>& counts = engine->getCounts();
+    const size_t D = samples.getDimension();
+
+    bool changed = false;
+    largestShift = 0.0;
+    vector<double> previous;
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        previous = clusters[c].getCenter();
+        if (clusters[c].calculateCenter(&sums[c * D], counts[c])) {
+            changed = true;  ///< If any cluster center changed, continue the iteration
+
+            double squaredShift = 0.0;
+            for (size_t d = 0; d < D; ++d) {
+                const double step = clusters[c].getCenter()[d] - previous[d];
+                squaredShift += step * step;
+            }
+            largestShift = max(largestShift, sqrt(squaredShift));
+        }
+    }
+    return changed;
+}
+
+/**
+ * @brief This function trains the cluster centers with mini-batch K-means, recording the inertia
+ *        every reportInterval batches, and then labels every sample with one full assignment pass.
+ */
+void KMeans::trainMiniBatch() {
+    MiniBatchTrainer trainer(samples, pool, options);
+    trainer.run(clusters, [this](const MiniBatchReport& report) {
+        miniBatchReports.push_back(report);
+        });
+
+    if (trainer.hasConverged()) {
+        stopReason = StopReason::Converged;
+    }
+    else {
+        const bool limitReached = options.maxBatches > 0 && trainer.getBatchCount() >= options.maxBatches;
+        stopReason = limitReached ? StopReason::MaxIterations : StopReason::TimeBudget;
+    }
+
+    // Label every sample with its nearest trained center; the centers themselves are kept
+    assignSamplesToClusters();
+    summarizeTraining(samples.size(), trainer.getBatchCount(), engine->computeInertia(), engine->getCounts());
 }
 
 /**
- * @brief Getter function to access the sample vector.
+ * @brief This function runs K-means on a binary dataset file without loading it: the initial centers
+ *        are chosen among the samples of the first chunk, then every iteration streams the whole file.
+ *        The samples stay empty; the labels go to the label file of the options, if any.
  *
- * @return const vector<Sample>& A reference to the vector of samples.
+ * @param fileName The name of the binary dataset file.
  */
-const vector<Sample>& KMeans::getSamples(void) const {
+void KMeans::updateKMOutOfCore(const string& fileName) {
+    iterationStatistics.clear();
+    model.reset();
+    StreamingTrainer trainer(fileName, pool, options);
+    clusters = trainer.initialize(static_cast<size_t>(K));
+    trainer.run(clusters);
+    stopReason = trainer.getStopReason();
+    summarizeTraining(trainer.getSampleCount(), trainer.getPassCount(), trainer.getInertia(), trainer.getCounts());
+
+    const size_t distanceCount = trainer.getSampleCount() * clusters.size();
+    iterationStatistics.assign(trainer.getPassCount(), IterationStatistics{ distanceCount, 0 });
+}
+
+/**
+ * @brief Getter function to access the samples.
+ *
+ * @return const Dataset& A reference to the dataset holding the samples.
+ */
+const Dataset& KMeans::getSamples(void) const {
     return samples;
 }
 
@@ -199,50 +449,84 @@ const vector<Cluster>& KMeans::getClusters(void) const {
 }
 
 /**
- * @brief This function prints the information of each sample, its index, coordinates (x, y) and the cluster ID it belongs to.
+ * @brief Getter function to access the work done by the assignment step in each iteration.
  *
- * @param samples The vector of Sample objects to print.
+ * @return const vector<IterationStatistics>& One entry per iteration of updateKM().
  */
-void KMeans::printResults(const vector<Sample>& samples) {
-    cout << "K-Means Results:" << endl;
-    cout << "---------------------------------------------------------------" << endl;
-
-    // Print each sample's information using the overloaded << operator
-    for_each(samples.begin(), samples.end(), [](const auto& sample) {
-        cout << sample;
-        });
+const vector<IterationStatistics>& KMeans::getIterationStatistics(void) const {
+    return iterationStatistics;
+}
 
-    cout << "\nK-Means clustering result calculated successfully!" << endl;
+/**
+ * @brief Getter function to access the progress reports of mini-batch training.
+ *
+ * @return const vector<MiniBatchReport>& One entry every reportInterval batches.
+ */
+const vector<MiniBatchReport>& KMeans::getMiniBatchReports(void) const {
+    return miniBatchReports;
 }
 
 /**
- * @brief This function writes the results, including the instances index, coordinates,
- *        and assigned cluster ID, to an output file.
+ * @brief Getter function to access why training stopped.
  *
- * @param filePath The path of the file where results will be saved.
+ * @return StopReason The first stopping criterion of the options that was met.
  */
-void KMeans::saveResultsToFile(const string& filePath) const {
-    ofstream outFile(filePath);  ///< Open the file to write the results
+StopReason KMeans::getStopReason(void) const {
+    return stopReason;
+}
 
-    if (outFile.is_open()) {
-        // Write headers for the output file
-        outFile << "----------------------------------------------\n";
-        outFile << "|  Index   |  X     |   Y    | Cluster ID |\n";  ///< Column headers
-        outFile << "----------------------------------------------\n";
+/**
+ * @brief Getter function to access how the last fit went.
+ *
+ * @return const TrainingSummary& The summary.
+ */
+const TrainingSummary& KMeans::getTrainingSummary(void) const {
+    return summary;
+}
 
-        // Write each sample's data (Index, X, Y, Cluster ID)
-        for (const auto& sample : samples) {
-            outFile << "| "
-                << setw(8) << sample.getIndex() << " | "  ///< Index
-                << setw(6) << fixed << setprecision(2) << sample.getX() << " | "  ///< X coordinate
-                << setw(6) << fixed << setprecision(2) << sample.getY() << " | "  ///< Y coordinate
-                << setw(10) << sample.getClusterID() << " |\n";  ///< Cluster ID
-        }
+/**
+ * @brief This function prints the information of each sample, its index, coordinates (x, y) and the cluster ID
+ *        it belongs to, followed by the progress of mini-batch training and why training stopped.
+ *        The samples are formatted in parallel chunks and skipped when the printSamples option is off.
+ *
+ * @param output The stream to print to.
+ */
+void KMeans::printResults(ostream& output) {
+    output << "K-Means Results:" << endl;
+    output << "---------------------------------------------------------------" << endl;
 
-        outFile << "----------------------------------------------\n";  ///< Footer line
-        outFile.close();  ///< Close the file after writing
+    // Print each sample's information in the format of the overloaded << operator of Sample
+    if (options.printSamples) {
+        ResultWriter(samples, pool).write(output, ResultFormat::Listing);
     }
-    else {
-        cerr << "Unable to open file: " << filePath << endl;  ///< Print error if file cannot be opened
+
+    output << "\nK-Means clustering result calculated successfully!" << endl;
+    for (const MiniBatchReport& report : miniBatchReports) {
+        output << "Batch " << report.batch << ": inertia " << report.inertia
+            << " (" << report.seconds << " s)" << endl;
     }
+    output << "Stopped because " << describeStopReason(stopReason) << "." << endl;
+}
+
+/**
+ * @brief This function writes the results to a file.
+ *
+ * @param fileName The path of the file where results will be saved.
+ * @param format The format of the file.
+ * @throws runtime_error If the file cannot be opened or written.
+ */
+void KMeans::save(const string& fileName, ResultFormat format) {
+    ResultWriter(samples, pool).write(fileName, format);
+}
+
+/**
+ * @brief This function writes the results, including the instances index, coordinates,
+ *        and assigned cluster ID, to a stream. 2D data keeps the original X / Y columns
+ *        of the result table; other dimensions get one column per coordinate (X1, X2, ...).
+ *
+ * @param output The stream where results will be written.
+ * @param format The format of the output.
+ */
+void KMeans::save(ostream& output, ResultFormat format) {
+    ResultWriter(samples, pool).write(output, format);
 }
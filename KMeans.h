@@ -2,66 +2,172 @@
 #define KMEANS_H
 
 #include <iostream>
+#include "AssignmentEngine.h"
 #include "Cluster.h"
+#include "Dataset.h"
+#include "KMeansModel.h"
+#include "KMeansOptions.h"
+#include "MiniBatchTrainer.h"
+#include "ResultWriter.h"
+#include "ThreadPool.h"
 #include <fstream>
 #include <cmath>
 #include <limits>
+#include <optional>
 #include <stdexcept>
 
 using namespace std;
 
+/**
+ * @struct IterationStatistics
+ * @brief The work done by the assignment step in one iteration of the K-means algorithm.
+ */
+struct IterationStatistics
+{
+    /** The number of sample-to-center distances computed. */
+    size_t distanceCount;
+
+    /** The number of sample-to-center distances skipped compared with the brute-force loop. */
+    size_t skippedDistanceCount;
+};
+
 /**
  * @class KMeans
  * @brief Represents the K-means clustering algorithm.
  *        The class performs clustering of data points into K clusters based on the K-means algorithm.
+ *
+ *        Creating the object does no work: fit() trains the clusters on a file or on samples in memory,
+ *        predict() labels new points with the trained centers, and save() and printResults() write the
+ *        labelled samples. Nothing is printed unless asked for, so the object can live in a service.
  */
 class KMeans
 {
 public:
 
     /**
-     * @brief Constructor that initializes the KMeans object with the provided file name and number of clusters (K).
+     * @brief Constructor that sets the number of clusters (K) and the tuning parameters.
+     *        It starts the worker threads but neither reads nor trains anything.
      *
-     * @param fileName The name of the input file containing the sample data.
      * @param k The number of clusters (K) to form.
-     * @param OutputfileName The name of the output file to save the results.
+     * @param options Tuning parameters such as the number of threads and the assignment algorithm.
+     * @throws invalid_argument If K is not positive.
+     */
+    explicit KMeans(int k, const KMeansOptions& options = KMeansOptions());
+
+    /**
+     * @brief Trains the clusters on the samples of a file: the text format, one sample per line, or
+     *        the binary format (see BinaryDataset). In the out-of-core mode the file is streamed instead.
+     *
+     * @param fileName The name of the input file containing the sample data.
+     * @throws runtime_error If the file cannot be read or holds fewer samples than clusters.
      */
-    KMeans(const string& fileName, int k, const string& OutputfileName);
+    void fit(const string& fileName);
 
     /**
-     * @brief Getter method to return the input file name.
+     * @brief Trains the clusters on a dataset. The samples are copied (a view stays a view of the same arrays).
      *
-     * @return The name of the input file containing the sample data.
+     * @param data The samples.
+     * @throws runtime_error If there are fewer samples than clusters.
      */
-    string getFileName() const;
+    void fit(const Dataset& data);
 
     /**
-     * @brief Setter method to set the input file name.
+     * @brief Trains the clusters on points stored one after the other (row-major). The samples get the
+     *        indices 1 to sampleCount.
      *
-     * @param fileName The name of the input file.
+     * @param points The sampleCount x dimension coordinates.
+     * @param sampleCount The number of points.
+     * @param dimension The number of coordinates of every point.
+     * @throws invalid_argument If the dimension is 0.
+     * @throws runtime_error If there are fewer samples than clusters.
      */
-    void setFileName(const string& fileName);
+    void fit(const double* points, size_t sampleCount, size_t dimension);
 
     /**
-     * @brief Getter method to return the output file name.
+     * @brief Returns the frozen copy of the trained centers, built once at the end of the last fit, that
+     *        labels new points without this object. It also holds the cluster sizes and the training
+     *        summary, which KMeansModel::save() writes to a model file.
      *
-     * @return The name of the output file where results are saved.
+     * @return The model, using the instruction set of the options. Copy it to keep it past the next fit.
+     * @throws runtime_error If the model has not been fitted.
      */
-    string getOutputFileName() const;
+    const KMeansModel& getModel(void) const;
 
     /**
-     * @brief Setter method to set the output file name.
+     * @brief Returns the ID of the nearest trained cluster center of each point. Ties go to the lower ID.
      *
-     * @param OutputfileName The name of the output file.
+     * @param points The count x D coordinates, row-major, where D is the dimension of the trained centers.
+     * @param count The number of points.
+     * @return The cluster ID of every point.
+     * @throws runtime_error If the model has not been fitted.
      */
-    void setOutputFileName(const string& OutputfileName);
+    vector<int> predict(const double* points, size_t count);
 
     /**
-     * @brief Getter method to access the vector of samples.
+     * @brief Labels a batch of points with the nearest trained cluster center, on the worker threads
+     *        when the batch is large (see KMeansModel::predict()).
      *
-     * @return A reference to the vector of Sample objects.
+     * @param points The count x D coordinates, row-major, where D is the dimension of the trained centers.
+     * @param count The number of points.
+     * @param labels Receives the cluster ID of every point.
+     * @param distances Receives the Euclidean distance of every point to its center; may be null.
+     * @throws runtime_error If the model has not been fitted.
      */
-    const vector<Sample>& getSamples(void) const;
+    void predict(const double* points, size_t count, int* labels, double* distances);
+
+    /**
+     * @brief Writes the labelled samples to a file, formatted on the worker threads (see ResultWriter).
+     *
+     * @param fileName The path of the output file.
+     * @param format The result table (the default), a CSV file or the binary labels.
+     * @throws runtime_error If the file cannot be written.
+     */
+    void save(const string& fileName, ResultFormat format = ResultFormat::Table);
+
+    /**
+     * @brief Writes the labelled samples to a stream, formatted on the worker threads. The result table
+     *        has a header, then one line per sample with its index, its coordinates and its cluster ID.
+     *
+     * @param output The stream to write to, opened in binary mode for the binary labels.
+     * @param format The result table (the default), a CSV file or the binary labels.
+     */
+    void save(ostream& output, ResultFormat format = ResultFormat::Table);
+
+    /**
+     * @brief Prints every labelled sample, unless the printSamples option is off, then the progress
+     *        reports of mini-batch training and why training stopped.
+     *
+     * @param output The stream to print to.
+     */
+    void printResults(ostream& output);
+
+    /**
+     * @brief Getter method to return the number of threads used by the parallel steps.
+     *
+     * @return The number of threads, including the calling thread.
+     */
+    unsigned int getThreadCount() const;
+
+    /**
+     * @brief Getter method to return the algorithm used to assign the samples to the clusters.
+     *
+     * @return The assignment algorithm.
+     */
+    Algorithm getAlgorithm() const;
+
+    /**
+     * @brief Getter method to return the instruction set the distance kernel uses on this processor.
+     *
+     * @return The instruction set.
+     */
+    InstructionSet getInstructionSet() const;
+
+    /**
+     * @brief Getter method to access the samples.
+     *
+     * @return A reference to the dataset holding the samples, empty in the out-of-core mode.
+     */
+    const Dataset& getSamples(void) const;
 
     /**
      * @brief Getter method to access the vector of clusters.
@@ -71,62 +177,135 @@ public:
     const vector<Cluster>& getClusters(void) const;
 
     /**
-     * @brief Loads sample data from the specified file.
+     * @brief Getter method to access the work done by the assignment step in each iteration.
+     *
+     * @return A reference to the statistics, one entry per iteration of updateKM().
+     */
+    const vector<IterationStatistics>& getIterationStatistics(void) const;
+
+    /**
+     * @brief Getter method to access the progress reports of mini-batch training.
+     *
+     * @return A reference to the reports, one every reportInterval batches of trainMiniBatch().
+     */
+    const vector<MiniBatchReport>& getMiniBatchReports(void) const;
+
+    /**
+     * @brief Getter method to access why training stopped.
+     *
+     * @return The first stopping criterion of the options that was met.
+     */
+    StopReason getStopReason(void) const;
+
+    /**
+     * @brief Getter method to access how the last fit went: the sample count, the number of
+     *        iterations, the final inertia and the options it used.
+     *
+     * @return A reference to the summary.
+     */
+    const TrainingSummary& getTrainingSummary(void) const;
+
+    /**
+     * @brief Loads sample data from the specified file: one sample per line, its index followed by
+     *        its coordinates. The number of coordinates (the dimension) is taken from the first line.
+     *        Binary dataset files (see BinaryDataset) are recognized by their magic and memory-mapped.
      *
      * @param fileName The name of the file containing sample data.
      */
     void loadSamples(const string& fileName);
 
     /**
-     * @brief Initializes clusters using the first K samples as initial cluster centers.
+     * @brief Trains the clusters on the loaded samples: chooses the initial centers and runs
+     *        the full-batch or mini-batch algorithm selected in the options.
+     */
+    void train(void);
+
+    /**
+     * @brief Initializes clusters using K samples as initial cluster centers: the first K samples,
+     *        or the ones chosen by k-means++ or k-means||, depending on the options.
      */
     void initialize(void);
 
     /**
-     * @brief Assigns each sample to the nearest cluster based on Euclidean distance.
+     * @brief Assigns each sample to the nearest cluster based on Euclidean distance,
+     *        using the assignment engine selected in the options.
      */
     void assignSamplesToClusters(void);
 
     /**
-     * @brief Runs the K-means algorithm: assigns samples to clusters and updates centers until convergence.
+     * @brief Runs the K-means algorithm: assigns samples to clusters and updates centers until the centers
+     *        converge or another stopping criterion of the options is met.
      */
     void updateKM(void);
 
     /**
-     * @brief Saves the clustering results to the specified output file.
+     * @brief Sets the center of every cluster from the per-cluster sums and counts of the engine.
      *
-     * @param filePath The path of the output file to save the results.
+     * @param largestShift Receives the largest distance a center moved.
+     * @return true If any cluster center changed.
      */
-    void saveResultsToFile(const string& filePath) const;
+    bool updateCenters(double& largestShift);
 
     /**
-     * @brief Prints the clustering results to the console.
+     * @brief Runs mini-batch K-means instead of updateKM(): trains the centers on random batches of
+     *        batchSize samples, then assigns every sample to the nearest trained center.
+     */
+    void trainMiniBatch(void);
+
+    /**
+     * @brief Runs K-means on a binary dataset file larger than the memory, streaming it in chunks of
+     *        chunkSize samples (see StreamingTrainer). The samples are not kept; the cluster ID of every
+     *        sample is written to the label file of the options when it names one.
      *
-     * @param samples The vector of Sample objects to print.
+     * @param fileName The name of the binary dataset file.
      */
-    void printResults(const vector<Sample>& samples);
+    void updateKMOutOfCore(const string& fileName);
 
     /**
-     * @brief Destructor that cleans up any resources when the KMeans object is destroyed.
+     * @brief Records the outcome of a fit: the training summary, and the frozen model built from the
+     *        trained centers, the cluster sizes and the summary.
+     *
+     * @param sampleCount The number of training samples.
+     * @param iterationCount The number of iterations, batches or passes run.
+     * @param inertia The sum of the squared distances of the samples to their centers.
+     * @param counts The number of samples of every cluster.
      */
-    ~KMeans();
+    void summarizeTraining(size_t sampleCount, size_t iterationCount, double inertia, const vector<size_t>& counts);
 
 private:
 
     /** The number of clusters (K) for the K-means algorithm. */
     int K;
 
-    /** A vector that holds all the samples. */
-    vector<Sample> samples;
+    /** The dataset that holds all the samples. */
+    Dataset samples;
 
     /** A vector that holds the clusters. */
     vector<Cluster> clusters;
 
-    /** The input file name from which the sample data is loaded. */
-    string fileName;
+    /** The tuning parameters the algorithm was created with. */
+    KMeansOptions options;
+
+    /** The worker threads used by the parallel steps. */
+    ThreadPool pool;
+
+    /** The engine that assigns the samples to the clusters. */
+    unique_ptr<AssignmentEngine> engine;
+
+    /** The work done by the assignment step in each iteration. */
+    vector<IterationStatistics> iterationStatistics;
+
+    /** The progress reports of mini-batch training. */
+    vector<MiniBatchReport> miniBatchReports;
+
+    /** Why training stopped. */
+    StopReason stopReason;
+
+    /** How the last fit went. */
+    TrainingSummary summary;
 
-    /** The output file name where results are saved. */
-    string outputfileName;
+    /** The frozen model of the last fit, used by getModel() and predict(); empty before the first fit. */
+    optional<KMeansModel> model;
 };
 
 #endif
@@ -0,0 +1,396 @@
+/****************************************************************************
+ * @file KMeansModel.cpp
+ * @brief Implementation of the KMeansModel class: the copy of the trained
+ *        centers, the batched nearest-center labelling of row-major points,
+ *        a transposed chunk at a time, and the memory-mapped model files.
+ ****************************************************************************/
+
+#include "KMeansModel.h"
+#include "BlockPartition.h"
+#include "ByteOrder.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+
+/** The magic that starts every model file. */
+static const char MAGIC[8] = { 'K', 'M', 'E', 'A', 'N', 'S', 'M', 'D' };
+
+/** The byte order mark as written by a machine of the same byte order. */
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+/** The alignment of the offsets. */
+static const uint64_t ALIGNMENT = 64;
+
+static_assert(sizeof(ModelFileHeader) == 128, "The header must be 128 bytes long");
+
+/**
+ * @brief Rounds a size up to the alignment of the format.
+ *
+ * @param size The size in bytes.
+ * @return uint64_t The smallest multiple of ALIGNMENT not below size.
+ */
+static uint64_t alignUp(uint64_t size)
+{
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+/**
+ * @brief Constructor that copies the centers of trained clusters.
+ *
+ * @param clusters The clusters, in ID order.
+ * @param instructionSet The instruction set of the nearest-center search.
+ * @throws invalid_argument If there is no cluster or the centers have different dimensions.
+ */
+KMeansModel::KMeansModel(const vector<Cluster>& clusters, InstructionSet instructionSet)
+    : KMeansModel(clusters, vector<size_t>(), TrainingSummary(), instructionSet)
+{
+}
+
+/**
+ * @brief Constructor that copies the centers of trained clusters, their sizes and the training summary.
+ *
+ * @param clusters The clusters, in ID order.
+ * @param counts The number of training samples of every cluster.
+ * @param summary How the clusters were trained.
+ * @param instructionSet The instruction set of the nearest-center search.
+ * @throws invalid_argument If there is no cluster, the centers have different dimensions or
+ *         there is not one count per cluster.
+ */
+KMeansModel::KMeansModel(const vector<Cluster>& clusters, const vector<size_t>& counts, const TrainingSummary& summary,
+    InstructionSet instructionSet)
+    : KMeansModel(nullptr, nullptr, clusters.size(), clusters.empty() ? 0 : clusters[0].getDimension(), counts,
+        summary, instructionSet)
+{
+    shared_ptr<vector<double>> owned = copyCenters(clusters);
+    centers = owned->data();
+    centerOwner = move(owned);
+}
+
+/**
+ * @brief Constructor that copies centers stored one after the other.
+ *
+ * @param centers The clusterCount x dimension coordinates of the centers.
+ * @param clusterCount The number of centers.
+ * @param dimension The number of coordinates of every center.
+ * @param instructionSet The instruction set of the nearest-center search.
+ * @throws invalid_argument If there is no center or the dimension is 0.
+ */
+KMeansModel::KMeansModel(const double* centers, size_t clusterCount, size_t dimension, InstructionSet instructionSet)
+    : KMeansModel(nullptr, nullptr, clusterCount, dimension, vector<size_t>(), TrainingSummary(), instructionSet)
+{
+    auto owned = make_shared<vector<double>>(centers, centers + clusterCount * dimension);
+    this->centers = owned->data();
+    centerOwner = move(owned);
+}
+
+/**
+ * @brief Constructor that checks the shape of the model and takes over centers kept alive by an owner.
+ *        The copying constructors pass no centers and set them afterwards.
+ *
+ * @param centers The clusterCount x dimension coordinates of the centers.
+ * @param owner The object that keeps the centers alive.
+ * @param clusterCount The number of centers.
+ * @param dimension The number of coordinates of every center.
+ * @param counts The number of training samples of every cluster; empty gives zeros.
+ * @param summary How the clusters were trained.
+ * @param instructionSet The instruction set of the nearest-center search.
+ * @throws invalid_argument If there is no center, the dimension is 0 or there is not one count per cluster.
+ */
+KMeansModel::KMeansModel(const double* centers, shared_ptr<const void> owner, size_t clusterCount, size_t dimension,
+    const vector<size_t>& counts, const TrainingSummary& summary, InstructionSet instructionSet)
+    : clusterCount(clusterCount), dimension(dimension), centers(centers), centerOwner(move(owner)),
+    counts(counts.empty() ? vector<size_t>(clusterCount, 0) : counts), summary(summary), kernel(instructionSet)
+{
+    if (clusterCount == 0 || dimension == 0) {
+        throw invalid_argument("A model needs at least one cluster center.");
+    }
+    if (this->counts.size() != clusterCount) {
+        throw invalid_argument("A model needs one sample count per cluster.");
+    }
+}
+
+/**
+ * @brief Copies the centers of clusters one after the other.
+ *
+ * @param clusters The clusters, in ID order; there is at least one.
+ * @return shared_ptr<vector<double>> The owned centers.
+ * @throws invalid_argument If the centers have different dimensions.
+ */
+shared_ptr<vector<double>> KMeansModel::copyCenters(const vector<Cluster>& clusters)
+{
+    const size_t D = clusters[0].getDimension();
+    auto centers = make_shared<vector<double>>();
+    centers->reserve(clusters.size() * D);
+    for (const Cluster& cluster : clusters) {
+        if (cluster.getDimension() != D) {
+            throw invalid_argument("The cluster centers have different dimensions.");
+        }
+        centers->insert(centers->end(), cluster.getCenter().begin(), cluster.getCenter().end());
+    }
+    return centers;
+}
+
+/**
+ * @brief Returns the number of clusters.
+ *
+ * @return size_t The number of centers.
+ */
+size_t KMeansModel::getClusterCount() const
+{
+    return clusterCount;
+}
+
+/**
+ * @brief Returns the number of coordinates of the centers.
+ *
+ * @return size_t The dimension.
+ */
+size_t KMeansModel::getDimension() const
+{
+    return dimension;
+}
+
+/**
+ * @brief Returns the centers.
+ *
+ * @return const double* The centers, row-major.
+ */
+const double* KMeansModel::getCenters() const
+{
+    return centers;
+}
+
+/**
+ * @brief Returns the number of training samples of every cluster.
+ *
+ * @return const vector<size_t>& The counts, in cluster ID order.
+ */
+const vector<size_t>& KMeansModel::getCounts() const
+{
+    return counts;
+}
+
+/**
+ * @brief Returns how the model was trained.
+ *
+ * @return const TrainingSummary& The summary.
+ */
+const TrainingSummary& KMeansModel::getSummary() const
+{
+    return summary;
+}
+
+/**
+ * @brief Returns the instruction set the nearest-center search uses.
+ *
+ * @return InstructionSet The instruction set.
+ */
+InstructionSet KMeansModel::getInstructionSet() const
+{
+    return kernel.getInstructionSet();
+}
+
+/**
+ * @brief Labels a batch of points on the calling thread: every chunk of points is transposed into
+ *        columns, the layout the distance kernel reads, and searched in one call.
+ *
+ * @param points The count x D coordinates, row-major.
+ * @param count The number of points.
+ * @param labels Receives the cluster ID of every point.
+ * @param distances Receives the distance to the nearest center; may be null.
+ */
+void KMeansModel::predict(const double* points, size_t count, int* labels, double* distances) const
+{
+    const size_t D = dimension;
+    vector<double> chunkColumns(D * DistanceKernel::CHUNK_SIZE);
+    vector<const double*> columns(D);
+    for (size_t d = 0; d < D; ++d) {
+        columns[d] = &chunkColumns[d * DistanceKernel::CHUNK_SIZE];
+    }
+    size_t nearest[DistanceKernel::CHUNK_SIZE];
+    double nearestDistances[DistanceKernel::CHUNK_SIZE];
+
+    for (size_t chunk = 0; chunk < count; chunk += DistanceKernel::CHUNK_SIZE) {
+        const size_t chunkSize = min(count - chunk, DistanceKernel::CHUNK_SIZE);
+        const double* point = points + chunk * D;
+        for (size_t i = 0; i < chunkSize; ++i, point += D) {
+            for (size_t d = 0; d < D; ++d) {
+                chunkColumns[d * DistanceKernel::CHUNK_SIZE + i] = point[d];
+            }
+        }
+
+        kernel.findNearest(columns.data(), D, 0, chunkSize, centers, clusterCount, nearest, nearestDistances);
+
+        for (size_t i = 0; i < chunkSize; ++i) {
+            labels[chunk + i] = static_cast<int>(nearest[i]) + 1;  ///< Cluster IDs start at 1
+        }
+        if (distances != nullptr) {
+            copy(nearestDistances, nearestDistances + chunkSize, distances + chunk);
+        }
+    }
+}
+
+/**
+ * @brief Labels a batch of points in parallel blocks. A batch of a single block is labelled on the
+ *        calling thread, without waking the pool.
+ *
+ * @param points The count x D coordinates, row-major.
+ * @param count The number of points.
+ * @param labels Receives the cluster ID of every point.
+ * @param distances Receives the distance to the nearest center; may be null.
+ * @param pool The thread pool that runs the blocks.
+ */
+void KMeansModel::predict(const double* points, size_t count, int* labels, double* distances, ThreadPool& pool) const
+{
+    const BlockPartition blocks(count);
+    if (blocks.getBlockCount() == 1) {
+        predict(points, count, labels, distances);
+        return;
+    }
+
+    pool.parallelFor(blocks.getBlockCount(), [&](size_t block) {
+        const size_t begin = blocks.getBlockBegin(block);
+        predict(points + begin * dimension, blocks.getBlockEnd(block) - begin, labels + begin,
+            distances == nullptr ? nullptr : distances + begin);
+        });
+}
+
+/**
+ * @brief Writes the model in the binary format: the header, then the centers and the counts,
+ *        each padded to the alignment.
+ *
+ * @param fileName The name of the file.
+ * @throws runtime_error If the file cannot be written.
+ */
+void KMeansModel::save(const string& fileName) const
+{
+    ModelFileHeader header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrderMark = BYTE_ORDER_MARK;
+    header.clusterCount = clusterCount;
+    header.dimension = dimension;
+    header.centerOffset = alignUp(sizeof(header));
+    header.countOffset = header.centerOffset + alignUp(clusterCount * dimension * sizeof(double));
+    header.sampleCount = summary.sampleCount;
+    header.iterationCount = summary.iterationCount;
+    header.inertia = summary.inertia;
+    header.seed = summary.seed;
+    header.algorithm = static_cast<uint32_t>(summary.algorithm);
+    header.initialization = static_cast<uint32_t>(summary.initialization);
+    header.stopReason = static_cast<uint32_t>(summary.stopReason);
+
+    const vector<uint64_t> sizes(counts.begin(), counts.end());
+
+    ofstream file(fileName, ios::binary);
+    if (!file) {
+        throw runtime_error("Cannot write " + fileName);
+    }
+
+    const char padding[ALIGNMENT] = {};
+    auto writePadded = [&](const void* values, uint64_t size) {
+        file.write(static_cast<const char*>(values), static_cast<streamsize>(size));
+        file.write(padding, static_cast<streamsize>(alignUp(size) - size));
+    };
+
+    writePadded(&header, sizeof(header));
+    writePadded(centers, clusterCount * dimension * sizeof(double));
+    writePadded(sizes.data(), clusterCount * sizeof(uint64_t));
+
+    if (!file) {
+        throw runtime_error("Cannot write " + fileName);
+    }
+}
+
+/**
+ * @brief Loads a model file: checks the header of the mapping and points the model at the
+ *        centers inside it, or at a byte-swapped copy for files of the other byte order.
+ *
+ * @param fileName The name of the file.
+ * @param instructionSet The instruction set of the nearest-center search.
+ * @return KMeansModel The model.
+ * @throws runtime_error If the file is not a valid model file.
+ */
+KMeansModel KMeansModel::load(const string& fileName, InstructionSet instructionSet)
+{
+    auto invalid = [&](const string& reason) {
+        return runtime_error("Invalid model file " + fileName + ": " + reason);
+    };
+
+    auto file = make_shared<MappedFile>(fileName);
+    const uint64_t fileSize = file->size();
+
+    ModelFileHeader header;
+    if (fileSize < sizeof(header)) {
+        throw invalid("the file is shorter than the header");
+    }
+    memcpy(&header, file->data(), sizeof(header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw invalid("wrong magic");
+    }
+
+    const bool swapped = header.byteOrderMark == swapBytes(BYTE_ORDER_MARK);
+    if (!swapped && header.byteOrderMark != BYTE_ORDER_MARK) {
+        throw invalid("unknown byte order");
+    }
+    if (swapped) {
+        header.version = swapBytes(header.version);
+        header.clusterCount = swapBytes(header.clusterCount);
+        header.dimension = swapBytes(header.dimension);
+        header.centerOffset = swapBytes(header.centerOffset);
+        header.countOffset = swapBytes(header.countOffset);
+        header.sampleCount = swapBytes(header.sampleCount);
+        header.iterationCount = swapBytes(header.iterationCount);
+        header.inertia = swapBytes(header.inertia);
+        header.seed = swapBytes(header.seed);
+        header.algorithm = swapBytes(header.algorithm);
+        header.initialization = swapBytes(header.initialization);
+        header.stopReason = swapBytes(header.stopReason);
+    }
+
+    if (header.version != VERSION) {
+        throw invalid("unsupported version " + to_string(header.version));
+    }
+
+    // Both regions must be aligned and lie inside the file; the divisions avoid overflows
+    const uint64_t K = header.clusterCount;
+    const uint64_t D = header.dimension;
+    if (K == 0 || D == 0 || header.centerOffset % ALIGNMENT != 0 || header.countOffset % ALIGNMENT != 0
+        || header.centerOffset < sizeof(header) || header.centerOffset > fileSize
+        || K > (fileSize - header.centerOffset) / sizeof(double) / D
+        || header.countOffset < header.centerOffset + K * D * sizeof(double) || header.countOffset > fileSize
+        || K > (fileSize - header.countOffset) / sizeof(uint64_t)) {
+        throw invalid("the layout does not match the size of the file");
+    }
+
+    TrainingSummary summary;
+    summary.sampleCount = header.sampleCount;
+    summary.iterationCount = header.iterationCount;
+    summary.inertia = header.inertia;
+    summary.algorithm = static_cast<Algorithm>(header.algorithm);
+    summary.initialization = static_cast<Initialization>(header.initialization);
+    summary.seed = header.seed;
+    summary.stopReason = static_cast<StopReason>(header.stopReason);
+
+    vector<uint64_t> sizes(K);
+    memcpy(sizes.data(), file->data() + header.countOffset, K * sizeof(uint64_t));
+    if (swapped) {
+        swapArray(sizes.data(), sizes.size());
+    }
+    const vector<size_t> counts(sizes.begin(), sizes.end());
+
+    const double* centers = reinterpret_cast<const double*>(file->data() + header.centerOffset);
+    if (!swapped) {
+        return KMeansModel(centers, move(file), K, D, counts, summary, instructionSet);  ///< Zero copy: the model keeps the mapping alive
+    }
+
+    // The other byte order: copy the centers, reversing the bytes of every value
+    auto owned = make_shared<vector<double>>(centers, centers + K * D);
+    swapArray(owned->data(), owned->size());
+    const double* ownedCenters = owned->data();
+    return KMeansModel(ownedCenters, move(owned), K, D, counts, summary, instructionSet);
+}
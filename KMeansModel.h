@@ -0,0 +1,253 @@
+#ifndef KMEANSMODEL_H
+#define KMEANSMODEL_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Cluster.h"
+#include "DistanceKernel.h"
+#include "KMeansOptions.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+/**
+ * @struct TrainingSummary
+ * @brief How a model was trained, kept with its centers for the model file.
+ *        The inertia and the cluster sizes belong to the saved centers, except in the out-of-core mode,
+ *        where they come from the last pass over the file, made with the centers before their last update.
+ */
+struct TrainingSummary
+{
+    uint64_t sampleCount = 0;                    ///< The number of training samples.
+    uint64_t iterationCount = 0;                 ///< The iterations, batches or passes run.
+    double inertia = 0.0;                        ///< The sum of the squared distances of the samples to their centers.
+    Algorithm algorithm = Algorithm::Lloyd;      ///< The assignment algorithm.
+    Initialization initialization = Initialization::FirstSamples;  ///< How the initial centers were chosen.
+    uint64_t seed = 0;                           ///< The seed of the random initializations.
+    StopReason stopReason = StopReason::Converged;  ///< Why training stopped.
+};
+
+/**
+ * @struct ModelFileHeader
+ * @brief The 128-byte header at the start of a model file.
+ *
+ *        The file layout is:
+ *        - the header;
+ *        - at centerOffset, the clusterCount x dimension coordinates of the centers as doubles, row-major;
+ *        - at countOffset, the number of training samples of every cluster as 64-bit integers.
+ *        Both offsets are multiples of 64, so the centers of a memory-mapped file are used in place.
+ *        All the values are stored in the byte order of the writer, which byteOrderMark tells.
+ */
+struct ModelFileHeader
+{
+    char magic[8];           ///< "KMEANSMD".
+    uint32_t version;        ///< The format version, currently 1.
+    uint32_t byteOrderMark;  ///< 0x01020304 written in the byte order of the file.
+    uint64_t clusterCount;   ///< The number of centers (K).
+    uint64_t dimension;      ///< The number of coordinates of every center (D).
+    uint64_t centerOffset;   ///< The position of the centers.
+    uint64_t countOffset;    ///< The position of the cluster sizes.
+    uint64_t sampleCount;    ///< TrainingSummary::sampleCount.
+    uint64_t iterationCount; ///< TrainingSummary::iterationCount.
+    double inertia;          ///< TrainingSummary::inertia.
+    uint64_t seed;           ///< TrainingSummary::seed.
+    uint32_t algorithm;      ///< TrainingSummary::algorithm.
+    uint32_t initialization; ///< TrainingSummary::initialization.
+    uint32_t stopReason;     ///< TrainingSummary::stopReason.
+    uint32_t reserved[9];    ///< Zero; pads the header to 128 bytes.
+};
+
+/**
+ * @class KMeansModel
+ * @brief The trained cluster centers of a K-means run, frozen for labelling new points.
+ *        A model is a plain copy of the centers: it does not depend on the KMeans object or the
+ *        samples it came from, and predict() never changes it, so several threads may share one.
+ *
+ *        Points are given one after the other (row-major), as they usually arrive from outside.
+ *        predict() transposes them a chunk at a time into a small column buffer and runs the
+ *        vectorized DistanceKernel on it, so the labels are the ones the Lloyd engine would give,
+ *        ties included. Batches larger than one block are split over the thread pool.
+ *
+ *        save() writes the model in the binary format of ModelFileHeader and load() memory-maps it:
+ *        the centers are read in place from the mapping, so loading costs a header check whatever K
+ *        and D are. Copies of a model share its centers, which are never modified.
+ */
+class KMeansModel
+{
+public:
+
+    /**
+     * @brief Constructor that copies the centers of trained clusters.
+     *
+     * @param clusters The clusters. Cluster i must have the ID i + 1.
+     * @param instructionSet The instruction set of the nearest-center search.
+     * @throws invalid_argument If there is no cluster or the centers have different dimensions.
+     */
+    explicit KMeansModel(const vector<Cluster>& clusters, InstructionSet instructionSet = InstructionSet::Automatic);
+
+    /**
+     * @brief Constructor that copies the centers of trained clusters together with their sizes and
+     *        how they were trained.
+     *
+     * @param clusters The clusters. Cluster i must have the ID i + 1.
+     * @param counts The number of training samples of every cluster.
+     * @param summary How the clusters were trained.
+     * @param instructionSet The instruction set of the nearest-center search.
+     * @throws invalid_argument If there is no cluster, the centers have different dimensions or
+     *         there is not one count per cluster.
+     */
+    KMeansModel(const vector<Cluster>& clusters, const vector<size_t>& counts, const TrainingSummary& summary,
+        InstructionSet instructionSet = InstructionSet::Automatic);
+
+    /**
+     * @brief Constructor that copies centers stored one after the other.
+     *
+     * @param centers The clusterCount x dimension coordinates of the centers, row-major.
+     * @param clusterCount The number of centers; center i gets the cluster ID i + 1.
+     * @param dimension The number of coordinates of every center.
+     * @param instructionSet The instruction set of the nearest-center search.
+     * @throws invalid_argument If there is no center or the dimension is 0.
+     */
+    KMeansModel(const double* centers, size_t clusterCount, size_t dimension,
+        InstructionSet instructionSet = InstructionSet::Automatic);
+
+    /**
+     * @brief Returns the number of clusters.
+     *
+     * @return The number of centers.
+     */
+    size_t getClusterCount() const;
+
+    /**
+     * @brief Returns the number of coordinates of the centers and of the points to label.
+     *
+     * @return The dimension.
+     */
+    size_t getDimension() const;
+
+    /**
+     * @brief Returns the centers.
+     *
+     * @return The clusterCount x D coordinates of the centers, row-major: the coordinates of
+     *         cluster ID c start at index (c - 1) * D.
+     */
+    const double* getCenters() const;
+
+    /**
+     * @brief Returns the number of training samples of every cluster.
+     *
+     * @return The counts in cluster ID order; all 0 when the model was built from centers alone.
+     */
+    const vector<size_t>& getCounts() const;
+
+    /**
+     * @brief Returns how the model was trained.
+     *
+     * @return The summary; default values when the model was built from centers alone.
+     */
+    const TrainingSummary& getSummary() const;
+
+    /**
+     * @brief Returns the instruction set the nearest-center search uses.
+     *
+     * @return The instruction set.
+     */
+    InstructionSet getInstructionSet() const;
+
+    /**
+     * @brief Labels a batch of points on the calling thread.
+     *
+     * @param points The count x D coordinates, row-major.
+     * @param count The number of points.
+     * @param labels Receives the cluster ID of the nearest center of every point.
+     * @param distances Receives the Euclidean distance to that center; may be null.
+     */
+    void predict(const double* points, size_t count, int* labels, double* distances) const;
+
+    /**
+     * @brief Labels a batch of points, in parallel blocks on a thread pool when the batch is
+     *        large enough. The results do not depend on the thread count.
+     *
+     * @param points The count x D coordinates, row-major.
+     * @param count The number of points.
+     * @param labels Receives the cluster ID of the nearest center of every point.
+     * @param distances Receives the Euclidean distance to that center; may be null.
+     * @param pool The thread pool that runs the blocks.
+     */
+    void predict(const double* points, size_t count, int* labels, double* distances, ThreadPool& pool) const;
+
+    /**
+     * @brief Writes the model in the binary format of ModelFileHeader, in the byte order of this machine.
+     *
+     * @param fileName The name of the file.
+     * @throws runtime_error If the file cannot be written.
+     */
+    void save(const string& fileName) const;
+
+    /**
+     * @brief Loads a model file by memory-mapping it; the centers stay in the mapping, which the model
+     *        and its copies keep alive. Files written with the other byte order are converted into a copy.
+     *
+     * @param fileName The name of the file.
+     * @param instructionSet The instruction set of the nearest-center search.
+     * @return The model.
+     * @throws runtime_error If the file cannot be mapped, is not a model file, has an unsupported
+     *         version or is shorter than its header says.
+     */
+    static KMeansModel load(const string& fileName, InstructionSet instructionSet = InstructionSet::Automatic);
+
+    /** The current format version of the model files. */
+    static const uint32_t VERSION = 1;
+
+private:
+
+    /**
+     * @brief Constructor used by the other constructors and load(): checks the shape of the model and
+     *        takes over centers kept alive by an owner.
+     *
+     * @param centers The clusterCount x dimension coordinates of the centers, row-major.
+     * @param owner The object that keeps the centers alive: an owned array or a memory-mapped file.
+     * @param clusterCount The number of centers.
+     * @param dimension The number of coordinates of every center.
+     * @param counts The number of training samples of every cluster; empty gives zeros.
+     * @param summary How the clusters were trained.
+     * @param instructionSet The instruction set of the nearest-center search.
+     * @throws invalid_argument If there is no center, the dimension is 0 or there is not one count per cluster.
+     */
+    KMeansModel(const double* centers, shared_ptr<const void> owner, size_t clusterCount, size_t dimension,
+        const vector<size_t>& counts, const TrainingSummary& summary, InstructionSet instructionSet);
+
+    /**
+     * @brief Copies the centers of clusters one after the other.
+     *
+     * @param clusters The clusters; there is at least one.
+     * @return The owned centers, row-major.
+     * @throws invalid_argument If the centers have different dimensions.
+     */
+    static shared_ptr<vector<double>> copyCenters(const vector<Cluster>& clusters);
+
+    /** The number of centers. */
+    size_t clusterCount;
+
+    /** The number of coordinates of every center. */
+    size_t dimension;
+
+    /** The centers, row-major (clusterCount x dimension), owned by centerOwner. */
+    const double* centers;
+
+    /** Keeps the centers alive: an owned array or the memory-mapped model file, shared by the copies of the model. */
+    shared_ptr<const void> centerOwner;
+
+    /** The number of training samples of every cluster. */
+    vector<size_t> counts;
+
+    /** How the model was trained. */
+    TrainingSummary summary;
+
+    /** The nearest-center search. */
+    DistanceKernel kernel;
+};
+
+#endif
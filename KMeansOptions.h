@@ -0,0 +1,166 @@
+#ifndef KMEANSOPTIONS_H
+#define KMEANSOPTIONS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @enum Algorithm
+ * @brief The strategies available for the step that assigns every sample to its nearest cluster.
+ *        All of them give the same labels; they differ only in how many distances they compute.
+ */
+enum class Algorithm
+{
+    Lloyd,  ///< Brute force: every sample is compared with every center, one distance at a time.
+    Elkan,  ///< Triangle inequality with one lower bound per sample and center (Elkan, 2003).
+    Hamerly,///< Triangle inequality with a single lower bound per sample (Hamerly, 2010), best for small K.
+    Yinyang,///< One lower bound per group of about ten centers (Ding et al., 2015), best for large K.
+    KdTree, ///< Filtering of the centers down a kd-tree of the samples (Kanungo et al., 2002), best for low D.
+    Grid,   ///< Candidate centers per cell of a uniform grid over the samples, 2D only (Lloyd otherwise), best for large K.
+    Gemm,   ///< Brute force with ||x||^2 - 2 x.c + ||c||^2 and a blocked matrix product from 16 centers; faster than Lloyd with AVX-512 only.
+    Automatic  ///< Lloyd, or Gemm where it was measured faster: with AVX-512, from 32 dimensions and 4096 for D x K.
+};
+
+/**
+ * @enum InstructionSet
+ * @brief The instruction sets the distance kernel can use. A set the processor does not support
+ *        is replaced by the best one it supports, so every value is safe to request.
+ */
+enum class InstructionSet
+{
+    Automatic,  ///< The best set supported by the processor and the operating system.
+    Scalar,     ///< Portable C++, one sample at a time.
+    AVX2,       ///< 256-bit vectors (AVX2 with FMA and F16C), 4 samples per register.
+    AVX512      ///< 512-bit vectors (AVX-512F), 8 samples per register.
+};
+
+/**
+ * @enum Precision
+ * @brief The floating-point type of the coordinates and distances of the nearest-center search.
+ */
+enum class Precision
+{
+    Double,   ///< 64-bit coordinates and distances, exactly like every other engine.
+    Single,   ///< 32-bit coordinates, searched against float centers, twice as many samples per vector; the sums stay in double.
+    Half,     ///< 16-bit IEEE half coordinates (about 3 digits, up to 65504), widened to 32 bits in the kernel.
+    BFloat16  ///< 16-bit bfloat16 coordinates (about 2 digits, full float range), widened to 32 bits in the kernel.
+};
+
+/**
+ * @enum Initialization
+ * @brief The ways of choosing the initial cluster centers.
+ */
+enum class Initialization
+{
+    FirstSamples,   ///< The first K samples of the file, as in the original program.
+    KMeansPlusPlus, ///< k-means++ (Arthur and Vassilvitskii, 2007): D^2 sampling from a seeded generator.
+    KMeansParallel  ///< k-means|| (Bahmani et al., 2012): a few oversampling rounds, then weighted k-means++ on the candidates.
+};
+
+/**
+ * @enum StopReason
+ * @brief Why training stopped: the first stopping criterion of the options that was met.
+ */
+enum class StopReason
+{
+    Converged,        ///< No center moved farther than the shift tolerance (or the drift tolerance of mini-batch mode).
+    MaxIterations,    ///< maxIterations iterations, or maxBatches batches, were run.
+    InertiaTolerance, ///< The inertia improved by less than inertiaTolerance of its previous value.
+    LabelChanges,     ///< Fewer than labelChangeTolerance of the samples changed cluster.
+    TimeBudget        ///< The time budget was spent.
+};
+
+/**
+ * @struct KMeansOptions
+ * @brief Tuning parameters of the K-means algorithm.
+ *        Every field has a default, so a default constructed KMeansOptions gives the standard behaviour.
+ */
+struct KMeansOptions
+{
+    /** The number of threads used by the parallel steps. 0 selects the hardware concurrency. */
+    unsigned int threadCount = 0;
+
+    /** The strategy used to assign the samples to the clusters. */
+    Algorithm algorithm = Algorithm::Automatic;
+
+    /** The instruction set of the nearest-center search of the Lloyd engine. */
+    InstructionSet instructionSet = InstructionSet::Automatic;
+
+    /**
+     * The type the samples are stored in and the precision of the nearest-center search of the Lloyd
+     * engine. The coordinates are rounded as they are loaded and no double copy is kept: Single needs
+     * half the memory and bandwidth of Double, Half and BFloat16 a quarter. The centers are still
+     * computed in double from the stored coordinates; samples almost equally close to two centers
+     * may get the other one than in double precision. Automatic then always selects Lloyd. The other
+     * algorithms, mini-batch and out-of-core training only run in double precision and throw
+     * invalid_argument for the others.
+     */
+    Precision precision = Precision::Double;
+
+    /** How the initial cluster centers are chosen. */
+    Initialization initialization = Initialization::FirstSamples;
+
+    /** The seed of the random initializations. The same seed and data give the same centers for every thread count. */
+    uint64_t seed = 0;
+
+    /** k-means||: the expected number of candidates drawn per round, as a multiple of K. */
+    double oversamplingFactor = 2.0;
+
+    /** k-means||: the number of oversampling rounds. */
+    unsigned int oversamplingRounds = 5;
+
+    /** Full-batch and out-of-core modes: the largest number of iterations. 0 means no limit. */
+    size_t maxIterations = 0;
+
+    /**
+     * Full-batch and out-of-core modes: training stops when no center moves farther than this in an
+     * iteration. 0 keeps iterating until no center changes at all, which may take many iterations of
+     * last-digit changes.
+     */
+    double shiftTolerance = 0.0;
+
+    /** Full-batch mode: training stops when the inertia improves by less than this fraction of its previous value. 0 disables the test. */
+    double inertiaTolerance = 0.0;
+
+    /** Full-batch mode: training stops when fewer than this fraction of the samples change cluster in an iteration. 0 disables the test. */
+    double labelChangeTolerance = 0.0;
+
+    /** Training stops after this many seconds, in every mode. 0 means no limit. */
+    double timeBudget = 0.0;
+
+    /**
+     * The number of iterations between two full recomputations of the per-cluster sums. In between,
+     * the sums are updated from the samples that changed cluster only; the nearest-center search still
+     * covers every sample. 1 recomputes them at every iteration. Above 1, a convergence reached on
+     * incremental sums is checked again with exact sums, whose rounding usually moves the centers by
+     * a few units in the last place: training then runs one more iteration before it converges.
+     */
+    size_t recomputeInterval = 1;
+
+    /** Mini-batch mode: the number of samples drawn per batch. 0 runs the full-batch algorithm instead. */
+    size_t batchSize = 0;
+
+    /**
+     * Mini-batch mode: the largest number of batches. 0 means no limit: the drift tolerance or the time
+     * budget then stops training, and at least one of them must be positive.
+     */
+    size_t maxBatches = 1000;
+
+    /** Mini-batch mode: training stops when no center moves farther than this during a batch. */
+    double driftTolerance = 1e-4;
+
+    /** Mini-batch mode: the inertia is reported every this many batches. 0 disables the reports. */
+    size_t reportInterval = 0;
+
+    /** Out-of-core mode: the number of samples streamed at a time from a binary input file. 0 loads the whole file. */
+    size_t chunkSize = 0;
+
+    /** Out-of-core mode: the file receiving the cluster ID of every sample as 32-bit integers. Empty skips it. */
+    std::string labelFileName;
+
+    /** KMeans::printResults(): whether every labelled sample is printed. false prints the summary lines only. */
+    bool printSamples = true;
+};
+
+#endif
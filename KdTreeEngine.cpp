@@ -0,0 +1,354 @@
+/****************************************************************************
+ * @file KdTreeEngine.cpp
+ * @brief Implementation of the KdTreeEngine class: the construction of the
+ *        kd-tree with its boxes and cached sums, and the filtering of the
+ *        candidate centers from the root down to the leaves.
+ ****************************************************************************/
+
+#include "KdTreeEngine.h"
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+/** The largest number of samples of a leaf. */
+static const size_t LEAF_SIZE = 8;
+
+/**
+ * The relative margin by which a candidate must lose against the best center of a box to be dropped.
+ * The squared distances of a point are computed with a relative error of about D x 1.1e-16, so a gap
+ * of 1e-10 of their sum keeps the order of the computed distances, and of their square roots, intact.
+ */
+static const double PRUNING_MARGIN = 1e-10;
+
+/**
+ * @brief Constructor that binds the engine to the samples and the thread pool.
+ *
+ * @param data The samples to assign.
+ * @param pool The thread pool used to process the blocks.
+ */
+KdTreeEngine::KdTreeEngine(Dataset& data, ThreadPool& pool)
+    : AssignmentEngine(data, pool), assignmentCount(0)
+{
+}
+
+/**
+ * @brief Assigns each sample to the nearest cluster. Block b of the assignment covers the
+ *        positions [getBlockBegin(b), getBlockBegin(b + 1)) of the tree order and is filtered from
+ *        the root with every center as a candidate; only the nodes overlapping the block are visited.
+ *
+ * @param clusters The clusters with their current centers.
+ */
+void KdTreeEngine::assign(const vector<Cluster>& clusters)
+{
+    const size_t K = clusters.size();
+    loadCenters(clusters);
+    resetBlockSums(K);
+
+    if (order.size() != data.size() || lowerCorners.size() != nodes.size() * dimension || nodes.empty()) {
+        buildTree();
+    }
+    ++assignmentCount;
+
+    int* labels = data.getLabels();
+
+    dispatchDimension(dimension, [&](auto dim) {
+        pool.parallelFor(getBlockCount(), [&](size_t block) {
+            auto point = dim.makePoint();
+            FilterState state;
+            state.sums = getBlockSums(block);
+            state.labels = labels;
+            state.point = point.data();
+            state.distanceCount = 0;
+            state.candidates.resize(K);
+            for (size_t j = 0; j < K; ++j) {
+                state.candidates[j] = j;
+            }
+
+            filter(0, 0, getBlockBegin(block), getBlockBegin(block + 1), state, dim);
+            setBlockDistanceCount(block, state.distanceCount);
+            });
+        });
+
+    mergeBlockSums();
+}
+
+/**
+ * @brief Counts the nodes of the subtree of a range of samples: a range larger than a leaf is split
+ *        in two halves.
+ *
+ * @param count The number of samples of the range.
+ * @return size_t The number of nodes.
+ */
+static size_t countNodes(size_t count)
+{
+    if (count <= LEAF_SIZE) {
+        return 1;
+    }
+    return 1 + countNodes(count / 2) + countNodes(count - count / 2);
+}
+
+/**
+ * @brief Builds the tree over every sample, starting from the samples in row order and from the
+ *        bounding box of all the samples as the cell of the root.
+ */
+void KdTreeEngine::buildTree()
+{
+    const size_t N = data.size();
+    const size_t D = dimension;
+    order.resize(N);
+    for (size_t i = 0; i < N; ++i) {
+        order[i] = i;
+    }
+
+    const size_t nodeCount = countNodes(N);
+    nodes.clear();
+    nodes.reserve(nodeCount);
+    lowerCorners.assign(nodeCount * D, 0.0);
+    upperCorners.assign(nodeCount * D, 0.0);
+    nodeSums.assign(nodeCount * D, 0.0);
+    assignmentCount = 0;
+
+    vector<double> cell(2 * D);
+    for (size_t d = 0; d < D; ++d) {
+        const pair<const double*, const double*> range = minmax_element(columns[d], columns[d] + N);
+        cell[d] = N > 0 ? *range.first : 0.0;
+        cell[D + d] = N > 0 ? *range.second : 0.0;
+    }
+    buildNode(0, N, cell);
+}
+
+/**
+ * @brief Builds the subtree of a range of the sample order. An inner node is split at the median of
+ *        the widest side of its cell, the region left to it by the splits of its ancestors, so only
+ *        the leaves scan their samples: the box and the sums of an inner node are made of those of
+ *        its two children.
+ *
+ * @param begin The first position of the range.
+ * @param end One past its last position.
+ * @param cell The lowest then the highest coordinates of the cell of the node; restored on return.
+ * @return size_t The index of the node.
+ */
+size_t KdTreeEngine::buildNode(size_t begin, size_t end, vector<double>& cell)
+{
+    const size_t D = dimension;
+    const size_t node = nodes.size();
+    nodes.push_back({ begin, end, NO_CHILD, NO_CHILD, NO_CHILD, 0 });
+    double* lower = &lowerCorners[node * D];
+    double* upper = &upperCorners[node * D];
+    double* sums = &nodeSums[node * D];
+
+    if (end - begin <= LEAF_SIZE) {
+        for (size_t d = 0; d < D; ++d) {
+            double low = numeric_limits<double>::max();
+            double high = numeric_limits<double>::lowest();
+            double sum = 0.0;
+            for (size_t i = begin; i < end; ++i) {
+                const double value = columns[d][order[i]];
+                low = min(low, value);
+                high = max(high, value);
+                sum += value;
+            }
+            lower[d] = low;
+            upper[d] = high;
+            sums[d] = sum;
+        }
+        return node;
+    }
+
+    size_t widest = 0;
+    for (size_t d = 1; d < D; ++d) {
+        if (cell[D + d] - cell[d] > cell[D + widest] - cell[widest]) {
+            widest = d;
+        }
+    }
+
+    const size_t middle = begin + (end - begin) / 2;
+    const double* column = columns[widest];
+    nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+        [column](size_t a, size_t b) { return column[a] < column[b]; });
+    const double split = column[order[middle]];
+
+    const double cellUpper = cell[D + widest];
+    cell[D + widest] = split;
+    const size_t left = buildNode(begin, middle, cell);
+    cell[D + widest] = cellUpper;
+
+    const double cellLower = cell[widest];
+    cell[widest] = split;
+    const size_t right = buildNode(middle, end, cell);
+    cell[widest] = cellLower;
+
+    nodes[node].left = left;
+    nodes[node].right = right;
+    for (size_t d = 0; d < D; ++d) {
+        lower[d] = min(lowerCorners[left * D + d], lowerCorners[right * D + d]);
+        upper[d] = max(upperCorners[left * D + d], upperCorners[right * D + d]);
+        sums[d] = nodeSums[left * D + d] + nodeSums[right * D + d];
+    }
+    return node;
+}
+
+/**
+ * @brief Tells whether a candidate is farther than another center from every point of a box.
+ *        The difference of the squared distances to the two centers is linear in the point, so its
+ *        minimum over the box is reached at the corner lying farthest in the direction of the
+ *        candidate. That minimum must exceed PRUNING_MARGIN times the largest sum of the two squared
+ *        distances over the box, which bounds the rounding errors of every point of the box.
+ *
+ * @param candidate The index of the candidate.
+ * @param best The index of the center it is compared with.
+ * @param node The index of the node.
+ * @return bool True if the candidate can be dropped for the whole node.
+ */
+bool KdTreeEngine::isFarther(size_t candidate, size_t best, size_t node) const
+{
+    const size_t D = dimension;
+    const double* lower = &lowerCorners[node * D];
+    const double* upper = &upperCorners[node * D];
+    const double* z = &centers[candidate * D];
+    const double* b = &centers[best * D];
+
+    double gap = 0.0;
+    double reach = 0.0;
+    for (size_t d = 0; d < D; ++d) {
+        const double corner = z[d] > b[d] ? upper[d] : lower[d];
+        const double toCandidate = corner - z[d];
+        const double toBest = corner - b[d];
+        gap += toCandidate * toCandidate - toBest * toBest;
+
+        const double candidateReach = max(fabs(lower[d] - z[d]), fabs(upper[d] - z[d]));
+        const double bestReach = max(fabs(lower[d] - b[d]), fabs(upper[d] - b[d]));
+        reach += candidateReach * candidateReach + bestReach * bestReach;
+    }
+    return gap > PRUNING_MARGIN * reach;
+}
+
+/**
+ * @brief Assigns the samples of a node inside a block. The candidate nearest to the middle of the box
+ *        is kept, together with every candidate it does not beat on the whole box; the kept candidates
+ *        stay in index order, so the per-sample search of the leaves resolves ties like the other engines.
+ *
+ * @param node The index of the node.
+ * @param candidateBegin The position of the candidates of the parent in state.candidates.
+ * @param first The first position of the block.
+ * @param last One past the last position of the block.
+ * @param state The working data of the block.
+ * @param dim The dimension object given by dispatchDimension().
+ */
+template <typename Dim>
+void KdTreeEngine::filter(size_t node, size_t candidateBegin, size_t first, size_t last, FilterState& state, Dim dim)
+{
+    const KdNode& cell = nodes[node];
+    const size_t begin = max(cell.begin, first);
+    const size_t end = min(cell.end, last);
+    if (begin >= end) {
+        return;
+    }
+
+    const size_t D = dim.size();
+    vector<size_t>& candidates = state.candidates;
+    const size_t candidateEnd = candidates.size();
+
+    // The candidate closest to the middle of the box
+    size_t best = candidates[candidateBegin];
+    double bestDistance = numeric_limits<double>::max();
+    for (size_t k = candidateBegin; k < candidateEnd; ++k) {
+        double squared = 0.0;
+        for (size_t d = 0; d < D; ++d) {
+            const double middle = 0.5 * (lowerCorners[node * D + d] + upperCorners[node * D + d]);
+            const double step = middle - centers[candidates[k] * D + d];
+            squared += step * step;
+        }
+        if (squared < bestDistance) {
+            bestDistance = squared;
+            best = candidates[k];
+        }
+    }
+
+    for (size_t k = candidateBegin; k < candidateEnd; ++k) {
+        const size_t candidate = candidates[k];
+        if (candidate == best || !isFarther(candidate, best, node)) {
+            candidates.push_back(candidate);
+        }
+    }
+    const size_t remaining = candidates.size() - candidateEnd;
+
+    if (remaining == 1) {
+        assignRange(node, begin, end, best, state, dim);
+    }
+    else if (cell.left == NO_CHILD) {
+        // A leaf with several candidates: search them for every sample
+        for (size_t i = begin; i < end; ++i) {
+            const size_t row = order[i];
+            loadPoint(row, state.point, dim);
+
+            size_t nearest = candidates[candidateEnd];
+            double nearestDistance = distance(state.point, nearest, dim);
+            for (size_t k = candidateEnd + 1; k < candidates.size(); ++k) {
+                const double d = distance(state.point, candidates[k], dim);
+                if (d < nearestDistance) {
+                    nearestDistance = d;
+                    nearest = candidates[k];
+                }
+            }
+            state.distanceCount += remaining;
+            recordAssignment(state.sums, state.labels[row], nearest, state.point, dim);
+        }
+    }
+    else {
+        filter(cell.left, candidateEnd, first, last, state, dim);
+        filter(cell.right, candidateEnd, first, last, state, dim);
+    }
+
+    candidates.resize(candidateEnd);
+}
+
+/**
+ * @brief Assigns a range of the sample order to one center without computing any distance. A node
+ *        given whole to one center covers its samples at once in that assignment, so when the next
+ *        assignment gives it whole to the same center again, its labels are already right.
+ *
+ * @param node The index of the node holding the range.
+ * @param begin The first position of the range.
+ * @param end One past its last position.
+ * @param center The index of the center.
+ * @param state The working data of the block.
+ * @param dim The dimension object given by dispatchDimension().
+ */
+template <typename Dim>
+void KdTreeEngine::assignRange(size_t node, size_t begin, size_t end, size_t center, FilterState& state, Dim dim)
+{
+    KdNode& cell = nodes[node];
+    if (begin == cell.begin && end == cell.end) {
+        // Given whole to the same center by the previous assignment: no label can have changed since
+        const bool unchanged = cell.owner == center && cell.ownerAssignment + 1 == assignmentCount;
+        cell.owner = center;
+        cell.ownerAssignment = assignmentCount;
+
+        if (!hasIncrementalSums()) {
+            // Its cached sums replace end - begin additions
+            double* clusterSums = state.sums + center * (dim.size() + 1);
+            accumulatePoint(clusterSums, &nodeSums[node * dim.size()], dim);
+            clusterSums[dim.size()] += static_cast<double>(end - begin);
+            if (!unchanged) {
+                const int label = static_cast<int>(center) + 1;
+                for (size_t i = begin; i < end; ++i) {
+                    state.labels[order[i]] = label;
+                }
+            }
+            return;
+        }
+        if (unchanged) {
+            return;  ///< Incremental sums: nothing to add or remove
+        }
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+        const size_t row = order[i];
+        if (changesSums(state.labels[row], center)) {
+            loadPoint(row, state.point, dim);  ///< Only needed to update the sums
+        }
+        recordAssignment(state.sums, state.labels[row], center, state.point, dim);
+    }
+}
@@ -0,0 +1,156 @@
+#ifndef KDTREEENGINE_H
+#define KDTREEENGINE_H
+
+#include "AssignmentEngine.h"
+
+using namespace std;
+
+/**
+ * @class KdTreeEngine
+ * @brief Assignment step based on the filtering algorithm (Kanungo et al., 2002), for low dimensions.
+ *        A kd-tree is built once over the samples: every node covers a contiguous range of a sample
+ *        order, knows the bounding box of its samples and caches their coordinate sums. Each node
+ *        receives the candidate centers of its parent and drops every candidate that is farther than
+ *        the candidate nearest to the middle of the box from every point of the box. When a single
+ *        candidate is left, the whole subtree goes to it and its cached sums are added at once;
+ *        otherwise the search goes on in the children, and in the leaves per sample.
+ *
+ *        A candidate is only dropped when it loses by a relative margin far above the rounding
+ *        errors of the distances, so the labels are the same as the brute-force LloydEngine,
+ *        including ties. The blocks of the assignment are ranges of the tree order, so the sums are
+ *        merged in the same order whatever the thread count; they are added up in a different order
+ *        than in the other engines and may differ from theirs in the last bits.
+ *
+ *        The boxes prune well up to about ten dimensions; beyond that most nodes keep many
+ *        candidates and the engine does the work of the brute-force search plus the tree overhead.
+ */
+class KdTreeEngine : public AssignmentEngine
+{
+public:
+
+    /**
+     * @brief Constructor that binds the engine to the samples and the thread pool.
+     *
+     * @param data The samples to assign.
+     * @param pool The thread pool used to process the blocks.
+     */
+    KdTreeEngine(Dataset& data, ThreadPool& pool);
+
+    /**
+     * @brief Assigns each sample to the nearest cluster by filtering the candidate centers down the tree.
+     *        The tree is built at the first call, and again when the samples change.
+     *
+     * @param clusters The clusters with their current centers.
+     */
+    void assign(const vector<Cluster>& clusters) override;
+
+private:
+
+    /**
+     * @struct KdNode
+     * @brief A node of the tree: a range of the sample order, its two halves, and the center the whole
+     *        node was last assigned to at once.
+     */
+    struct KdNode
+    {
+        size_t begin;           ///< The first position of the node in the sample order.
+        size_t end;             ///< One past its last position.
+        size_t left;            ///< The index of the lower child, or NO_CHILD for a leaf.
+        size_t right;           ///< The index of the upper child, or NO_CHILD for a leaf.
+        size_t owner;           ///< The center the whole node was assigned to, or NO_CHILD.
+        size_t ownerAssignment; ///< The number of the assignment that did it.
+    };
+
+    /**
+     * @struct FilterState
+     * @brief The working data of one block of the assignment.
+     */
+    struct FilterState
+    {
+        double* sums;              ///< The partial sums of the block.
+        int* labels;               ///< The cluster IDs of the samples.
+        double* point;             ///< Room for the coordinates of one sample.
+        size_t distanceCount;      ///< The number of sample-to-center distances computed.
+        vector<size_t> candidates; ///< The candidate lists of the nodes on the current path, one after the other.
+    };
+
+    /** The child index of a leaf, and the owner of a node never assigned at once. */
+    static const size_t NO_CHILD = static_cast<size_t>(-1);
+
+    /**
+     * @brief Builds the tree over every sample.
+     */
+    void buildTree();
+
+    /**
+     * @brief Builds the subtree of a range of the sample order: splits the range at the median of
+     *        the widest side of its cell, or makes a leaf, then sets the bounding box and the sums.
+     *
+     * @param begin The first position of the range.
+     * @param end One past its last position.
+     * @param cell The lowest then the highest coordinates of the region of the node.
+     * @return The index of the node.
+     */
+    size_t buildNode(size_t begin, size_t end, vector<double>& cell);
+
+    /**
+     * @brief Tells whether a candidate center is farther than another one from every point of the
+     *        box of a node, by more than the pruning margin.
+     *
+     * @param candidate The index of the candidate.
+     * @param best The index of the center it is compared with.
+     * @param node The index of the node.
+     * @return true If the candidate can be dropped for the whole node.
+     */
+    bool isFarther(size_t candidate, size_t best, size_t node) const;
+
+    /**
+     * @brief Assigns the samples of a node that lie in a range of the sample order, filtering the
+     *        candidates of the parent node with the box of the node.
+     *
+     * @param node The index of the node.
+     * @param candidateBegin The position of the candidates of the parent in state.candidates; they
+     *        run to the end of the list.
+     * @param first The first position of the block.
+     * @param last One past the last position of the block.
+     * @param state The working data of the block.
+     * @param dim The dimension object given by dispatchDimension().
+     */
+    template <typename Dim>
+    void filter(size_t node, size_t candidateBegin, size_t first, size_t last, FilterState& state, Dim dim);
+
+    /**
+     * @brief Assigns a range of the sample order to one center. A whole node adds its cached sums
+     *        at once, unless the sums are updated incrementally, and keeps its labels untouched when
+     *        the previous assignment gave the whole node to the same center.
+     *
+     * @param node The index of the node holding the range.
+     * @param begin The first position of the range.
+     * @param end One past its last position.
+     * @param center The index of the center.
+     * @param state The working data of the block.
+     * @param dim The dimension object given by dispatchDimension().
+     */
+    template <typename Dim>
+    void assignRange(size_t node, size_t begin, size_t end, size_t center, FilterState& state, Dim dim);
+
+    /** The sample rows in tree order: every node covers a contiguous range. */
+    vector<size_t> order;
+
+    /** The nodes of the tree; the root is node 0. */
+    vector<KdNode> nodes;
+
+    /** The lowest coordinates of the samples of every node, row-major (nodes x D). */
+    vector<double> lowerCorners;
+
+    /** The highest coordinates of the samples of every node, row-major (nodes x D). */
+    vector<double> upperCorners;
+
+    /** The coordinate sums of the samples of every node, row-major (nodes x D). */
+    vector<double> nodeSums;
+
+    /** The number of assignments made with the current tree. */
+    size_t assignmentCount;
+};
+
+#endif
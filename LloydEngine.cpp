@@ -0,0 +1,129 @@
+/****************************************************************************
+ * @file LloydEngine.cpp
+ * @brief Implementation of the LloydEngine class, the brute-force assignment
+ *        step that compares every sample with every cluster center.
+ ****************************************************************************/
+
+#include "LloydEngine.h"
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * @brief Constructor that binds the engine to the samples and the thread pool.
+ *
+ * @param data The samples to assign.
+ * @param pool The thread pool used to process the blocks.
+ */
+LloydEngine::LloydEngine(Dataset& data, ThreadPool& pool)
+    : AssignmentEngine(data, pool)
+{
+}
+
+/**
+ * @brief This method calculates the Euclidean distance between each sample and
+ *        the centers of all clusters, and assigns the sample to the nearest cluster.
+ *        The search itself runs in the vectorized DistanceKernel, a chunk of samples at a time.
+ *        Every block only writes its own samples and its own partial sums, so no locking is needed.
+ *        Samples stored in another precision are searched against float centers, and widened to
+ *        doubles for the sums.
+ *
+ * @param clusters The clusters with their current centers.
+ */
+void LloydEngine::assign(const vector<Cluster>& clusters)
+{
+    const size_t K = clusters.size();
+    loadCenters(clusters);
+    resetBlockSums(K);
+
+    const Precision precision = data.getPrecision();
+    switch (precision) {
+    case Precision::Single:
+        loadStoredColumns(floatColumns);
+        break;
+    case Precision::Half:
+        loadStoredColumns(halfColumns);
+        break;
+    case Precision::BFloat16:
+        loadStoredColumns(bfloat16Columns);
+        break;
+    default:
+        break;
+    }
+    if (precision != Precision::Double) {
+        floatCenters.assign(centers.begin(), centers.end());
+    }
+
+    int* labels = data.getLabels();
+
+    dispatchDimension(dimension, [&](auto dim) {
+        pool.parallelFor(getBlockCount(), [&](size_t block) {
+            const size_t end = getBlockBegin(block + 1);
+            double* sums = getBlockSums(block);
+            auto point = dim.makePoint();
+            size_t nearest[DistanceKernel::CHUNK_SIZE];
+            double distances[DistanceKernel::CHUNK_SIZE];
+            float floatDistances[DistanceKernel::CHUNK_SIZE];
+
+            for (size_t chunk = getBlockBegin(block); chunk < end; chunk += DistanceKernel::CHUNK_SIZE) {
+                const size_t chunkEnd = min(end, chunk + DistanceKernel::CHUNK_SIZE);
+
+                // Find the nearest cluster center of each sample of the chunk
+                switch (precision) {
+                case Precision::Single:
+                    kernel.findNearest(floatColumns.data(), dimension, chunk, chunkEnd, floatCenters.data(), K,
+                        nearest, floatDistances);
+                    break;
+                case Precision::Half:
+                    kernel.findNearest(halfColumns.data(), dimension, chunk, chunkEnd, floatCenters.data(), K,
+                        nearest, floatDistances);
+                    break;
+                case Precision::BFloat16:
+                    kernel.findNearest(bfloat16Columns.data(), dimension, chunk, chunkEnd, floatCenters.data(), K,
+                        nearest, floatDistances);
+                    break;
+                default:
+                    kernel.findNearest(columns.data(), dimension, chunk, chunkEnd, centers.data(), K, nearest, distances);
+                    break;
+                }
+
+                // Assign each sample to the closest cluster and update the block's partial sums
+                for (size_t i = chunk; i < chunkEnd; ++i) {
+                    const size_t best = nearest[i - chunk];
+                    if (changesSums(labels[i], best)) {
+                        loadPoint(i, point.data(), dim);  ///< Only needed to update the sums
+                    }
+                    recordAssignment(sums, labels[i], best, point.data(), dim);
+                }
+            }
+
+            setBlockDistanceCount(block, (end - getBlockBegin(block)) * K);
+            });
+        });
+
+    mergeBlockSums();
+}
+
+/**
+ * @brief Returns whether the engine searches samples stored in a reduced precision.
+ *
+ * @return true The brute-force search has versions for floats, halves and bfloat16.
+ */
+bool LloydEngine::supportsReducedPrecision() const
+{
+    return true;
+}
+
+/**
+ * @brief Collects the stored columns of the samples, as passed to the distance kernel.
+ *
+ * @param pointers Receives one column per dimension.
+ */
+template <typename S>
+void LloydEngine::loadStoredColumns(vector<const S*>& pointers)
+{
+    pointers.resize(dimension);
+    for (size_t d = 0; d < dimension; ++d) {
+        pointers[d] = data.getStoredColumn<S>(d);
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef LLOYDENGINE_H
+#define LLOYDENGINE_H
+
+#include "AssignmentEngine.h"
+#include "HalfFloat.h"
+
+using namespace std;
+
+/**
+ * @class LloydEngine
+ * @brief The brute-force assignment step of Lloyd's algorithm.
+ *        Every sample is compared with every cluster center in each iteration.
+ *
+ *        It is the one engine that also searches samples stored in a reduced precision (see
+ *        Dataset::setPrecision()). Single-precision samples are searched against float copies of the
+ *        centers; half and bfloat16 samples, a quarter of the size of doubles, are widened to floats
+ *        by the kernel as it loads them. The sums of the clusters are still added up in double, from
+ *        the stored coordinates widened exactly, so the centers do not lose accuracy as they add up;
+ *        the labels follow the rounded coordinates, and samples near the boundary of two clusters can
+ *        change sides compared with double precision.
+ */
+class LloydEngine : public AssignmentEngine
+{
+public:
+
+    /**
+     * @brief Constructor that binds the engine to the samples and the thread pool.
+     *
+     * @param data The samples to assign.
+     * @param pool The thread pool used to process the blocks.
+     */
+    LloydEngine(Dataset& data, ThreadPool& pool);
+
+    /**
+     * @brief Assigns each sample to the nearest cluster by computing the distance to every center.
+     *
+     * @param clusters The clusters with their current centers.
+     */
+    void assign(const vector<Cluster>& clusters) override;
+
+protected:
+
+    /**
+     * @brief Returns whether the engine searches samples stored in a reduced precision.
+     *
+     * @return true The brute-force search has versions for floats, halves and bfloat16.
+     */
+    bool supportsReducedPrecision() const override;
+
+private:
+
+    /**
+     * @brief Collects the stored columns of the samples, as passed to the distance kernel.
+     *
+     * @param pointers Receives one column per dimension.
+     */
+    template <typename S>
+    void loadStoredColumns(vector<const S*>& pointers);
+
+    /** Single precision: the float columns of the samples, set at every assignment. */
+    vector<const float*> floatColumns;
+
+    /** Half precision: the half columns of the samples, set at every assignment. */
+    vector<const Half*> halfColumns;
+
+    /** Bfloat16 precision: the bfloat16 columns of the samples, set at every assignment. */
+    vector<const BFloat16*> bfloat16Columns;
+
+    /** Every precision but double: the centers as floats, row-major (K x D). */
+    vector<float> floatCenters;
+};
+
+#endif
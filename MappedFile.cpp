@@ -0,0 +1,151 @@
+/****************************************************************************
+ * @file MappedFile.cpp
+ * @brief Implementation of the MappedFile class with the Win32 file mapping
+ *        functions on Windows and POSIX mmap on the other systems.
+ ****************************************************************************/
+
+#include "MappedFile.h"
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/**
+ * @brief Constructor that maps a file. An empty file is not mapped; data() then returns nullptr.
+ *
+ * @param fileName The name of the file.
+ * @throws runtime_error If the file cannot be opened or mapped.
+ */
+MappedFile::MappedFile(const string& fileName)
+    : address(nullptr), length(0)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw runtime_error("File not found: " + fileName);
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        throw runtime_error("Cannot read the size of " + fileName);
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+
+    if (length > 0) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr) {
+            address = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);  ///< The view keeps the mapping alive
+        }
+    }
+    CloseHandle(file);
+#else
+    int file = open(fileName.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw runtime_error("File not found: " + fileName);
+    }
+
+    struct stat status;
+    if (fstat(file, &status) != 0) {
+        close(file);
+        throw runtime_error("Cannot read the size of " + fileName);
+    }
+    length = static_cast<size_t>(status.st_size);
+
+    if (length > 0) {
+        void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapping != MAP_FAILED) {
+            address = static_cast<const char*>(mapping);
+            madvise(mapping, length, MADV_SEQUENTIAL);
+        }
+    }
+    close(file);  ///< The mapping stays valid after the descriptor is closed
+#endif
+
+    if (length > 0 && address == nullptr) {
+        throw runtime_error("Cannot map " + fileName + " into memory");
+    }
+}
+
+/**
+ * @brief Move constructor that takes over the mapping of another object.
+ *
+ * @param other The object to take the mapping from.
+ */
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : address(exchange(other.address, nullptr)), length(exchange(other.length, 0))
+{
+}
+
+/**
+ * @brief Move assignment that releases the current mapping and takes over the one of another object.
+ *
+ * @param other The object to take the mapping from.
+ * @return MappedFile& A reference to this object.
+ */
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        unmap();
+        address = exchange(other.address, nullptr);
+        length = exchange(other.length, 0);
+    }
+    return *this;
+}
+
+/**
+ * @brief Destructor that unmaps the file.
+ */
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+/**
+ * @brief Returns the contents of the file.
+ *
+ * @return const char* The first byte, or nullptr for an empty file.
+ */
+const char* MappedFile::data() const
+{
+    return address;
+}
+
+/**
+ * @brief Returns the size of the file.
+ *
+ * @return size_t The number of bytes.
+ */
+size_t MappedFile::size() const
+{
+    return length;
+}
+
+/**
+ * @brief Releases the mapping, if any.
+ */
+void MappedFile::unmap()
+{
+    if (address == nullptr) return;
+#ifdef _WIN32
+    UnmapViewOfFile(address);
+#else
+    munmap(const_cast<char*>(address), length);
+#endif
+    address = nullptr;
+    length = 0;
+}
@@ -0,0 +1,79 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+/**
+ * @class MappedFile
+ * @brief A read-only memory mapping of a whole file (MapViewOfFile on Windows, mmap elsewhere).
+ *        The pages are loaded by the operating system on first access, so opening a file is cheap
+ *        and several threads can read different parts of it without copying it into a buffer.
+ *        The mapping is released by the destructor; the class can be moved but not copied.
+ */
+class MappedFile
+{
+public:
+
+    /**
+     * @brief Constructor that maps a file.
+     *
+     * @param fileName The name of the file.
+     * @throws runtime_error If the file cannot be opened or mapped.
+     */
+    explicit MappedFile(const string& fileName);
+
+    /**
+     * @brief Move constructor that takes over the mapping of another object.
+     *
+     * @param other The object to take the mapping from. It is left empty.
+     */
+    MappedFile(MappedFile&& other) noexcept;
+
+    /**
+     * @brief Move assignment that releases the current mapping and takes over the one of another object.
+     *
+     * @param other The object to take the mapping from. It is left empty.
+     * @return A reference to this object.
+     */
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Destructor that unmaps the file.
+     */
+    ~MappedFile();
+
+    /**
+     * @brief Returns the contents of the file.
+     *
+     * @return A pointer to size() bytes, or nullptr for an empty file.
+     */
+    const char* data() const;
+
+    /**
+     * @brief Returns the size of the file.
+     *
+     * @return The number of bytes.
+     */
+    size_t size() const;
+
+private:
+
+    /**
+     * @brief Releases the mapping, if any.
+     */
+    void unmap();
+
+    /** The first byte of the mapping. */
+    const char* address;
+
+    /** The size of the file in bytes. */
+    size_t length;
+};
+
+#endif
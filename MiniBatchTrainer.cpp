@@ -0,0 +1,196 @@
+/****************************************************************************
+ * @file MiniBatchTrainer.cpp
+ * @brief Implementation of the MiniBatchTrainer class: seeded batch
+ *        sampling, a parallel vectorized assignment of each batch and
+ *        per-center learning-rate updates of the Cluster centers.
+ ****************************************************************************/
+
+#include "MiniBatchTrainer.h"
+#include "BlockPartition.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * @brief Constructor that binds the trainer to the samples and the thread pool.
+ *
+ * @param data The samples to train on.
+ * @param pool The thread pool used by the assignment of each batch.
+ * @param options The batch size, the stopping criteria, the seed and the instruction set.
+ * @throws invalid_argument If the batch size is 0, the precision is not double, or nothing would stop an
+ *         unlimited number of batches.
+ */
+MiniBatchTrainer::MiniBatchTrainer(const Dataset& data, ThreadPool& pool, const KMeansOptions& options)
+    : data(data), pool(pool), options(options), kernel(options.instructionSet), generator(options.seed),
+    batchCount(0), converged(false)
+{
+    if (options.batchSize == 0) {
+        throw invalid_argument("The batch size must be a positive number.");
+    }
+    if (options.precision != Precision::Double) {
+        throw invalid_argument("Mini-batch training only supports double precision.");
+    }
+    if (options.maxBatches == 0 && options.driftTolerance <= 0.0 && options.timeBudget <= 0.0) {
+        throw invalid_argument("Without a batch limit, mini-batch training needs a positive drift tolerance or time budget.");
+    }
+}
+
+/**
+ * @brief Trains the centers of the clusters with mini-batches until one of the stopping criteria is met.
+ *
+ * @param clusters The clusters, holding the initial centers.
+ * @param report Called every reportInterval batches with the progress; may be empty.
+ */
+void MiniBatchTrainer::run(vector<Cluster>& clusters, const function<void(const MiniBatchReport&)>& report)
+{
+    const size_t K = clusters.size();
+    const size_t D = data.getDimension();
+    const auto start = chrono::steady_clock::now();
+
+    centers.resize(K * D);
+    for (size_t c = 0; c < K; ++c) {
+        copy(clusters[c].getCenter().begin(), clusters[c].getCenter().end(), &centers[c * D]);
+    }
+    totalCounts.assign(K, 0);
+    batchColumns.assign(D, vector<double>(options.batchSize));
+    batchCount = 0;
+    converged = false;
+
+    double intervalInertia = 0.0;
+    size_t intervalSamples = 0;
+    while (options.maxBatches == 0 || batchCount < options.maxBatches) {
+        drawBatch();
+        intervalInertia += assignBatch();
+        intervalSamples += options.batchSize;
+        ++batchCount;
+
+        // Move every center that got samples; its learning rate shrinks as it receives more of them
+        double drift = 0.0;
+        for (size_t c = 0; c < K; ++c) {
+            if (counts[c] == 0) continue;
+            totalCounts[c] += counts[c];
+            const double learningRate = static_cast<double>(counts[c]) / totalCounts[c];
+            drift = max(drift, clusters[c].moveCenter(&sums[c * D], counts[c], learningRate));
+            copy(clusters[c].getCenter().begin(), clusters[c].getCenter().end(), &centers[c * D]);
+        }
+
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        if (options.reportInterval > 0 && batchCount % options.reportInterval == 0) {
+            if (report) {
+                report({ batchCount, intervalInertia / intervalSamples, elapsed.count() });
+            }
+            intervalInertia = 0.0;
+            intervalSamples = 0;
+        }
+
+        if (drift <= options.driftTolerance) {
+            converged = true;
+            break;
+        }
+        if (options.timeBudget > 0.0 && elapsed.count() >= options.timeBudget) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Returns the number of batches processed by run().
+ *
+ * @return size_t The number of batches.
+ */
+size_t MiniBatchTrainer::getBatchCount() const
+{
+    return batchCount;
+}
+
+/**
+ * @brief Tells whether run() stopped because the centers stopped moving.
+ *
+ * @return true If the last batch moved no center farther than the drift tolerance.
+ */
+bool MiniBatchTrainer::hasConverged() const
+{
+    return converged;
+}
+
+/**
+ * @brief Draws batchSize rows uniformly with replacement and gathers their coordinates.
+ *        The rows are scaled from the 53 high bits of the generator, like CenterInitializer,
+ *        because uniform_int_distribution differs between standard libraries.
+ */
+void MiniBatchTrainer::drawBatch()
+{
+    const size_t N = data.size();
+    batchRows.resize(options.batchSize);
+    for (size_t& row : batchRows) {
+        const double uniform = static_cast<double>(generator() >> 11) * (1.0 / 9007199254740992.0);
+        row = min(N - 1, static_cast<size_t>(uniform * N));
+    }
+    sort(batchRows.begin(), batchRows.end());
+
+    for (size_t d = 0; d < batchColumns.size(); ++d) {
+        const double* column = data.getColumn(d);
+        double* batchColumn = batchColumns[d].data();
+        for (size_t i = 0; i < batchRows.size(); ++i) {
+            batchColumn[i] = column[batchRows[i]];
+        }
+    }
+}
+
+/**
+ * @brief Assigns the batch samples to their nearest centers in parallel blocks and merges the
+ *        per-block sums, counts and squared distances in block order.
+ *
+ * @return double The sum of the squared distances of the batch samples to their nearest center.
+ */
+double MiniBatchTrainer::assignBatch()
+{
+    const size_t K = totalCounts.size();
+    const size_t D = batchColumns.size();
+    const BlockPartition blocks(batchRows.size());
+
+    vector<const double*> columns(D);
+    for (size_t d = 0; d < D; ++d) {
+        columns[d] = batchColumns[d].data();
+    }
+
+    // Per block: K rows of D sums followed by the count, then the sum of the squared distances
+    const size_t stride = D + 1;
+    vector<vector<double>> blockSums(blocks.getBlockCount(), vector<double>(K * stride + 1));
+    pool.parallelFor(blocks.getBlockCount(), [&](size_t block) {
+        size_t nearest[DistanceKernel::CHUNK_SIZE];
+        double distances[DistanceKernel::CHUNK_SIZE];
+        vector<double>& partial = blockSums[block];
+        fill(partial.begin(), partial.end(), 0.0);
+
+        const size_t end = blocks.getBlockEnd(block);
+        for (size_t chunk = blocks.getBlockBegin(block); chunk < end; chunk += DistanceKernel::CHUNK_SIZE) {
+            const size_t chunkEnd = min(end, chunk + DistanceKernel::CHUNK_SIZE);
+            kernel.findNearest(columns.data(), D, chunk, chunkEnd, centers.data(), K, nearest, distances);
+            for (size_t i = chunk; i < chunkEnd; ++i) {
+                double* target = &partial[nearest[i - chunk] * stride];
+                for (size_t d = 0; d < D; ++d) {
+                    target[d] += columns[d][i];
+                }
+                target[D] += 1.0;
+                partial[K * stride] += distances[i - chunk] * distances[i - chunk];
+            }
+        }
+        });
+
+    sums.assign(K * D, 0.0);
+    counts.assign(K, 0);
+    double inertia = 0.0;
+    for (const vector<double>& partial : blockSums) {
+        for (size_t c = 0; c < K; ++c) {
+            for (size_t d = 0; d < D; ++d) {
+                sums[c * D + d] += partial[c * stride + d];
+            }
+            counts[c] += static_cast<size_t>(partial[c * stride + D]);
+        }
+        inertia += partial[K * stride];
+    }
+    return inertia;
+}
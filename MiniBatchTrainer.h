@@ -0,0 +1,135 @@
+#ifndef MINIBATCHTRAINER_H
+#define MINIBATCHTRAINER_H
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+#include "Cluster.h"
+#include "Dataset.h"
+#include "DistanceKernel.h"
+#include "KMeansOptions.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+/**
+ * @struct MiniBatchReport
+ * @brief The progress of mini-batch training, reported every KMeansOptions::reportInterval batches.
+ */
+struct MiniBatchReport
+{
+    /** The number of batches processed so far. */
+    size_t batch;
+
+    /** The mean squared distance of the samples of the last reportInterval batches to their nearest center. */
+    double inertia;
+
+    /** The time spent training so far, in seconds. */
+    double seconds;
+};
+
+/**
+ * @class MiniBatchTrainer
+ * @brief Mini-batch K-means (Sculley, 2010) for data sets too large for full Lloyd iterations.
+ *        Every batch draws batchSize samples uniformly with replacement, assigns them to their nearest
+ *        center and moves each center towards the mean of its batch samples with a per-center
+ *        learning rate of (batch samples) / (all samples it received so far), which makes every center
+ *        the running mean of the samples assigned to it.
+ *
+ *        The batches are drawn from a seeded 64-bit Mersenne Twister and the per-block sums of the
+ *        assignment are added in block order, so a seed gives the same centers for every thread count.
+ */
+class MiniBatchTrainer
+{
+public:
+
+    /**
+     * @brief Constructor that binds the trainer to the samples and the thread pool.
+     *
+     * @param data The samples to train on.
+     * @param pool The thread pool used by the assignment of each batch.
+     * @param options The batch size, the stopping criteria, the seed and the instruction set.
+     * @throws invalid_argument If the batch size is 0, the precision is not double, or maxBatches is 0
+     *         without a positive drift tolerance or time budget.
+     */
+    MiniBatchTrainer(const Dataset& data, ThreadPool& pool, const KMeansOptions& options);
+
+    /**
+     * @brief Trains the centers of the clusters until no center moves farther than the drift tolerance
+     *        during a batch, the time budget is spent or maxBatches batches are done (0: no limit).
+     *
+     * @param clusters The clusters, holding the initial centers. Their centers are updated in place.
+     * @param report Called every reportInterval batches with the progress; may be empty.
+     */
+    void run(vector<Cluster>& clusters, const function<void(const MiniBatchReport&)>& report);
+
+    /**
+     * @brief Returns the number of batches processed by run().
+     *
+     * @return The number of batches.
+     */
+    size_t getBatchCount() const;
+
+    /**
+     * @brief Tells whether run() stopped because the centers stopped moving.
+     *
+     * @return true If the last batch moved no center farther than the drift tolerance.
+     */
+    bool hasConverged() const;
+
+private:
+
+    /**
+     * @brief Draws the rows of the next batch and copies their coordinates into the batch columns.
+     *        The rows are sorted so the copy walks through memory in order.
+     */
+    void drawBatch();
+
+    /**
+     * @brief Assigns every batch sample to its nearest center and collects the coordinate sums,
+     *        the counts and the squared distances per center.
+     *
+     * @return The sum of the squared distances of the batch samples to their nearest center.
+     */
+    double assignBatch();
+
+    /** The samples to train on. */
+    const Dataset& data;
+
+    /** The thread pool used by the assignment of each batch. */
+    ThreadPool& pool;
+
+    /** The batch size, the stopping criteria and the report interval. */
+    KMeansOptions options;
+
+    /** The nearest-center search. */
+    DistanceKernel kernel;
+
+    /** The random generator drawing the batches. */
+    mt19937_64 generator;
+
+    /** The rows of the current batch. */
+    vector<size_t> batchRows;
+
+    /** The coordinates of the current batch, one array per dimension. */
+    vector<vector<double>> batchColumns;
+
+    /** The current centers, row-major (K x dimension). */
+    vector<double> centers;
+
+    /** The coordinate sums (K x dimension, row-major) and the counts of the current batch. */
+    vector<double> sums;
+    vector<size_t> counts;
+
+    /** The number of samples each center has received since the start of the training. */
+    vector<size_t> totalCounts;
+
+    /** The number of batches processed by run(). */
+    size_t batchCount;
+
+    /** Whether run() stopped because the centers stopped moving. */
+    bool converged;
+};
+
+#endif
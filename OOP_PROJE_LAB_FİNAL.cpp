@@ -14,6 +14,9 @@ Deadline: 25.12.2025
 
 #include <iostream>
 #include <fstream>
+#include <string>
+#include "Benchmark.h"
+#include "BinaryDataset.h"
 #include "KMeans.h"
 #include "Cluster.h"
 using namespace std;
@@ -24,25 +27,45 @@ using namespace std;
  * This function initializes the KMeans algorithm with the input data file,
  * number of clusters (K), and the output file where the results will be saved.
  * If any exception occurs during the execution, it is caught and displayed as an error message.
+ * Started with --benchmark, the program runs the performance measurements instead, and
+ * started with --convert <text file> <binary file>, it converts an input file to the binary format.
  *
+ * @param argc The number of command-line arguments.
+ * @param argv The command-line arguments.
  * @return int Status code of the execution.
  */
-int main() {
+int main(int argc, char* argv[]) {
     try {
+        if (argc > 1 && string(argv[1]) == "--benchmark") {
+            Benchmark(cout).run();  ///< Measure the performance-critical parts on synthetic data
+            return 0;
+        }
+        if (argc > 3 && string(argv[1]) == "--convert") {
+            ThreadPool pool(0);
+            size_t count = BinaryDataset::convertText(argv[2], argv[3], pool);  ///< Parse once, map on every later run
+            cout << "Converted " << count << " samples to " << argv[3] << endl;
+            return 0;
+        }
+
         /**
          * @brief Create a KMeans object to perform clustering.
          *
-         * This object initializes the KMeans algorithm with the following parameters:
+         * This object runs the KMeans algorithm with the following parameters:
          * - The file path to the input data: "C:\\Users\\asus\\OneDrive\\Masaüstü\\OOP LAB FINAL\\40.txt"
          * - The number of clusters (K): 6
          * - The file path for saving the output: "C:\\Users\\asus\\OneDrive\\Masaüstü\\OOP LAB FINAL\\output.txt"
          *
-         * The KMeans constructor will load the dataset, perform clustering, and store the results in the output file.
+         * fit() loads the dataset and performs clustering; the results are then printed and stored in the output file,
+         * and the trained model is stored next to it.
          */
-        KMeans kmeans("C:\\Users\\asus\\OneDrive\\Masaüstü\\OOP_PROJE_LAB_FİNAL\\40.txt", 6,
-            "C:\\Users\\asus\\OneDrive\\Masaüstü\\OOP LAB FINAL\\OUTPUT\\output.txt");
-
-
+        KMeans kmeans(6);
+        kmeans.fit("C:\\Users\\asus\\OneDrive\\Masaüstü\\OOP_PROJE_LAB_FİNAL\\40.txt");
+        kmeans.printResults(cout);
+        kmeans.save("C:\\Users\\asus\\OneDrive\\Masaüstü\\OOP LAB FINAL\\OUTPUT\\output.txt");
+        kmeans.getModel().save("C:\\Users\\asus\\OneDrive\\Masaüstü\\OOP LAB FINAL\\OUTPUT\\model.kmm");  ///< Reload with KMeansModel::load()
+        for (const Cluster& cluster : kmeans.getClusters()) {
+            cluster.print();  ///< Print the ID and center of every cluster
+        }
     }
     catch (const exception& e) {
         /**
@@ -0,0 +1,297 @@
+/****************************************************************************
+ * @file ResultWriter.cpp
+ * @brief Implementation of the ResultWriter class: the to_chars number
+ *        formatting of the result rows, the parallel formatting of groups
+ *        of chunks and their ordered, buffered writes.
+ ****************************************************************************/
+
+#include "ResultWriter.h"
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+/** The number of samples formatted as one chunk by one thread. */
+static const size_t ROWS_PER_CHUNK = 16384;
+
+/** The number of chunks formatted at a time per thread before they are written. */
+static const size_t CHUNKS_PER_THREAD = 2;
+
+/** Room for any formatted number, including a fixed-point double near the largest exponent. */
+static const size_t NUMBER_BUFFER_SIZE = 400;
+
+/**
+ * @brief Appends a formatted number, padded on the left with spaces to a width, like setw() does.
+ *
+ * @param buffer The buffer.
+ * @param begin The first character of the number.
+ * @param end One past its last character.
+ * @param width The smallest number of characters to append.
+ */
+static void appendPadded(string& buffer, const char* begin, const char* end, size_t width)
+{
+    const size_t length = static_cast<size_t>(end - begin);
+    if (length < width) {
+        buffer.append(width - length, ' ');
+    }
+    buffer.append(begin, end);
+}
+
+/**
+ * @brief Appends an integer, as operator<< writes it.
+ *
+ * @param buffer The buffer.
+ * @param value The integer.
+ * @param width The smallest number of characters to append.
+ */
+static void appendInteger(string& buffer, int value, size_t width = 0)
+{
+    char number[NUMBER_BUFFER_SIZE];
+    const to_chars_result result = to_chars(number, number + sizeof(number), value);
+    appendPadded(buffer, number, result.ptr, width);
+}
+
+/**
+ * @brief Appends a double in fixed-point notation with 2 decimals, as fixed and setprecision(2) write it.
+ *
+ * @param buffer The buffer.
+ * @param value The double.
+ * @param width The smallest number of characters to append.
+ */
+static void appendFixed(string& buffer, double value, size_t width)
+{
+    char number[NUMBER_BUFFER_SIZE];
+    const to_chars_result result = to_chars(number, number + sizeof(number), value, chars_format::fixed, 2);
+    appendPadded(buffer, number, result.ptr, width);
+}
+
+/**
+ * @brief Appends a double with 6 significant digits, as the default stream formatting writes it.
+ *
+ * @param buffer The buffer.
+ * @param value The double.
+ */
+static void appendGeneral(string& buffer, double value)
+{
+    char number[NUMBER_BUFFER_SIZE];
+    const to_chars_result result = to_chars(number, number + sizeof(number), value, chars_format::general, 6);
+    buffer.append(number, result.ptr);
+}
+
+/**
+ * @brief Appends a double in the shortest form that reads back to the same value.
+ *
+ * @param buffer The buffer.
+ * @param value The double.
+ */
+static void appendShortest(string& buffer, double value)
+{
+    char number[NUMBER_BUFFER_SIZE];
+    const to_chars_result result = to_chars(number, number + sizeof(number), value);
+    buffer.append(number, result.ptr);
+}
+
+/**
+ * @brief Builds the column header line of the Table format. 2D data keeps the original X / Y
+ *        columns; other dimensions get one column per coordinate (X1, X2, ...).
+ *
+ * @param dimension The number of coordinates.
+ * @return string The header line, without the line break.
+ */
+static string makeTableHeader(size_t dimension)
+{
+    string header = "|  Index   |";
+    if (dimension == 2) {
+        header += "  X     |   Y    |";
+    }
+    else {
+        for (size_t d = 0; d < dimension; ++d) {
+            ostringstream column;
+            column << " " << setw(6) << ("X" + to_string(d + 1)) << " |";
+            header += column.str();
+        }
+    }
+    return header + " Cluster ID |";
+}
+
+/**
+ * @brief Constructor that sets the samples to write and the thread pool that formats them.
+ *
+ * @param data The labelled samples.
+ * @param pool The thread pool.
+ */
+ResultWriter::ResultWriter(const Dataset& data, ThreadPool& pool)
+    : data(data), pool(pool)
+{
+}
+
+/**
+ * @brief Writes the samples to a stream: the labels in one write for the Labels format, otherwise
+ *        the header, the rows formatted a group of chunks at a time, and the footer.
+ *
+ * @param output The stream to write to.
+ * @param format The format of the output.
+ */
+void ResultWriter::write(ostream& output, ResultFormat format) const
+{
+    const size_t N = data.size();
+    if (format == ResultFormat::Labels) {
+        output.write(reinterpret_cast<const char*>(data.getLabels()), static_cast<streamsize>(N * sizeof(int)));
+        return;
+    }
+
+    const string header = makeHeader(format);
+    output.write(header.data(), static_cast<streamsize>(header.size()));
+
+    const size_t chunkCount = (N + ROWS_PER_CHUNK - 1) / ROWS_PER_CHUNK;
+    const size_t groupSize = CHUNKS_PER_THREAD * pool.getThreadCount();
+    vector<string> buffers(min(groupSize, chunkCount));
+    for (size_t first = 0; first < chunkCount; first += groupSize) {
+        const size_t count = min(groupSize, chunkCount - first);
+        pool.parallelFor(count, [&](size_t i) {
+            const size_t begin = (first + i) * ROWS_PER_CHUNK;
+            formatRows(format, begin, min(N, begin + ROWS_PER_CHUNK), buffers[i]);
+            });
+
+        for (size_t i = 0; i < count; ++i) {
+            output.write(buffers[i].data(), static_cast<streamsize>(buffers[i].size()));
+        }
+    }
+
+    const string footer = makeFooter(format);
+    output.write(footer.data(), static_cast<streamsize>(footer.size()));
+}
+
+/**
+ * @brief Writes the samples to a file.
+ *
+ * @param fileName The name of the file.
+ * @param format The format of the output.
+ * @throws runtime_error If the file cannot be written.
+ */
+void ResultWriter::write(const string& fileName, ResultFormat format) const
+{
+    ofstream file(fileName, format == ResultFormat::Labels ? ios::binary : ios::out);
+    if (!file.is_open()) {
+        throw runtime_error("Unable to open file: " + fileName);
+    }
+
+    write(file, format);
+    if (!file.flush()) {
+        throw runtime_error("Cannot write " + fileName);
+    }
+}
+
+/**
+ * @brief Appends the formatted rows of a range of samples to a cleared buffer.
+ *
+ * @param format The text format of the rows.
+ * @param begin The first sample.
+ * @param end One past the last sample.
+ * @param buffer The buffer.
+ */
+void ResultWriter::formatRows(ResultFormat format, size_t begin, size_t end, string& buffer) const
+{
+    const size_t D = data.getDimension();
+    const int* indices = data.getIndices();
+    const int* labels = data.getLabels();
+    buffer.clear();
+
+    for (size_t i = begin; i < end; ++i) {
+        switch (format) {
+        case ResultFormat::Table:
+            buffer += "| ";
+            appendInteger(buffer, indices[i], 8);
+            buffer += " | ";
+            for (size_t d = 0; d < D; ++d) {
+                appendFixed(buffer, data.getCoordinate(d, i), 6);
+                buffer += " | ";
+            }
+            appendInteger(buffer, labels[i], 10);
+            buffer += " |\n";
+            break;
+
+        case ResultFormat::Listing:
+            buffer += "Index: ";
+            appendInteger(buffer, indices[i]);
+            if (D == 2) {
+                buffer += "\t| X: ";
+                appendGeneral(buffer, data.getCoordinate(0, i));
+                buffer += " \t| Y: ";
+                appendGeneral(buffer, data.getCoordinate(1, i));
+            }
+            else {
+                buffer += "\t| Coordinates: (";
+                for (size_t d = 0; d < D; ++d) {
+                    if (d > 0) {
+                        buffer += ", ";
+                    }
+                    appendGeneral(buffer, data.getCoordinate(d, i));
+                }
+                buffer += ")";
+            }
+            buffer += "\t| Cluster ID: ";
+            appendInteger(buffer, labels[i]);
+            buffer += "\n";
+            break;
+
+        case ResultFormat::Csv:
+            appendInteger(buffer, indices[i]);
+            for (size_t d = 0; d < D; ++d) {
+                buffer += ',';
+                appendShortest(buffer, data.getCoordinate(d, i));
+            }
+            buffer += ',';
+            appendInteger(buffer, labels[i]);
+            buffer += '\n';
+            break;
+
+        case ResultFormat::Labels:
+            break;  ///< Written without formatting by write()
+        }
+    }
+}
+
+/**
+ * @brief Builds the lines written before the rows: the framed column headers of the table or
+ *        the column names of the CSV file.
+ *
+ * @param format The text format.
+ * @return string The header lines.
+ */
+string ResultWriter::makeHeader(ResultFormat format) const
+{
+    const size_t D = data.getDimension();
+    if (format == ResultFormat::Table) {
+        const string header = makeTableHeader(D);
+        const string line(header.size() + 3, '-');
+        return line + "\n" + header + "\n" + line + "\n";
+    }
+    if (format == ResultFormat::Csv) {
+        string header = "index";
+        for (size_t d = 0; d < D; ++d) {
+            header += ",x" + to_string(d + 1);
+        }
+        return header + ",cluster\n";
+    }
+    return string();
+}
+
+/**
+ * @brief Builds the lines written after the rows: the closing line of the table.
+ *
+ * @param format The text format.
+ * @return string The footer lines.
+ */
+string ResultWriter::makeFooter(ResultFormat format) const
+{
+    if (format == ResultFormat::Table) {
+        return string(makeTableHeader(data.getDimension()).size() + 3, '-') + "\n";
+    }
+    return string();
+}
@@ -0,0 +1,97 @@
+#ifndef RESULTWRITER_H
+#define RESULTWRITER_H
+
+#include <ostream>
+#include <string>
+#include "Dataset.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+/**
+ * @enum ResultFormat
+ * @brief The ways of writing the labelled samples.
+ */
+enum class ResultFormat
+{
+    Table,   ///< The fixed-width table of KMeans::save(): index, coordinates with 2 decimals, cluster ID.
+    Listing, ///< The "Index: ... | Cluster ID: ..." lines of KMeans::printResults(), as operator<< of Sample prints them.
+    Csv,     ///< A header line, then index,x1,...,xD,cluster per sample, coordinates in their shortest exact form.
+    Labels   ///< The cluster ID of every sample as 32-bit integers, like the label file of the out-of-core mode.
+};
+
+/**
+ * @class ResultWriter
+ * @brief Fast writer of the labelled samples of a dataset.
+ *
+ *        The rows are formatted in chunks of a fixed number of samples, in parallel on the thread pool,
+ *        with the locale-independent std::to_chars instead of stream manipulators. A group of chunks is
+ *        formatted at a time and then written in order with one large write per chunk, so the memory
+ *        used stays bounded whatever the number of samples and nothing is flushed per row. The text is
+ *        the same, byte for byte, as the stream formatting it replaces.
+ */
+class ResultWriter
+{
+public:
+
+    /**
+     * @brief Constructor that sets the samples to write and the thread pool that formats them.
+     *
+     * @param data The labelled samples.
+     * @param pool The thread pool.
+     */
+    ResultWriter(const Dataset& data, ThreadPool& pool);
+
+    /**
+     * @brief Writes the samples to a stream. The Labels format needs a stream opened in binary mode.
+     *
+     * @param output The stream to write to.
+     * @param format The format of the output.
+     */
+    void write(ostream& output, ResultFormat format) const;
+
+    /**
+     * @brief Writes the samples to a file, opened in binary mode for the Labels format.
+     *
+     * @param fileName The name of the file.
+     * @param format The format of the output.
+     * @throws runtime_error If the file cannot be written.
+     */
+    void write(const string& fileName, ResultFormat format) const;
+
+private:
+
+    /**
+     * @brief Appends the formatted rows of a range of samples to a buffer.
+     *
+     * @param format The text format of the rows.
+     * @param begin The first sample.
+     * @param end One past the last sample.
+     * @param buffer The buffer; it is cleared first.
+     */
+    void formatRows(ResultFormat format, size_t begin, size_t end, string& buffer) const;
+
+    /**
+     * @brief Builds the lines written before the rows.
+     *
+     * @param format The text format.
+     * @return The header lines, empty for the Listing format.
+     */
+    string makeHeader(ResultFormat format) const;
+
+    /**
+     * @brief Builds the lines written after the rows.
+     *
+     * @param format The text format.
+     * @return The footer lines, empty unless the format is Table.
+     */
+    string makeFooter(ResultFormat format) const;
+
+    /** The labelled samples. */
+    const Dataset& data;
+
+    /** The thread pool that formats the chunks. */
+    ThreadPool& pool;
+};
+
+#endif
@@ -1,27 +1,27 @@
 /***********************************************************************
  * @file Sample.cpp
- * @brief Represents a data point in 2D space. Each instance has an index number,
- *        x and y coordinates, and a cluster ID. Provides the overloaded <<
- *        operator to print its information to the screen.
+ * @brief Represents a data point in D-dimensional space (2D for the original
+ *        data). Each instance has an index number, one coordinate per dimension
+ *        and a cluster ID, all stored in the arrays of a Dataset. Provides the overloaded << operator to print its information
+ *        to the screen.
  ***********************************************************************/
 
 #include "Sample.h"
+#include "Dataset.h"
 #include <stdexcept>
 
 using namespace std;
 
 /**
- * @brief Constructor: Initializes a Sample object with the provided index, cluster ID, and (x, y) coordinates.
+ * @brief Constructor: Creates a view of one row of a dataset.
  *
- * @param i Index of the sample.
- * @param clusterID The ID of the cluster to which the sample belongs.
- * @param X The X coordinate of the sample in 2D space.
- * @param Y The Y coordinate of the sample in 2D space.
+ * @param data The dataset holding the sample.
+ * @param r The position of the sample in the dataset.
  */
-Sample::Sample(int i, int clusterID, double X, double Y)
-    : idx(i), x(X), y(Y)
+Sample::Sample(Dataset* data, size_t r)
+    : dataset(data), row(r)
 {
-    // The constructor initializes the sample's index, cluster ID, and coordinates (x, y).
+    // The constructor only remembers where the sample's values are stored.
 }
 
 /**
@@ -39,7 +39,17 @@ Sample::~Sample()
  */
 void Sample::setClusterID(int clusterID)
 {
-    cID = clusterID;  ///< Set the sample's cluster ID.
+    dataset->getLabels()[row] = clusterID;  ///< Set the sample's cluster ID.
+}
+
+/**
+ * @brief Method to get the position of the sample in its dataset.
+ *
+ * @return size_t The row of the sample.
+ */
+size_t Sample::getRow(void) const
+{
+    return row;  ///< Return the sample's row.
 }
 
 /**
@@ -49,7 +59,7 @@ void Sample::setClusterID(int clusterID)
  */
 int Sample::getIndex(void) const
 {
-    return idx;  ///< Return the sample's index.
+    return dataset->getIndices()[row];  ///< Return the sample's index.
 }
 
 /**
@@ -59,7 +69,28 @@ int Sample::getIndex(void) const
  */
 int Sample::getClusterID(void) const
 {
-    return cID;  ///< Return the sample's assigned cluster ID.
+    return dataset->getLabels()[row];  ///< Return the sample's assigned cluster ID.
+}
+
+/**
+ * @brief Method to get the number of coordinates of the sample.
+ *
+ * @return size_t The dimension of the sample.
+ */
+size_t Sample::getDimension(void) const
+{
+    return dataset->getDimension();  ///< Every sample of a dataset has the same dimension.
+}
+
+/**
+ * @brief Method to get one coordinate of the sample.
+ *
+ * @param dimension The coordinate, from 0 to getDimension() - 1.
+ * @return double The value of the coordinate.
+ */
+double Sample::getCoordinate(size_t dimension) const
+{
+    return dataset->getCoordinate(dimension, row);  ///< Return the coordinate of the sample.
 }
 
 /**
@@ -69,17 +100,17 @@ int Sample::getClusterID(void) const
  */
 double Sample::getX(void) const
 {
-    return x;  ///< Return the X coordinate of the sample.
+    return getCoordinate(0);  ///< Return the X coordinate of the sample.
 }
 
 /**
  * @brief Method to get the Y coordinate of the sample.
  *
- * @return double The Y coordinate of the sample.
+ * @return double The Y coordinate of the sample, or 0 for one-dimensional data.
  */
 double Sample::getY(void) const
 {
-    return y;  ///< Return the Y coordinate of the sample.
+    return getDimension() > 1 ? getCoordinate(1) : 0.0;  ///< Return the Y coordinate of the sample.
 }
 
 /**
@@ -94,10 +125,19 @@ double Sample::getY(void) const
 ostream& operator<<(ostream& output, const Sample& sample)
 {
     // Format and print the sample's details: index, coordinates, and assigned cluster ID
-    output << "Index: " << sample.getIndex()
-        << "\t| X: " << sample.getX()
-        << " \t| Y: " << sample.getY()
-        << "\t| Cluster ID: " << sample.getClusterID()
+    output << "Index: " << sample.getIndex();
+    if (sample.getDimension() == 2) {
+        output << "\t| X: " << sample.getX()
+            << " \t| Y: " << sample.getY();
+    }
+    else {
+        output << "\t| Coordinates: (";
+        for (size_t d = 0; d < sample.getDimension(); ++d) {
+            output << (d > 0 ? ", " : "") << sample.getCoordinate(d);
+        }
+        output << ")";
+    }
+    output << "\t| Cluster ID: " << sample.getClusterID()
         << endl;
 
     return output;  ///< Return the output stream to allow for chaining.
@@ -1,14 +1,20 @@
 #ifndef SAMPLE_H
 #define SAMPLE_H
 
+#include <cstddef>
 #include <iostream>
 
 using namespace std;
 
+class Dataset;
+
 /**
  * @class Sample
  * @brief Represents a single sample in the K-means algorithm.
- *        Each sample consists of an index, cluster ID, and (x, y) coordinates in a 2D space.
+ *        Each sample consists of an index, cluster ID, and one coordinate per dimension
+ *        ((x, y) for the 2D data the program was written for).
+ *        A Sample is a lightweight view of one row of a Dataset: the values themselves live in
+ *        the dataset's arrays, so a Sample is only valid as long as its dataset.
  */
 class Sample
 {
@@ -19,14 +25,12 @@ class Sample
 public:
 
     /**
-     * @brief Constructor that initializes a Sample object with the given index, cluster ID, and (x, y) coordinates.
+     * @brief Constructor that creates a view of one row of a dataset.
      *
-     * @param i The index of the sample.
-     * @param ID The ID of the cluster the sample belongs to.
-     * @param X The X coordinate of the sample.
-     * @param Y The Y coordinate of the sample.
+     * @param dataset The dataset holding the sample.
+     * @param row The position of the sample in the dataset.
      */
-    Sample(int i, int ID, double X, double Y);
+    Sample(Dataset* dataset, size_t row);
 
     /**
      * @brief Destructor for the Sample class.
@@ -41,6 +45,13 @@ public:
      */
     void setClusterID(int ID);
 
+    /**
+     * @brief Gets the position of the sample in its dataset.
+     *
+     * @return The row of the sample.
+     */
+    size_t getRow(void) const;
+
     /**
      * @brief Gets the index of the sample.
      *
@@ -56,32 +67,41 @@ public:
     int getClusterID(void) const;
 
     /**
-     * @brief Gets the X coordinate of the sample.
+     * @brief Gets the number of coordinates of the sample.
+     *
+     * @return The dimension of the sample.
+     */
+    size_t getDimension(void) const;
+
+    /**
+     * @brief Gets one coordinate of the sample.
+     *
+     * @param dimension The coordinate, from 0 to getDimension() - 1.
+     * @return The value of the coordinate.
+     */
+    double getCoordinate(size_t dimension) const;
+
+    /**
+     * @brief Gets the X coordinate (the first coordinate) of the sample.
      *
      * @return The X coordinate of the sample.
      */
     double getX(void) const;
 
     /**
-     * @brief Gets the Y coordinate of the sample.
+     * @brief Gets the Y coordinate (the second coordinate) of the sample.
      *
-     * @return The Y coordinate of the sample.
+     * @return The Y coordinate of the sample, or 0 for one-dimensional data.
      */
     double getY(void) const;
 
 private:
 
-    /** The index of the sample. */
-    int idx;
-
-    /** The ID of the cluster the sample belongs to. */
-    int cID;
-
-    /** The X coordinate of the sample in the 2D space. */
-    double x;
+    /** The dataset holding the sample. */
+    Dataset* dataset;
 
-    /** The Y coordinate of the sample in the 2D space. */
-    double y;
+    /** The position of the sample in the dataset. */
+    size_t row;
 };
 
 #endif
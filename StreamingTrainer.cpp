@@ -0,0 +1,334 @@
+/****************************************************************************
+ * @file StreamingTrainer.cpp
+ * @brief Implementation of the StreamingTrainer class: double-buffered chunk
+ *        reads on a background task, the parallel assignment of each chunk
+ *        and the per-pass center update of out-of-core K-means.
+ ****************************************************************************/
+
+#include "StreamingTrainer.h"
+#include "BlockPartition.h"
+#include "CenterInitializer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <future>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * @brief Constructor that opens the binary dataset file and reads its header.
+ *
+ * @param fileName The name of the binary dataset file.
+ * @param pool The thread pool used by the assignment of each chunk.
+ * @param options The chunk size, the label file, the initialization and the instruction set.
+ * @throws invalid_argument If the chunk size is 0 or the precision is not double.
+ * @throws runtime_error If the file is not a valid binary dataset.
+ */
+StreamingTrainer::StreamingTrainer(const string& fileName, ThreadPool& pool, const KMeansOptions& options)
+    : fileName(fileName), pool(pool), options(options), kernel(options.instructionSet),
+    file(fileName, ios::binary), header(), swapped(false), inertia(0.0), passCount(0), stopReason(StopReason::Converged)
+{
+    if (options.chunkSize == 0) {
+        throw invalid_argument("The chunk size must be a positive number.");
+    }
+    if (options.precision != Precision::Double) {
+        throw invalid_argument("The out-of-core mode only supports double precision.");
+    }
+    if (!file) {
+        throw runtime_error("File not found: " + fileName);
+    }
+    if (!BinaryDataset::isBinaryFile(fileName)) {
+        throw runtime_error("The out-of-core mode needs a binary dataset file; convert " + fileName + " with --convert.");
+    }
+
+    char bytes[sizeof(BinaryDatasetHeader)];
+    file.read(bytes, sizeof(bytes));
+    header = BinaryDataset::readHeader(bytes, filesystem::file_size(fileName), fileName, swapped);
+}
+
+/**
+ * @brief Returns the number of samples in the file.
+ *
+ * @return size_t The number of samples.
+ */
+size_t StreamingTrainer::getSampleCount() const
+{
+    return static_cast<size_t>(header.sampleCount);
+}
+
+/**
+ * @brief Returns the number of coordinates of every sample.
+ *
+ * @return size_t The dimension.
+ */
+size_t StreamingTrainer::getDimension() const
+{
+    return static_cast<size_t>(header.dimension);
+}
+
+/**
+ * @brief Creates the clusters with initial centers chosen among the samples of the first chunk.
+ *
+ * @param k The number of clusters.
+ * @return vector<Cluster> The clusters, with IDs 1 to k.
+ * @throws runtime_error If the file holds fewer samples than clusters.
+ */
+vector<Cluster> StreamingTrainer::initialize(size_t k)
+{
+    if (getSampleCount() < k) {
+        throw runtime_error("The input file holds fewer samples than the number of clusters.");
+    }
+
+    Dataset first;
+    BinaryDataset::readSamples(file, header, swapped, 0, min(getSampleCount(), max(options.chunkSize, k)), first);
+    const vector<size_t> rows = CenterInitializer(first, pool, options).chooseCenters(options.initialization, k);
+
+    vector<Cluster> clusters;
+    vector<double> center(getDimension());
+    for (size_t j = 0; j < k; ++j) {
+        for (size_t d = 0; d < center.size(); ++d) {
+            center[d] = first.getColumn(d)[rows[j]];
+        }
+        clusters.emplace_back(static_cast<int>(j + 1), center);
+    }
+    return clusters;
+}
+
+/**
+ * @brief Runs K-means iterations over the streamed file until the centers converge, maxIterations
+ *        passes are done or the time budget is spent.
+ *
+ * @param clusters The clusters, holding the initial centers.
+ * @throws runtime_error If the file cannot be read or the label file cannot be written.
+ */
+void StreamingTrainer::run(vector<Cluster>& clusters)
+{
+    const size_t K = clusters.size();
+    const size_t D = getDimension();
+    const size_t chunkCount = (getSampleCount() + options.chunkSize - 1) / options.chunkSize;
+    const size_t blockCount = BlockPartition(getSampleCount()).getBlockCount();
+
+    if (!options.labelFileName.empty()) {
+        labelFile.open(options.labelFileName, ios::binary | ios::trunc);
+        if (!labelFile) {
+            throw runtime_error("Cannot write " + options.labelFileName);
+        }
+    }
+
+    const auto start = chrono::steady_clock::now();
+    Dataset buffers[2];
+    passCount = 0;
+    for (;;) {
+        centers.resize(K * D);
+        for (size_t c = 0; c < K; ++c) {
+            copy(clusters[c].getCenter().begin(), clusters[c].getCenter().end(), &centers[c * D]);
+        }
+        counts.assign(K, 0);
+        blockSums.assign(blockCount, vector<double>(K * (D + 1), 0.0));
+        blockInertia.assign(blockCount, 0.0);
+        if (labelFile.is_open()) {
+            labelFile.seekp(0);
+        }
+
+        // Read chunk c + 1 in the background while chunk c is assigned
+        future<void> pending;
+        if (chunkCount > 0) {
+            pending = async(launch::async, [&]() { readChunk(0, buffers[0]); });
+        }
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+            pending.get();
+            if (chunk + 1 < chunkCount) {
+                pending = async(launch::async, [&, chunk]() { readChunk(chunk + 1, buffers[(chunk + 1) % 2]); });
+            }
+            assignChunk(buffers[chunk % 2], chunk * options.chunkSize);
+        }
+        mergeBlockSums();
+        ++passCount;
+
+        if (labelFile.is_open() && !labelFile.flush()) {
+            throw runtime_error("Cannot write " + options.labelFileName);
+        }
+
+        // Update the cluster centers from the sums of the whole pass, as updateKM() does
+        bool changed = false;
+        double largestShift = 0.0;
+        for (size_t c = 0; c < K; ++c) {
+            if (clusters[c].calculateCenter(&sums[c * D], counts[c])) {
+                changed = true;
+                double squaredShift = 0.0;
+                for (size_t d = 0; d < D; ++d) {
+                    const double step = clusters[c].getCenter()[d] - centers[c * D + d];
+                    squaredShift += step * step;
+                }
+                largestShift = max(largestShift, sqrt(squaredShift));
+            }
+        }
+
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        if (!changed || (options.shiftTolerance > 0.0 && largestShift <= options.shiftTolerance)) {
+            stopReason = StopReason::Converged;
+        }
+        else if (options.maxIterations > 0 && passCount >= options.maxIterations) {
+            stopReason = StopReason::MaxIterations;
+        }
+        else if (options.timeBudget > 0.0 && elapsed.count() >= options.timeBudget) {
+            stopReason = StopReason::TimeBudget;
+        }
+        else {
+            continue;
+        }
+        break;
+    }
+
+    labelFile.close();
+}
+
+/**
+ * @brief Returns the number of passes over the file made by run().
+ *
+ * @return size_t The number of passes.
+ */
+size_t StreamingTrainer::getPassCount() const
+{
+    return passCount;
+}
+
+/**
+ * @brief Returns why run() stopped.
+ *
+ * @return StopReason Converged, MaxIterations or TimeBudget.
+ */
+StopReason StreamingTrainer::getStopReason() const
+{
+    return stopReason;
+}
+
+/**
+ * @brief Returns the number of samples of every cluster in the last pass.
+ *
+ * @return const vector<size_t>& The counts.
+ */
+const vector<size_t>& StreamingTrainer::getCounts() const
+{
+    return counts;
+}
+
+/**
+ * @brief Returns the inertia of the last pass.
+ *
+ * @return double The sum of the squared distances of the samples to their nearest centers.
+ */
+double StreamingTrainer::getInertia() const
+{
+    return inertia;
+}
+
+/**
+ * @brief Reads one chunk of the file.
+ *
+ * @param chunk The chunk index.
+ * @param buffer The dataset that receives the samples of the chunk.
+ */
+void StreamingTrainer::readChunk(size_t chunk, Dataset& buffer)
+{
+    const size_t first = chunk * options.chunkSize;
+    BinaryDataset::readSamples(file, header, swapped, first, min(options.chunkSize, getSampleCount() - first), buffer);
+}
+
+/**
+ * @brief Assigns the samples of a chunk in parallel blocks of the chunk, then adds them, in sample
+ *        order, to the partial sums of the blocks of the file they belong to, which are independent
+ *        and filled in parallel too; and writes the cluster IDs of the chunk. A block of the file that
+ *        spans several chunks continues its sums where the previous chunk left them.
+ *
+ * @param chunk The samples of the chunk.
+ * @param first The index of the first sample of the chunk in the file.
+ */
+void StreamingTrainer::assignChunk(const Dataset& chunk, size_t first)
+{
+    const size_t K = counts.size();
+    const size_t D = getDimension();
+    const size_t stride = D + 1;
+    const size_t last = first + chunk.size();
+
+    vector<const double*> columns(D);
+    for (size_t d = 0; d < D; ++d) {
+        columns[d] = chunk.getColumn(d);
+    }
+    chunkLabels.resize(chunk.size());
+    chunkDistances.resize(chunk.size());
+
+    // The search of every sample is independent: any split of the chunk finds the same centers
+    const BlockPartition searchBlocks(chunk.size());
+    pool.parallelFor(searchBlocks.getBlockCount(), [&](size_t block) {
+        size_t nearest[DistanceKernel::CHUNK_SIZE];
+        const size_t end = searchBlocks.getBlockEnd(block);
+        for (size_t begin = searchBlocks.getBlockBegin(block); begin < end; begin += DistanceKernel::CHUNK_SIZE) {
+            const size_t beginEnd = min(end, begin + DistanceKernel::CHUNK_SIZE);
+            kernel.findNearest(columns.data(), D, begin, beginEnd, centers.data(), K, nearest, &chunkDistances[begin]);
+            for (size_t i = begin; i < beginEnd; ++i) {
+                chunkLabels[i] = static_cast<int>(nearest[i - begin] + 1);  ///< Cluster IDs start at 1
+            }
+        }
+        });
+
+    // The sums follow the blocks of the whole file, so they add up like those of the in-memory engines
+    const BlockPartition blocks(getSampleCount());
+    size_t firstBlock = 0;
+    while (blocks.getBlockEnd(firstBlock) <= first) {
+        ++firstBlock;
+    }
+    size_t lastBlock = firstBlock;
+    while (blocks.getBlockEnd(lastBlock) < last) {
+        ++lastBlock;
+    }
+
+    pool.parallelFor(lastBlock - firstBlock + 1, [&](size_t offset) {
+        const size_t block = firstBlock + offset;
+        const size_t begin = max(first, blocks.getBlockBegin(block)) - first;
+        const size_t end = min(last, blocks.getBlockEnd(block)) - first;
+        vector<double>& partial = blockSums[block];
+        double partialInertia = blockInertia[block];
+
+        for (size_t i = begin; i < end; ++i) {
+            double* target = &partial[static_cast<size_t>(chunkLabels[i] - 1) * stride];
+            for (size_t d = 0; d < D; ++d) {
+                target[d] += columns[d][i];
+            }
+            target[D] += 1.0;
+            partialInertia += chunkDistances[i] * chunkDistances[i];
+        }
+        blockInertia[block] = partialInertia;
+        });
+
+    if (labelFile.is_open()) {
+        labelFile.write(reinterpret_cast<const char*>(chunkLabels.data()),
+            static_cast<streamsize>(chunkLabels.size() * sizeof(int)));
+    }
+}
+
+/**
+ * @brief Merges the partial sums, counts and inertia of the blocks of the file, in block order.
+ */
+void StreamingTrainer::mergeBlockSums()
+{
+    const size_t K = counts.size();
+    const size_t D = getDimension();
+    const size_t stride = D + 1;
+
+    sums.assign(K * D, 0.0);
+    fill(counts.begin(), counts.end(), 0);
+    inertia = 0.0;
+    for (size_t block = 0; block < blockSums.size(); ++block) {
+        const vector<double>& partial = blockSums[block];
+        for (size_t c = 0; c < K; ++c) {
+            for (size_t d = 0; d < D; ++d) {
+                sums[c * D + d] += partial[c * stride + d];
+            }
+            counts[c] += static_cast<size_t>(partial[c * stride + D]);
+        }
+        inertia += blockInertia[block];
+    }
+}
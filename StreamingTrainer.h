@@ -0,0 +1,195 @@
+#ifndef STREAMINGTRAINER_H
+#define STREAMINGTRAINER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "BinaryDataset.h"
+#include "Cluster.h"
+#include "Dataset.h"
+#include "DistanceKernel.h"
+#include "KMeansOptions.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+/**
+ * @class StreamingTrainer
+ * @brief Out-of-core K-means over a binary dataset file that may be larger than the memory.
+ *        Every iteration streams the file in chunks of chunkSize samples: while one chunk is
+ *        assigned to its nearest centers on the thread pool, the next one is read by a background
+ *        task into a second buffer, so the disk reads overlap with the computation. Only the
+ *        centers, the per-cluster sums and counts and two chunk buffers stay in memory; the cluster
+ *        ID of every sample can be written to a label file instead of being kept.
+ *
+ *        The sums are accumulated on the blocks an in-memory engine would split the whole file into
+ *        (see BlockPartition), each in sample order whatever the chunk boundaries, and merged in block
+ *        order at the end of the pass. For the same initial centers, the sums, centers and labels
+ *        are therefore bitwise identical to those of the in-memory Lloyd engine, for every chunk size
+ *        and thread count.
+ *
+ *        The assignment is the brute-force vectorized search: the bounds of the other engines
+ *        would need per-sample state of the size of the data.
+ */
+class StreamingTrainer
+{
+public:
+
+    /**
+     * @brief Constructor that opens the binary dataset file and reads its header.
+     *
+     * @param fileName The name of the binary dataset file.
+     * @param pool The thread pool used by the assignment of each chunk.
+     * @param options The chunk size, the label file, the initialization and the instruction set.
+     * @throws invalid_argument If the chunk size is 0 or the precision is not double.
+     * @throws runtime_error If the file is not a valid binary dataset.
+     */
+    StreamingTrainer(const string& fileName, ThreadPool& pool, const KMeansOptions& options);
+
+    /**
+     * @brief Returns the number of samples in the file.
+     *
+     * @return The number of samples.
+     */
+    size_t getSampleCount() const;
+
+    /**
+     * @brief Returns the number of coordinates of every sample.
+     *
+     * @return The dimension.
+     */
+    size_t getDimension() const;
+
+    /**
+     * @brief Creates the clusters with initial centers chosen by the initialization method of the
+     *        options among the samples of the first chunk (at least k samples are read).
+     *
+     * @param k The number of clusters.
+     * @return The clusters, with IDs 1 to k.
+     * @throws runtime_error If the file holds fewer samples than clusters.
+     */
+    vector<Cluster> initialize(size_t k);
+
+    /**
+     * @brief Runs K-means iterations over the streamed file until the centers converge, like
+     *        KMeans::updateKM(), or the iteration limit or the time budget of the options is reached.
+     *        The label file, if any, holds the labels of the last iteration.
+     *
+     * @param clusters The clusters, holding the initial centers. Their centers are updated in place.
+     * @throws runtime_error If the file cannot be read or the label file cannot be written.
+     */
+    void run(vector<Cluster>& clusters);
+
+    /**
+     * @brief Returns the number of passes over the file made by run().
+     *
+     * @return The number of passes.
+     */
+    size_t getPassCount() const;
+
+    /**
+     * @brief Returns why run() stopped. The inertia and label-change criteria do not apply here.
+     *
+     * @return Converged, MaxIterations or TimeBudget.
+     */
+    StopReason getStopReason() const;
+
+    /**
+     * @brief Returns the number of samples of every cluster in the last pass of run(). Like the inertia,
+     *        the counts belong to the centers the pass assigned the samples to, not to the centers
+     *        computed at its end: another pass over the file would cost as much as an iteration.
+     *
+     * @return The counts, in cluster ID order.
+     */
+    const vector<size_t>& getCounts() const;
+
+    /**
+     * @brief Returns the sum of the squared distances of the samples to their nearest centers in
+     *        the last pass of run().
+     *
+     * @return The inertia.
+     */
+    double getInertia() const;
+
+private:
+
+    /**
+     * @brief Reads one chunk of the file. Runs on the background task.
+     *
+     * @param chunk The chunk index.
+     * @param buffer The dataset that receives the samples of the chunk.
+     */
+    void readChunk(size_t chunk, Dataset& buffer);
+
+    /**
+     * @brief Assigns the samples of a chunk to their nearest centers, adds them to the partial sums
+     *        and counts of the blocks of the file they belong to and writes their cluster IDs to the
+     *        label file.
+     *
+     * @param chunk The samples of the chunk.
+     * @param first The index of the first sample of the chunk in the file.
+     */
+    void assignChunk(const Dataset& chunk, size_t first);
+
+    /**
+     * @brief Merges the partial sums, counts and inertia of the blocks of the file, in block order,
+     *        into those of the pass.
+     */
+    void mergeBlockSums();
+
+    /** The name of the binary dataset file. */
+    string fileName;
+
+    /** The thread pool used by the assignment of each chunk. */
+    ThreadPool& pool;
+
+    /** The chunk size, the label file, the initialization and the instruction set. */
+    KMeansOptions options;
+
+    /** The nearest-center search. */
+    DistanceKernel kernel;
+
+    /** The binary dataset file, read by one task at a time. */
+    ifstream file;
+
+    /** The header of the file. */
+    BinaryDatasetHeader header;
+
+    /** Whether the file was written with the other byte order. */
+    bool swapped;
+
+    /** The file receiving the cluster IDs, when the options name one. */
+    ofstream labelFile;
+
+    /** The current centers, row-major (K x dimension). */
+    vector<double> centers;
+
+    /** The coordinate sums of each cluster in the current pass (K x dimension, row-major). */
+    vector<double> sums;
+
+    /** The number of samples of each cluster in the current pass. */
+    vector<size_t> counts;
+
+    /** The partial sums and counts of every block of the file in the current pass, merged in block order. */
+    vector<vector<double>> blockSums;
+
+    /** The partial inertia of every block of the file in the current pass, merged in block order. */
+    vector<double> blockInertia;
+
+    /** The sum of the squared distances of the samples to their nearest centers in the current pass. */
+    double inertia;
+
+    /** The cluster IDs of the samples of the current chunk. */
+    vector<int> chunkLabels;
+
+    /** The distances of the samples of the current chunk to their nearest centers. */
+    vector<double> chunkDistances;
+
+    /** The number of passes over the file made by run(). */
+    size_t passCount;
+
+    /** Why run() stopped. */
+    StopReason stopReason;
+};
+
+#endif
@@ -0,0 +1,352 @@
+/****************************************************************************
+ * @file TextLoader.cpp
+ * @brief Implementation of the TextLoader class: chunking of a memory-mapped
+ *        text file on line boundaries, and the hand-written integer and
+ *        floating-point parsers used by the parallel parsing pass.
+ ****************************************************************************/
+
+#include "TextLoader.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+/** The approximate number of bytes parsed by one task. */
+static const size_t CHUNK_BYTES = 4 << 20;
+
+/** The longest token the slow path of parseDouble() copies to the stack; longer ones use a string. */
+static const size_t MAX_STACK_TOKEN = 64;
+
+/** The largest integer below which every integer is exactly representable as a double: 2^53. */
+static const uint64_t EXACT_MANTISSA_LIMIT = uint64_t(1) << 53;
+
+/** The powers of ten that are exact doubles. */
+static const double EXACT_POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * @brief Tells whether a character separates two numbers on a line.
+ *
+ * @param c The character.
+ * @return bool True for spaces, tabs and the other blanks except the line feed.
+ */
+static inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/**
+ * @brief Tells whether a character is a decimal digit.
+ *
+ * @param c The character.
+ * @return bool True for '0' to '9'.
+ */
+static inline bool isDigit(char c)
+{
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+/**
+ * @brief Tells whether a token ends at a position: at the end of the text, a blank or a line feed.
+ *
+ * @param p The position.
+ * @param end The end of the text.
+ * @return bool True if no other character follows the token.
+ */
+static inline bool isTokenEnd(const char* p, const char* end)
+{
+    return p == end || isBlank(*p) || *p == '\n';
+}
+
+/**
+ * @brief Parses a decimal integer with an optional sign, like istream >> int.
+ *
+ * @param p The position of the first character; moved past the number on success.
+ * @param end The end of the text.
+ * @param value Receives the number.
+ * @return bool False if there is no number or it does not fit an int.
+ */
+static bool parseInt(const char*& p, const char* end, int& value)
+{
+    const char* q = p;
+    bool negative = false;
+    if (q < end && (*q == '+' || *q == '-')) {
+        negative = *q == '-';
+        ++q;
+    }
+    if (q == end || !isDigit(*q)) return false;
+
+    const int64_t limit = negative ? -static_cast<int64_t>(numeric_limits<int>::min()) : numeric_limits<int>::max();
+    int64_t magnitude = 0;
+    for (; q < end && isDigit(*q); ++q) {
+        magnitude = magnitude * 10 + (*q - '0');
+        if (magnitude > limit) return false;
+    }
+
+    value = static_cast<int>(negative ? -magnitude : magnitude);
+    p = q;
+    return true;
+}
+
+/**
+ * @brief Parses a decimal floating-point number: an optional sign, digits with an optional
+ *        decimal point, and an optional exponent. Up to 19 significant digits are collected into
+ *        an integer; when that integer is below 2^53 and the power of ten is exact (at most 22),
+ *        one multiplication or division gives the correctly rounded result (Clinger's fast path).
+ *        The rare other numbers are converted by strtod, which is also correctly rounded.
+ *
+ * @param p The position of the first character; moved past the number on success.
+ * @param end The end of the text.
+ * @param value Receives the number.
+ * @return bool False if there is no number.
+ */
+static bool parseDouble(const char*& p, const char* end, double& value)
+{
+    const char* q = p;
+    bool negative = false;
+    if (q < end && (*q == '+' || *q == '-')) {
+        negative = *q == '-';
+        ++q;
+    }
+
+    uint64_t mantissa = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+    bool truncated = false;
+
+    // Integer part; digits beyond the 19th only scale the number
+    for (; q < end && isDigit(*q); ++q) {
+        anyDigit = true;
+        if (mantissa == 0 && *q == '0') continue;
+        if (significantDigits < 19) {
+            mantissa = mantissa * 10 + (*q - '0');
+            ++significantDigits;
+        }
+        else {
+            ++exponent;
+            truncated = truncated || *q != '0';
+        }
+    }
+
+    // Fractional part
+    if (q < end && *q == '.') {
+        for (++q; q < end && isDigit(*q); ++q) {
+            anyDigit = true;
+            if (mantissa == 0 && *q == '0') {
+                --exponent;
+                continue;
+            }
+            if (significantDigits < 19) {
+                mantissa = mantissa * 10 + (*q - '0');
+                ++significantDigits;
+                --exponent;
+            }
+            else {
+                truncated = truncated || *q != '0';
+            }
+        }
+    }
+    if (!anyDigit) return false;
+
+    // Exponent; a lone 'e' is not part of the number
+    if (q < end && (*q == 'e' || *q == 'E')) {
+        const char* e = q + 1;
+        bool negativeExponent = false;
+        if (e < end && (*e == '+' || *e == '-')) {
+            negativeExponent = *e == '-';
+            ++e;
+        }
+        if (e < end && isDigit(*e)) {
+            int written = 0;
+            for (; e < end && isDigit(*e); ++e) {
+                written = min(written * 10 + (*e - '0'), 100000);  ///< Saturate; strtod handles the range
+            }
+            exponent += negativeExponent ? -written : written;
+            q = e;
+        }
+    }
+
+    if (mantissa == 0) {
+        value = negative ? -0.0 : 0.0;
+    }
+    else if (!truncated && mantissa <= EXACT_MANTISSA_LIMIT && exponent >= -22 && exponent <= 22) {
+        double result = static_cast<double>(mantissa);
+        result = exponent < 0 ? result / EXACT_POWERS_OF_TEN[-exponent] : result * EXACT_POWERS_OF_TEN[exponent];
+        value = negative ? -result : result;
+    }
+    else {
+        // strtod needs a terminated string; the mapped file is not
+        const size_t length = static_cast<size_t>(q - p);
+        if (length < MAX_STACK_TOKEN) {
+            char token[MAX_STACK_TOKEN];
+            memcpy(token, p, length);
+            token[length] = '\0';
+            value = strtod(token, nullptr);
+        }
+        else {
+            value = strtod(string(p, q).c_str(), nullptr);
+        }
+    }
+
+    p = q;
+    return true;
+}
+
+/**
+ * @brief Skips the blanks that precede the next token or the end of the line.
+ *
+ * @param p The position; moved to the first character that is not a blank.
+ * @param end The end of the text.
+ */
+static inline void skipBlanks(const char*& p, const char* end)
+{
+    while (p < end && isBlank(*p)) ++p;
+}
+
+/**
+ * @brief Returns the position following the line that contains a position.
+ *
+ * @param p The position.
+ * @param end The end of the text.
+ * @return const char* The first character of the next line, or end.
+ */
+static inline const char* nextLine(const char* p, const char* end)
+{
+    const void* feed = memchr(p, '\n', static_cast<size_t>(end - p));
+    return feed == nullptr ? end : static_cast<const char*>(feed) + 1;
+}
+
+/**
+ * @brief Constructor that sets the thread pool used by the parallel passes.
+ *
+ * @param pool The thread pool.
+ */
+TextLoader::TextLoader(ThreadPool& pool)
+    : pool(pool)
+{
+}
+
+/**
+ * @brief Replaces the contents of a dataset with the samples of a file.
+ *
+ * @param fileName The name of the file.
+ * @param data The dataset that receives the samples.
+ * @param precision The type the coordinates are stored in; they are rounded to it as they are parsed.
+ * @throws runtime_error If the file cannot be read or a line is not a valid sample.
+ */
+void TextLoader::load(const string& fileName, Dataset& data, Precision precision) const
+{
+    const MappedFile file(fileName);
+    const char* const text = file.data();
+    const char* const end = text + file.size();
+
+    auto invalidLine = [&](size_t lineNumber) {
+        return runtime_error("Invalid sample on line " + to_string(lineNumber) + " of " + fileName);
+    };
+
+    // The first non-empty line decides the dimension: the number of tokens after the index
+    size_t dimension = 0;
+    size_t lineNumber = 1;
+    for (const char* line = text; line < end; line = nextLine(line, end), ++lineNumber) {
+        const char* p = line;
+        skipBlanks(p, end);
+        if (p == end || *p == '\n') continue;
+
+        while (p < end && *p != '\n') {
+            while (p < end && !isTokenEnd(p, end)) ++p;
+            skipBlanks(p, end);
+            ++dimension;
+        }
+        if (dimension < 2) throw invalidLine(lineNumber);
+        --dimension;
+        break;
+    }
+    data.reset(dimension == 0 ? data.getDimension() : dimension, precision);
+    if (dimension == 0) return;  ///< No sample at all
+
+    // Split the text into chunks that end on line boundaries
+    vector<const char*> boundaries(1, text);
+    while (boundaries.back() < end) {
+        const char* nominal = boundaries.back() + CHUNK_BYTES;
+        boundaries.push_back(nominal >= end ? end : nextLine(nominal - 1, end));
+    }
+    const size_t chunkCount = boundaries.size() - 1;
+
+    // First pass: the number of lines and of samples (non-empty lines) of every chunk
+    vector<size_t> lineCounts(chunkCount), sampleCounts(chunkCount);
+    pool.parallelFor(chunkCount, [&](size_t chunk) {
+        size_t lines = 0, samples = 0;
+        const char* const chunkEnd = boundaries[chunk + 1];
+        for (const char* line = boundaries[chunk]; line < chunkEnd; line = nextLine(line, chunkEnd)) {
+            const char* p = line;
+            skipBlanks(p, chunkEnd);
+            ++lines;
+            if (p < chunkEnd && *p != '\n') ++samples;
+        }
+        lineCounts[chunk] = lines;
+        sampleCounts[chunk] = samples;
+        });
+
+    vector<size_t> firstLines(chunkCount), firstRows(chunkCount);
+    size_t lineTotal = 1, rowTotal = 0;
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        firstLines[chunk] = lineTotal;
+        firstRows[chunk] = rowTotal;
+        lineTotal += lineCounts[chunk];
+        rowTotal += sampleCounts[chunk];
+    }
+    data.resize(rowTotal);
+
+    int* const indices = data.getWritableIndices();
+
+    // Second pass: parse every chunk into its rows, in the stored type; each chunk records its first invalid line
+    vector<size_t> errorLines(chunkCount, 0);
+    Dataset::visitPrecision(precision, [&](auto* type) {
+        using T = remove_pointer_t<decltype(type)>;
+        vector<T*> columns(dimension);
+        for (size_t d = 0; d < dimension; ++d) {
+            columns[d] = data.getWritableStoredColumn<T>(d);
+        }
+
+        pool.parallelFor(chunkCount, [&](size_t chunk) {
+            const char* const chunkEnd = boundaries[chunk + 1];
+            size_t row = firstRows[chunk];
+            size_t number = firstLines[chunk];
+            for (const char* line = boundaries[chunk]; line < chunkEnd; line = nextLine(line, chunkEnd), ++number) {
+                const char* p = line;
+                skipBlanks(p, chunkEnd);
+                if (p == chunkEnd || *p == '\n') continue;  ///< Skip empty lines
+
+                bool valid = parseInt(p, chunkEnd, indices[row]) && isTokenEnd(p, chunkEnd);
+                for (size_t d = 0; valid && d < dimension; ++d) {
+                    double value;
+                    skipBlanks(p, chunkEnd);
+                    valid = parseDouble(p, chunkEnd, value) && isTokenEnd(p, chunkEnd);
+                    columns[d][row] = Dataset::narrow<T>(valid ? value : 0.0);
+                }
+                skipBlanks(p, chunkEnd);
+                if (!valid || (p < chunkEnd && *p != '\n')) {
+                    errorLines[chunk] = number;
+                    return;
+                }
+                ++row;
+            }
+            });
+        });
+
+    for (size_t errorLine : errorLines) {
+        if (errorLine != 0) {
+            data.clear();
+            throw invalidLine(errorLine);
+        }
+    }
+}
@@ -0,0 +1,149 @@
+/****************************************************************************
+ * @file ThreadPool.cpp
+ * @brief Implementation of the ThreadPool class. The pool keeps its worker
+ *        threads alive between loops, so the per-iteration parallel steps of
+ *        the K-means algorithm do not pay for creating threads again and again.
+ ****************************************************************************/
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+/**
+ * @brief Constructor that starts (threadCount - 1) worker threads.
+ *
+ * @param threadCount The total number of threads. 0 selects the hardware concurrency.
+ */
+ThreadPool::ThreadPool(unsigned int threadCount)
+    : currentBody(nullptr), currentTaskCount(0), nextTask(0), generation(0),
+    activeWorkers(0), stopping(false)
+{
+    if (threadCount == 0) {
+        threadCount = thread::hardware_concurrency();
+    }
+    if (threadCount == 0) {
+        threadCount = 1;  ///< hardware_concurrency() may return 0 when it is unknown
+    }
+
+    for (unsigned int i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+/**
+ * @brief Destructor that wakes up all workers, tells them to stop and joins them.
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+ * @brief Returns the total number of threads taking part in a loop.
+ *
+ * @return unsigned int The number of workers plus the calling thread.
+ */
+unsigned int ThreadPool::getThreadCount() const
+{
+    return static_cast<unsigned int>(workers.size() + 1);
+}
+
+/**
+ * @brief Runs body(task) for every task index and waits for all of them.
+ *
+ * @param taskCount The number of tasks to run.
+ * @param body The function to call for each task index.
+ */
+void ThreadPool::parallelFor(size_t taskCount, const function<void(size_t)>& body)
+{
+    if (taskCount == 0) return;
+
+    // Nothing to share: run the loop on the calling thread.
+    if (workers.empty() || taskCount == 1) {
+        for (size_t task = 0; task < taskCount; ++task) {
+            body(task);
+        }
+        return;
+    }
+
+    {
+        lock_guard<mutex> guard(lock);
+        currentBody = &body;
+        currentTaskCount = taskCount;
+        nextTask = 0;
+        firstError = nullptr;
+        activeWorkers = workers.size();
+        ++generation;
+    }
+    workAvailable.notify_all();
+
+    runTasks();  ///< The calling thread works on the loop as well
+
+    exception_ptr error;
+    {
+        unique_lock<mutex> guard(lock);
+        workDone.wait(guard, [this] { return activeWorkers == 0; });
+        currentBody = nullptr;
+        error = firstError;
+    }
+
+    if (error) {
+        rethrow_exception(error);
+    }
+}
+
+/**
+ * @brief Main loop of a worker thread.
+ */
+void ThreadPool::workerLoop()
+{
+    size_t seenGeneration = 0;
+
+    while (true) {
+        {
+            unique_lock<mutex> guard(lock);
+            workAvailable.wait(guard, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+        }
+
+        runTasks();
+
+        {
+            lock_guard<mutex> guard(lock);
+            --activeWorkers;
+        }
+        workDone.notify_one();
+    }
+}
+
+/**
+ * @brief Takes task indices from the shared counter until the loop is exhausted.
+ *        After an exception the remaining tasks are skipped.
+ */
+void ThreadPool::runTasks()
+{
+    while (true) {
+        size_t task = nextTask.fetch_add(1);
+        if (task >= currentTaskCount) return;
+
+        try {
+            (*currentBody)(task);
+        }
+        catch (...) {
+            lock_guard<mutex> guard(lock);
+            if (!firstError) {
+                firstError = current_exception();
+            }
+            nextTask = currentTaskCount;  ///< Stop handing out new tasks
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class ThreadPool
+ * @brief A fixed-size pool of worker threads used to run data-parallel loops.
+ *        The calling thread always takes part in the work, so a pool created with
+ *        a thread count of 1 runs every loop inline without starting any thread.
+ */
+class ThreadPool
+{
+public:
+
+    /**
+     * @brief Constructor that starts the worker threads.
+     *
+     * @param threadCount The total number of threads (including the caller). 0 selects the hardware concurrency.
+     */
+    explicit ThreadPool(unsigned int threadCount = 0);
+
+    /**
+     * @brief Destructor that stops and joins all worker threads.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Returns the total number of threads taking part in a loop.
+     *
+     * @return The thread count, including the calling thread.
+     */
+    unsigned int getThreadCount() const;
+
+    /**
+     * @brief Runs body(task) for every task in [0, taskCount) and waits until all of them are done.
+     *        Tasks are handed out dynamically, so the body must not depend on which thread runs it.
+     *        The first exception thrown by a task is rethrown on the calling thread.
+     *
+     * @param taskCount The number of tasks to run.
+     * @param body The function to call for each task index.
+     */
+    void parallelFor(size_t taskCount, const function<void(size_t)>& body);
+
+private:
+
+    /**
+     * @brief Main loop of a worker thread: waits for a new loop and helps to run its tasks.
+     */
+    void workerLoop();
+
+    /**
+     * @brief Takes tasks of the current loop until none are left.
+     */
+    void runTasks();
+
+    /** The worker threads (the calling thread is not stored here). */
+    vector<thread> workers;
+
+    /** Protects the loop state shared with the workers. */
+    mutex lock;
+
+    /** Signals the workers that a new loop has started or that the pool is stopping. */
+    condition_variable workAvailable;
+
+    /** Signals the calling thread that every worker has left the current loop. */
+    condition_variable workDone;
+
+    /** The body of the current loop. */
+    const function<void(size_t)>* currentBody;
+
+    /** The number of tasks of the current loop. */
+    size_t currentTaskCount;
+
+    /** The next task index to hand out. */
+    atomic<size_t> nextTask;
+
+    /** Increased for every loop so that workers can tell a new loop from a spurious wake-up. */
+    size_t generation;
+
+    /** The number of workers still busy with the current loop. */
+    size_t activeWorkers;
+
+    /** The first exception thrown by a task of the current loop. */
+    exception_ptr firstError;
+
+    /** Set when the pool is being destroyed. */
+    bool stopping;
+};
+
+#endif
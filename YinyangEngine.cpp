@@ -0,0 +1,272 @@
+/****************************************************************************
+ * @file YinyangEngine.cpp
+ * @brief Implementation of the YinyangEngine class. The centers are grouped
+ *        once, every sample keeps one lower bound per group, and the bounds
+ *        are used to filter whole samples, whole groups and single centers.
+ ****************************************************************************/
+
+#include "YinyangEngine.h"
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+/** The average number of centers per group. */
+static const size_t CENTERS_PER_GROUP = 10;
+
+/** The number of K-means iterations run on the centers to form the groups. */
+static const int GROUPING_ITERATIONS = 5;
+
+/**
+ * @brief Constructor that binds the engine to the samples and the thread pool.
+ *
+ * @param data The samples to assign.
+ * @param pool The thread pool used to process the blocks.
+ */
+YinyangEngine::YinyangEngine(Dataset& data, ThreadPool& pool)
+    : AssignmentEngine(data, pool), initialized(false), clusterCount(0), groupCount(0)
+{
+}
+
+/**
+ * @brief Assigns each sample to the nearest cluster.
+ *        All comparisons that let a center be skipped are strict, so a center that could be
+ *        exactly as close as the current one is always computed and ties are resolved like in
+ *        the brute-force loop.
+ *
+ * @param clusters The clusters with their current centers.
+ */
+void YinyangEngine::assign(const vector<Cluster>& clusters)
+{
+    loadCenters(clusters);
+
+    if (!initialized || clusterCount != clusters.size() || upperBounds.size() != data.size()) {
+        buildGroups();
+        assignAll();
+        return;
+    }
+
+    computeCenterShifts();
+    groupShifts.assign(groupCount, 0.0);
+    for (size_t j = 0; j < clusterCount; ++j) {
+        groupShifts[groupOfCenter[j]] = max(groupShifts[groupOfCenter[j]], centerShifts[j]);
+    }
+
+    resetBlockSums(clusterCount);
+    const size_t T = groupCount;
+
+    int* labels = data.getLabels();
+
+    dispatchDimension(dimension, [&](auto dim) {
+        pool.parallelFor(getBlockCount(), [&](size_t block) {
+            const size_t end = getBlockBegin(block + 1);
+            double* sums = getBlockSums(block);
+            auto point = dim.makePoint();
+            size_t distanceCount = 0;
+
+            // Scratch space of this block: the group bounds before the move, and the two smallest
+            // distances or bounds (with the center they belong to) found in each examined group
+            vector<double> oldLower(T);
+            vector<double> firstValue(T), secondValue(T);
+            vector<size_t> firstCenter(T);
+            vector<char> examined(T);
+
+            for (size_t i = getBlockBegin(block); i < end; ++i) {
+                loadPoint(i, point.data(), dim);
+                double* lower = &lowerBounds[i * T];
+                size_t a = static_cast<size_t>(labels[i] - 1);
+
+                // Move the bounds by the distance the centers travelled
+                double globalLower = numeric_limits<double>::max();
+                for (size_t t = 0; t < T; ++t) {
+                    oldLower[t] = lower[t];
+                    lower[t] = lower[t] - groupShifts[t];
+                    globalLower = min(globalLower, lower[t]);
+                }
+                double upper = upperBounds[i] + centerShifts[a];
+
+                // Global filter: no group can hold a center as close as the current one
+                if (upper < globalLower) {
+                    upperBounds[i] = upper;
+                    recordAssignment(sums, labels[i], a, point.data(), dim);
+                    continue;
+                }
+
+                upper = distance(point.data(), a, dim);
+                ++distanceCount;
+                if (upper < globalLower) {
+                    upperBounds[i] = upper;
+                    recordAssignment(sums, labels[i], a, point.data(), dim);
+                    continue;
+                }
+
+                const size_t oldA = a;
+                const double oldUpper = upper;
+
+                for (size_t t = 0; t < T; ++t) {
+                    // Group filter
+                    examined[t] = !(upper < lower[t]);
+                    if (!examined[t]) continue;
+
+                    firstValue[t] = secondValue[t] = numeric_limits<double>::max();
+                    firstCenter[t] = clusterCount;
+
+                    for (size_t m = groupStart[t]; m < groupStart[t + 1]; ++m) {
+                        const size_t j = groupMembers[m];
+                        if (j == oldA) continue;
+
+                        // Local filter: the bound of this center alone
+                        double value = oldLower[t] - centerShifts[j];
+                        if (!(upper < value)) {
+                            value = distance(point.data(), j, dim);
+                            ++distanceCount;
+                            if (value < upper || (value == upper && j < a)) {
+                                a = j;
+                                upper = value;
+                            }
+                        }
+
+                        if (value < firstValue[t]) {
+                            secondValue[t] = firstValue[t];
+                            firstValue[t] = value;
+                            firstCenter[t] = j;
+                        }
+                        else if (value < secondValue[t]) {
+                            secondValue[t] = value;
+                        }
+                    }
+                }
+
+                // New group bounds: leave out the final center of the sample, and include the
+                // previous one if the sample moved
+                for (size_t t = 0; t < T; ++t) {
+                    if (examined[t]) {
+                        lower[t] = (firstCenter[t] == a) ? secondValue[t] : firstValue[t];
+                    }
+                }
+                if (a != oldA) {
+                    double& oldGroupLower = lower[groupOfCenter[oldA]];
+                    oldGroupLower = min(oldGroupLower, oldUpper);
+                }
+
+                upperBounds[i] = upper;
+                recordAssignment(sums, labels[i], a, point.data(), dim);
+            }
+
+            setBlockDistanceCount(block, distanceCount);
+            });
+        });
+
+    mergeBlockSums();
+    storeCenters();
+}
+
+/**
+ * @brief Splits the centers loaded by loadCenters() into about K / 10 groups with a few
+ *        K-means iterations on the center coordinates, seeded with the first centers.
+ *        The groups are kept for the whole run, as in the original algorithm.
+ */
+void YinyangEngine::buildGroups()
+{
+    const size_t D = dimension;
+    const DynamicDimension dim{ D };
+    clusterCount = centers.size() / D;
+    groupCount = max<size_t>(1, clusterCount / CENTERS_PER_GROUP);
+
+    vector<double> groupCenters(centers.begin(), centers.begin() + groupCount * D);
+
+    groupOfCenter.assign(clusterCount, 0);
+    for (int iteration = 0; iteration < GROUPING_ITERATIONS; ++iteration) {
+        vector<double> sums(groupCount * D, 0.0);
+        vector<size_t> count(groupCount, 0);
+
+        for (size_t j = 0; j < clusterCount; ++j) {
+            double best = numeric_limits<double>::max();
+            for (size_t t = 0; t < groupCount; ++t) {
+                double d = squaredDistance(&centers[j * D], &groupCenters[t * D], dim);
+                if (d < best) {
+                    best = d;
+                    groupOfCenter[j] = t;
+                }
+            }
+            accumulatePoint(&sums[groupOfCenter[j] * D], &centers[j * D], dim);
+            ++count[groupOfCenter[j]];
+        }
+
+        for (size_t t = 0; t < groupCount; ++t) {
+            if (count[t] > 0) {
+                for (size_t d = 0; d < D; ++d) {
+                    groupCenters[t * D + d] = sums[t * D + d] / count[t];
+                }
+            }
+        }
+    }
+
+    // Store the members of each group contiguously
+    groupStart.assign(groupCount + 1, 0);
+    for (size_t j = 0; j < clusterCount; ++j) {
+        ++groupStart[groupOfCenter[j] + 1];
+    }
+    for (size_t t = 0; t < groupCount; ++t) {
+        groupStart[t + 1] += groupStart[t];
+    }
+    groupMembers.assign(clusterCount, 0);
+    vector<size_t> next(groupStart.begin(), groupStart.end() - 1);
+    for (size_t j = 0; j < clusterCount; ++j) {
+        groupMembers[next[groupOfCenter[j]]++] = j;
+    }
+}
+
+/**
+ * @brief Computes every distance once, which sets the upper bound and the group bounds to exact values.
+ */
+void YinyangEngine::assignAll()
+{
+    const size_t T = groupCount;
+
+    upperBounds.assign(data.size(), 0.0);
+    lowerBounds.assign(data.size() * T, 0.0);
+    resetBlockSums(clusterCount);
+
+    int* labels = data.getLabels();
+
+    dispatchDimension(dimension, [&](auto dim) {
+        pool.parallelFor(getBlockCount(), [&](size_t block) {
+            const size_t end = getBlockBegin(block + 1);
+            double* sums = getBlockSums(block);
+            auto point = dim.makePoint();
+            vector<double> distances(clusterCount);
+
+            for (size_t i = getBlockBegin(block); i < end; ++i) {
+                loadPoint(i, point.data(), dim);
+                double* lower = &lowerBounds[i * T];
+                double minDistance = numeric_limits<double>::max();
+                size_t best = 0;
+
+                for (size_t j = 0; j < clusterCount; ++j) {
+                    distances[j] = distance(point.data(), j, dim);
+                    if (distances[j] < minDistance) {
+                        minDistance = distances[j];
+                        best = j;
+                    }
+                }
+
+                fill(lower, lower + T, numeric_limits<double>::max());
+                for (size_t j = 0; j < clusterCount; ++j) {
+                    if (j != best) {
+                        lower[groupOfCenter[j]] = min(lower[groupOfCenter[j]], distances[j]);
+                    }
+                }
+
+                upperBounds[i] = minDistance;
+                recordAssignment(sums, labels[i], best, point.data(), dim);
+            }
+
+            setBlockDistanceCount(block, (end - getBlockBegin(block)) * clusterCount);
+            });
+        });
+
+    mergeBlockSums();
+    storeCenters();
+    initialized = true;
+}
@@ -0,0 +1,77 @@
+#ifndef YINYANGENGINE_H
+#define YINYANGENGINE_H
+
+#include "AssignmentEngine.h"
+
+using namespace std;
+
+/**
+ * @class YinyangEngine
+ * @brief Assignment step for large K based on Yinyang K-means (Ding et al., 2015).
+ *        The centers are split once into groups of about ten centers. Every sample keeps an
+ *        upper bound on the distance to its own center and one lower bound per group. A sample
+ *        is skipped when its upper bound is below all its group bounds (global filter), a group
+ *        is skipped when the upper bound is below the group bound (group filter), and inside a
+ *        group a center is skipped when its own moved bound is above the upper bound (local filter).
+ *        The labels are the same as the brute-force LloydEngine, including ties.
+ */
+class YinyangEngine : public AssignmentEngine
+{
+public:
+
+    /**
+     * @brief Constructor that binds the engine to the samples and the thread pool.
+     *
+     * @param data The samples to assign.
+     * @param pool The thread pool used to process the blocks.
+     */
+    YinyangEngine(Dataset& data, ThreadPool& pool);
+
+    /**
+     * @brief Assigns each sample to the nearest cluster, skipping the samples, groups and centers the bounds rule out.
+     *
+     * @param clusters The clusters with their current centers.
+     */
+    void assign(const vector<Cluster>& clusters) override;
+
+private:
+
+    /**
+     * @brief Splits the loaded centers into groups by running a few K-means iterations on the centers themselves.
+     */
+    void buildGroups();
+
+    /**
+     * @brief Computes every distance once to set exact bounds (first call only).
+     */
+    void assignAll();
+
+    /** Whether the groups and bounds have been initialized. */
+    bool initialized;
+
+    /** The number of clusters the bounds were built for. */
+    size_t clusterCount;
+
+    /** The number of center groups. */
+    size_t groupCount;
+
+    /** For every center, the index of its group. */
+    vector<size_t> groupOfCenter;
+
+    /** The centers of all groups, group after group, each group in increasing index order. */
+    vector<size_t> groupMembers;
+
+    /** Where the members of each group start in groupMembers (groupCount + 1 entries). */
+    vector<size_t> groupStart;
+
+    /** For every group, the largest distance travelled by one of its centers since the previous call. */
+    vector<double> groupShifts;
+
+    /** For every sample, an upper bound on the distance to its assigned center. */
+    vector<double> upperBounds;
+
+    /** For every sample and group (row-major), a lower bound on the distance to the group's centers other than the sample's own. */
+    vector<double> lowerBounds;
+};
+
+#endif